@@ -0,0 +1,1199 @@
+// Native microbenchmark for the engine-independent magnetism core (src/core).
+// Build with `scons benchmark` and run bin/magnetism_benchmark [--threads N] [--max-magnets N] [--ticks N].
+// With --replay FILE it instead solves every frame of a recording made by MagneticWorld.start_recording(), and
+// diffs the results against the recorded ones.
+//
+// Every scene is solved in both solver modes. Before timing, the benchmark checks the vectorized kernel, the
+// Pairwise solver and incremental solving against full scalar references and exits with a nonzero status if they
+// disagree. It also reports the error of the baked static field grid against exact pair evaluation.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "magnetfieldgrid.h"
+#include "magnetkernel.h"
+#include "magnetrecording.h"
+#include "magnetsolver.h"
+#include "magnettasks.h"
+
+// --- Scene generation ---
+
+/**
+ * Spatial layouts of the synthetic scenes.
+ * Uniform: magnets spread evenly through a cube.
+ * Clustered: magnets packed into a few dense clusters, as in piles of scrap around a coilgun.
+ */
+enum SceneLayout {
+    LAYOUT_UNIFORM,
+    LAYOUT_CLUSTERED
+};
+
+static const char* layout_name(SceneLayout layout) {
+    return layout == LAYOUT_UNIFORM ? "uniform" : "clustered";
+}
+
+// Average spacing between neighbouring magnets in the uniform layout.
+static constexpr double MAGNET_SPACING = 6.0;
+
+// Number of magnets per cluster in the clustered layout.
+static constexpr size_t MAGNETS_PER_CLUSTER = 500;
+
+/**
+ * Fills a snapshot with a deterministic synthetic scene of mixed magnet types:
+ * 10% permanent, 80% temporary (a quarter of them magnetized) and 10% electromagnets (half of them on).
+ */
+static void generate_scene(MagnetSnapshot& snapshot, size_t count, SceneLayout layout, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    const double extent = MAGNET_SPACING * std::cbrt(double(count));
+    const size_t clusterCount = std::max<size_t>(1, count / MAGNETS_PER_CLUSTER);
+    std::vector<MagnetVector> clusterCenters(clusterCount);
+    for (MagnetVector& center : clusterCenters) {
+        center = MagnetVector{ unit(rng) * extent, unit(rng) * extent, unit(rng) * extent };
+    }
+
+    snapshot.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        if (layout == LAYOUT_UNIFORM) {
+            snapshot.posX[i] = unit(rng) * extent;
+            snapshot.posY[i] = unit(rng) * extent;
+            snapshot.posZ[i] = unit(rng) * extent;
+        } else {
+            const MagnetVector& center = clusterCenters[i % clusterCount];
+            snapshot.posX[i] = center.x + normal(rng) * MAGNET_SPACING;
+            snapshot.posY[i] = center.y + normal(rng) * MAGNET_SPACING;
+            snapshot.posZ[i] = center.z + normal(rng) * MAGNET_SPACING;
+        }
+
+        // Random pole direction.
+        double ax = normal(rng), ay = normal(rng), az = normal(rng);
+        const double length = std::sqrt(ax * ax + ay * ay + az * az);
+        snapshot.axisX[i] = ax / length;
+        snapshot.axisY[i] = ay / length;
+        snapshot.axisZ[i] = az / length;
+
+        const double roll = unit(rng);
+        const MagnetType type = roll < 0.1 ? MAGNET_PERMANENT : (roll < 0.9 ? MAGNET_TEMPORARY : MAGNET_ELECTROMAGNET);
+        snapshot.type[i] = type;
+        snapshot.strength[i] = type == MAGNET_TEMPORARY ? 0.1 + 0.2 * unit(rng) : 0.5 + 0.5 * unit(rng);
+        snapshot.radiusSqr[i] = magnet_influence_radius_sqr(snapshot.strength[i]);
+        snapshot.on[i] = type == MAGNET_ELECTROMAGNET ? (unit(rng) < 0.5) : 1;
+        snapshot.magnetized[i] = type == MAGNET_TEMPORARY ? (unit(rng) < 0.25) : 0;
+    }
+}
+
+
+// --- Task runners ---
+
+/**
+ * Task runner that splits the tasks of each call across a fixed number of std::threads.
+ */
+class ThreadTaskRunner {
+public:
+    explicit ThreadTaskRunner(unsigned threadCount) : threadCount(threadCount) {}
+
+    void operator()(uint32_t taskCount, const MagnetTaskFunction& task) const {
+        if (threadCount <= 1 || taskCount <= 1) {
+            magnet_run_tasks_serial(taskCount, task);
+            return;
+        }
+
+        std::atomic<uint32_t> next(0);
+        auto worker = [&]() {
+            for (uint32_t taskIndex = next++; taskIndex < taskCount; taskIndex = next++) {
+                task(taskIndex);
+            }
+        };
+
+        const unsigned spawned = std::min<unsigned>(threadCount, taskCount) - 1;
+        std::vector<std::thread> threads;
+        threads.reserve(spawned);
+        for (unsigned t = 0; t < spawned; t++) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+private:
+    unsigned threadCount;
+};
+
+
+// --- Accuracy checks ---
+
+/**
+ * Returns the relative difference between two values, with an absolute floor for values near zero.
+ */
+static double relative_error(double value, double reference) {
+    return std::fabs(value - reference) / std::max(1e-9, std::fabs(reference));
+}
+
+/**
+ * Compares the vectorized batch kernels with the scalar reference kernels on every self magnet of a scene, at both
+ * precisions.
+ *
+ * @return True if every lane agrees within tolerance.
+ */
+static bool check_kernel(const MagnetSnapshot& snapshot) {
+    MagnetBatchResult vectorResult;
+    MagnetBatchResult scalarResult;
+    MagnetBatchResultT<float> vectorResultF;
+    MagnetBatchResultT<float> scalarResultF;
+    MagnetKernelStateF state;
+    state.gather(snapshot);
+    std::vector<uint32_t> others;
+    double maxError = 0.0;
+    double maxErrorF = 0.0;
+
+    for (uint32_t self = 0; self < snapshot.size(); self++) {
+        others.clear();
+        for (uint32_t other = 0; other < snapshot.size() && others.size() < MAGNET_BATCH_SIZE; other++) {
+            if (other != self) others.push_back(other);
+        }
+
+        magnet_batch_kernel(snapshot, self, others.data(), others.size(), vectorResult);
+        magnet_batch_kernel_scalar(snapshot, self, others.data(), others.size(), scalarResult);
+        for (size_t lane = 0; lane < others.size(); lane++) {
+            maxError = std::max({ maxError,
+                relative_error(vectorResult.forceX[lane], scalarResult.forceX[lane]),
+                relative_error(vectorResult.forceY[lane], scalarResult.forceY[lane]),
+                relative_error(vectorResult.forceZ[lane], scalarResult.forceZ[lane]),
+                relative_error(vectorResult.torqueX[lane], scalarResult.torqueX[lane]),
+                relative_error(vectorResult.torqueY[lane], scalarResult.torqueY[lane]),
+                relative_error(vectorResult.torqueZ[lane], scalarResult.torqueZ[lane]),
+                relative_error(vectorResult.distanceSqr[lane], scalarResult.distanceSqr[lane]) });
+        }
+
+        magnet_batch_kernel(state, self, others.data(), others.size(), vectorResultF);
+        magnet_batch_kernel_scalar(state, self, others.data(), others.size(), scalarResultF);
+        for (size_t lane = 0; lane < others.size(); lane++) {
+            maxErrorF = std::max({ maxErrorF,
+                relative_error(vectorResultF.forceX[lane], scalarResultF.forceX[lane]),
+                relative_error(vectorResultF.forceY[lane], scalarResultF.forceY[lane]),
+                relative_error(vectorResultF.forceZ[lane], scalarResultF.forceZ[lane]),
+                relative_error(vectorResultF.torqueX[lane], scalarResultF.torqueX[lane]),
+                relative_error(vectorResultF.torqueY[lane], scalarResultF.torqueY[lane]),
+                relative_error(vectorResultF.torqueZ[lane], scalarResultF.torqueZ[lane]),
+                relative_error(vectorResultF.distanceSqr[lane], scalarResultF.distanceSqr[lane]) });
+        }
+    }
+
+    // Vector units may fuse or reorder float operations differently from scalar code, so float gets a looser bound.
+    const bool passed = maxError < 1e-9 && maxErrorF < 1e-4;
+    std::printf("kernel check (%s vs scalar): max relative error %.3g (double), %.3g (float) %s\n",
+        magnet_batch_kernel_isa(), maxError, maxErrorF, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+/**
+ * Compares the fused per-pair interaction with the separate influence, force and torque functions on every ordered
+ * pair of a scene, and times both on the influencing pairs.
+ *
+ * @return True if every pair's results are bit-identical.
+ */
+static bool check_interaction(const MagnetSnapshot& snapshot) {
+    using Clock = std::chrono::steady_clock;
+
+    size_t mismatches = 0;
+    MagnetVector separateSum, fusedSum;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        for (size_t j = 0; j < snapshot.size(); j++) {
+            if (j == i || !snapshot.will_be_influenced_by(i, j)) continue;
+            const MagnetVector f = snapshot.calculate_force(i, j);
+            const MagnetVector t = snapshot.calculate_torque(i, j);
+            separateSum.x += f.x + t.x; separateSum.y += f.y + t.y; separateSum.z += f.z + t.z;
+        }
+    }
+    const double separateMsec = std::chrono::duration<double>(Clock::now() - start).count() * 1000.0;
+
+    start = Clock::now();
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        for (size_t j = 0; j < snapshot.size(); j++) {
+            if (j == i || !snapshot.will_be_influenced_by(i, j)) continue;
+            const MagnetInteraction interaction = snapshot.calculate_interaction(i, j);
+            fusedSum.x += interaction.force.x + interaction.torque.x;
+            fusedSum.y += interaction.force.y + interaction.torque.y;
+            fusedSum.z += interaction.force.z + interaction.torque.z;
+        }
+    }
+    const double fusedMsec = std::chrono::duration<double>(Clock::now() - start).count() * 1000.0;
+
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        for (size_t j = 0; j < snapshot.size(); j++) {
+            if (j == i) continue;
+            const MagnetInteraction interaction = snapshot.calculate_interaction(i, j);
+            const MagnetVector f = snapshot.calculate_force(i, j);
+            const MagnetVector t = snapshot.calculate_torque(i, j);
+            if (interaction.influenced != snapshot.will_be_influenced_by(i, j)
+                || interaction.force.x != f.x || interaction.force.y != f.y || interaction.force.z != f.z
+                || interaction.torque.x != t.x || interaction.torque.y != t.y || interaction.torque.z != t.z) {
+                mismatches++;
+            }
+        }
+    }
+
+    const bool passed = mismatches == 0 && separateSum.x == fusedSum.x && separateSum.y == fusedSum.y && separateSum.z == fusedSum.z;
+    std::printf("interaction check (fused vs separate): %.2f ms vs %.2f ms over influencing pairs, %zu mismatches %s\n",
+        fusedMsec, separateMsec, mismatches, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+/**
+ * Compares the Pairwise solver with a brute-force evaluation of every ordered pair through the shared model.
+ *
+ * @return True if the influence flags match exactly and the accumulated vectors agree within tolerance.
+ */
+static bool check_solver(MagnetSolver& solver) {
+    MagnetSnapshot& snapshot = solver.get_snapshot();
+    solver.set_mode(MAGNET_SOLVER_PAIRWISE);
+    solver.solve();
+
+    const size_t count = snapshot.size();
+    double maxError = 0.0;
+    size_t flagMismatches = 0;
+    for (size_t i = 0; i < count; i++) {
+        MagnetVector force, torque;
+        bool influenced = false;
+        if (snapshot.on[i]) {
+            for (size_t j = 0; j < count; j++) {
+                if (j == i || !snapshot.will_be_influenced_by(i, j)) continue;
+                const MagnetVector f = snapshot.calculate_force(i, j);
+                const MagnetVector t = snapshot.calculate_torque(i, j);
+                force.x += f.x; force.y += f.y; force.z += f.z;
+                torque.x += t.x; torque.y += t.y; torque.z += t.z;
+                influenced = true;
+            }
+        }
+
+        // The solver leaves results of magnets that are off untouched, like the engine adapter ignores them.
+        if (!snapshot.on[i]) continue;
+        if (influenced != (snapshot.influenced[i] != 0)) flagMismatches++;
+        const double scale = std::max({ 1e-6, std::fabs(force.x), std::fabs(force.y), std::fabs(force.z) });
+        const double torqueScale = std::max({ 1e-6, std::fabs(torque.x), std::fabs(torque.y), std::fabs(torque.z) });
+        maxError = std::max({ maxError,
+            std::fabs(snapshot.forceX[i] - force.x) / scale,
+            std::fabs(snapshot.forceY[i] - force.y) / scale,
+            std::fabs(snapshot.forceZ[i] - force.z) / scale,
+            std::fabs(snapshot.torqueX[i] - torque.x) / torqueScale,
+            std::fabs(snapshot.torqueY[i] - torque.y) / torqueScale,
+            std::fabs(snapshot.torqueZ[i] - torque.z) / torqueScale });
+    }
+
+    const bool passed = flagMismatches == 0 && maxError < 1e-9;
+    std::printf("solver check (pairwise vs brute force, %zu magnets): %zu flag mismatches, max relative error %.3g %s\n",
+        count, flagMismatches, maxError, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+
+/**
+ * Moves a few magnets of an incrementally solved scene and compares the reused results with a full solve.
+ *
+ * @return True if the incremental results are bit-identical to the full solve, and an idle solve updates nothing.
+ */
+static bool check_incremental(SceneLayout layout) {
+    MagnetSolver incremental;
+    MagnetSolver full;
+    full.set_incremental(false);
+    generate_scene(incremental.get_snapshot(), 1000, layout, 11);
+    incremental.solve();
+
+    // Nudge every 50th magnet and toggle a few electromagnets, as a partially settled scene would.
+    MagnetSnapshot& snapshot = incremental.get_snapshot();
+    for (size_t i = 0; i < snapshot.size(); i += 50) {
+        snapshot.posX[i] += 0.5;
+        if (snapshot.type[i] == MAGNET_ELECTROMAGNET) snapshot.on[i] ^= 1;
+    }
+    full.get_snapshot() = snapshot;
+    incremental.solve();
+    full.solve();
+
+    const MagnetSnapshot& expected = full.get_snapshot();
+    size_t mismatches = 0;
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        if (snapshot.forceX[i] != expected.forceX[i] || snapshot.forceY[i] != expected.forceY[i] || snapshot.forceZ[i] != expected.forceZ[i]
+            || snapshot.torqueX[i] != expected.torqueX[i] || snapshot.torqueY[i] != expected.torqueY[i] || snapshot.torqueZ[i] != expected.torqueZ[i]
+            || snapshot.influenced[i] != expected.influenced[i]) {
+            mismatches++;
+        }
+    }
+    const size_t updatedMagnets = incremental.get_updated_magnets();
+    const size_t evaluatedPairs = incremental.get_evaluated_pairs();
+
+    // An idle tick must not update anything.
+    incremental.solve();
+    const size_t idleUpdates = incremental.get_updated_magnets();
+
+    const bool passed = mismatches == 0 && idleUpdates == 0;
+    std::printf("incremental check (%s): %zu of %zu magnets and %zu of %zu pairs recomputed, %zu mismatches, %zu idle updates %s\n",
+        layout_name(layout), updatedMagnets, snapshot.size(), evaluatedPairs, full.get_evaluated_pairs(), mismatches, idleUpdates,
+        passed ? "ok" : "FAILED");
+    return passed;
+}
+
+
+/**
+ * Drifts the magnets of a scene for a number of ticks, solving each tick with broadphase neighbor lists, and compares
+ * the results with a solver querying the grid every tick, and with a fresh neighbor-list solver rebuilding every tick.
+ * Field samples taken between rebuilds are compared with the grid-querying solver too.
+ *
+ * @return True if the results match the grid query within rounding, and the fresh solve exactly.
+ */
+static bool check_neighbor_list(SceneLayout layout) {
+    using Clock = std::chrono::steady_clock;
+    constexpr int TICKS = 30;
+    constexpr double SKIN = 1.0;
+    constexpr double DRIFT = 0.05;
+
+    MagnetSolver listed;
+    MagnetSolver queried;
+    listed.get_broadphase().set_skin(SKIN);
+    generate_scene(listed.get_snapshot(), 1000, layout, 19);
+
+    std::mt19937 rng(23);
+    std::uniform_real_distribution<double> drift(-DRIFT, DRIFT);
+    double listedSeconds = 0.0;
+    double queriedSeconds = 0.0;
+    double maxError = 0.0;
+    size_t flagMismatches = 0;
+    size_t scheduleMismatches = 0;
+    for (int tick = 0; tick < TICKS; tick++) {
+        MagnetSnapshot& snapshot = listed.get_snapshot();
+        for (size_t i = 0; i < snapshot.size(); i++) {
+            snapshot.posX[i] += drift(rng);
+            snapshot.posY[i] += drift(rng);
+            snapshot.posZ[i] += drift(rng);
+        }
+        queried.get_snapshot() = snapshot;
+
+        auto start = Clock::now();
+        listed.solve();
+        listedSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+        start = Clock::now();
+        queried.solve();
+        queriedSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+
+        // Pairs come in a different order from the grid query, so sums agree up to rounding.
+        const MagnetSnapshot& expected = queried.get_snapshot();
+        for (size_t i = 0; i < snapshot.size(); i++) {
+            if (!snapshot.on[i]) continue;
+            if (snapshot.influenced[i] != expected.influenced[i]) flagMismatches++;
+            const double scale = std::max({ 1e-6, std::fabs(expected.forceX[i]), std::fabs(expected.forceY[i]), std::fabs(expected.forceZ[i]) });
+            maxError = std::max({ maxError,
+                std::fabs(snapshot.forceX[i] - expected.forceX[i]) / scale,
+                std::fabs(snapshot.forceY[i] - expected.forceY[i]) / scale,
+                std::fabs(snapshot.forceZ[i] - expected.forceZ[i]) / scale });
+        }
+
+        // The reported pair order does not depend on when the list was rebuilt, so a fresh list agrees exactly.
+        MagnetSolver fresh;
+        fresh.get_broadphase().set_skin(SKIN);
+        fresh.get_snapshot() = snapshot;
+        fresh.solve();
+        for (size_t i = 0; i < snapshot.size(); i++) {
+            if (snapshot.on[i] && (snapshot.forceX[i] != fresh.get_snapshot().forceX[i] || snapshot.torqueX[i] != fresh.get_snapshot().torqueX[i])) {
+                scheduleMismatches++;
+            }
+        }
+    }
+
+    // Field queries use the grid hashed at the last rebuild, which lags the magnets; they must still find every source.
+    std::vector<MagnetVector> points(1000);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    const double extent = MAGNET_SPACING * std::cbrt(double(listed.get_snapshot().size()));
+    for (MagnetVector& point : points) {
+        point = MagnetVector{ unit(rng) * extent, unit(rng) * extent, unit(rng) * extent };
+    }
+    std::vector<MagnetVector> listedField(points.size());
+    std::vector<MagnetVector> queriedField(points.size());
+    listed.sample_field(points.data(), points.size(), nullptr, listedField.data());
+    queried.sample_field(points.data(), points.size(), nullptr, queriedField.data());
+    for (size_t p = 0; p < points.size(); p++) {
+        const double scale = std::max({ 1e-6, std::fabs(queriedField[p].x), std::fabs(queriedField[p].y), std::fabs(queriedField[p].z) });
+        maxError = std::max({ maxError,
+            std::fabs(listedField[p].x - queriedField[p].x) / scale,
+            std::fabs(listedField[p].y - queriedField[p].y) / scale,
+            std::fabs(listedField[p].z - queriedField[p].z) / scale });
+    }
+
+    const MagnetBroadphase& broadphase = listed.get_broadphase();
+    const bool passed = flagMismatches == 0 && maxError < 1e-9 && scheduleMismatches == 0;
+    std::printf("neighbor list check (%s, skin %.1f): %llu rebuilds in %d ticks, %zu listed pairs for %llu candidates, "
+        "%.3f vs %.3f ms/tick, %zu flag mismatches, max relative error %.3g, %zu schedule mismatches %s\n",
+        layout_name(layout), SKIN, (unsigned long long)broadphase.get_rebuild_count(), TICKS, broadphase.get_neighbor_pairs(),
+        (unsigned long long)broadphase.get_candidate_pairs(), listedSeconds * 1000.0 / TICKS, queriedSeconds * 1000.0 / TICKS,
+        flagMismatches, maxError, scheduleMismatches, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+
+/**
+ * Spreads the magnets of a scene over three magnetic layers with random masks, and checks that both solvers honour
+ * them: Pairwise against brute force, and Octree with a zero opening angle (exact evaluation) against Pairwise.
+ *
+ * @return True if both solvers match the brute-force results.
+ */
+static bool check_layers(SceneLayout layout) {
+    MagnetSolver solver;
+    generate_scene(solver.get_snapshot(), 1000, layout, 13);
+    MagnetSnapshot& snapshot = solver.get_snapshot();
+    solver.solve();
+    const uint64_t unlayeredCandidates = solver.get_broadphase().get_candidate_pairs();
+
+    std::mt19937 rng(17);
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        snapshot.layer[i] = 1u << (rng() % 3);
+        snapshot.mask[i] = 1 + rng() % 7;
+    }
+    solver.invalidate();
+    bool passed = check_solver(solver);
+    const uint64_t layeredCandidates = solver.get_broadphase().get_candidate_pairs();
+
+    MagnetSolver octree;
+    octree.set_mode(MAGNET_SOLVER_OCTREE);
+    octree.get_octree().set_opening_angle(0.0);
+    octree.get_snapshot() = snapshot;
+    octree.solve();
+    double maxError = 0.0;
+    size_t flagMismatches = 0;
+    const MagnetSnapshot& approximated = octree.get_snapshot();
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        if (!snapshot.on[i]) continue;
+        if (approximated.influenced[i] != snapshot.influenced[i]) flagMismatches++;
+        const double scale = std::max({ 1e-6, std::fabs(snapshot.forceX[i]), std::fabs(snapshot.forceY[i]), std::fabs(snapshot.forceZ[i]) });
+        maxError = std::max({ maxError,
+            std::fabs(approximated.forceX[i] - snapshot.forceX[i]) / scale,
+            std::fabs(approximated.forceY[i] - snapshot.forceY[i]) / scale,
+            std::fabs(approximated.forceZ[i] - snapshot.forceZ[i]) / scale });
+    }
+
+    passed = passed && flagMismatches == 0 && maxError < 1e-9;
+    std::printf("layer check (%s): %llu of %llu candidate pairs left after layer rejection, octree %zu flag mismatches, max relative error %.3g %s\n",
+        layout_name(layout), (unsigned long long)layeredCandidates, (unsigned long long)unlayeredCandidates, flagMismatches, maxError,
+        passed ? "ok" : "FAILED");
+    return passed;
+}
+
+
+/**
+ * Turns a few magnets of a scene into strong coils and solves it with a force threshold cutoff. Compares the results
+ * with a brute-force evaluation of the cutoff model, and reports how many pairs the cutoff removes and how much it
+ * changes the net forces.
+ *
+ * @return True if the flags match exactly and the vectors agree within tolerance.
+ */
+static bool check_cutoff(SceneLayout layout) {
+    constexpr double MIN_FORCE = 0.05;
+
+    MagnetSolver full;
+    generate_scene(full.get_snapshot(), 1000, layout, 29);
+    MagnetSnapshot& scene = full.get_snapshot();
+    for (size_t i = 0; i < scene.size(); i += 20) {
+        scene.type[i] = MAGNET_ELECTROMAGNET;
+        scene.on[i] = 1;
+        scene.strength[i] = 5.0;
+        scene.radiusSqr[i] = magnet_influence_radius_sqr(scene.strength[i]);
+    }
+    full.solve();
+
+    MagnetSolver solver;
+    solver.set_min_force(MIN_FORCE);
+    solver.get_snapshot() = scene;
+    solver.solve();
+    const MagnetSnapshot& snapshot = solver.get_snapshot();
+
+    const double innerFraction = 1.0 - solver.get_cutoff_falloff();
+    double maxError = 0.0;
+    double maxChange = 0.0;
+    size_t flagMismatches = 0;
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        if (!snapshot.on[i]) continue;
+        MagnetVector force, torque;
+        bool influenced = false;
+        for (size_t j = 0; j < snapshot.size(); j++) {
+            if (j == i || !snapshot.will_be_influenced_by(i, j)) continue;
+            const MagnetVector separation{ snapshot.posX[j] - snapshot.posX[i], snapshot.posY[j] - snapshot.posY[i], snapshot.posZ[j] - snapshot.posZ[i] };
+            const double distanceSqr = separation.x * separation.x + separation.y * separation.y + separation.z * separation.z;
+            const double cutoffSqr = magnet_cutoff_radius_sqr(snapshot.strength[i], snapshot.strength[j], MIN_FORCE);
+            if (distanceSqr > cutoffSqr) continue;
+            const double weight = magnet_cutoff_weight(distanceSqr, cutoffSqr, cutoffSqr * innerFraction * innerFraction);
+            const MagnetVector f = snapshot.calculate_force(i, j);
+            const MagnetVector t = snapshot.calculate_torque(i, j);
+            force.x += f.x * weight; force.y += f.y * weight; force.z += f.z * weight;
+            torque.x += t.x * weight; torque.y += t.y * weight; torque.z += t.z * weight;
+            influenced = true;
+        }
+
+        if (influenced != (snapshot.influenced[i] != 0)) flagMismatches++;
+        const double scale = std::max({ 1e-6, std::fabs(force.x), std::fabs(force.y), std::fabs(force.z) });
+        const double torqueScale = std::max({ 1e-6, std::fabs(torque.x), std::fabs(torque.y), std::fabs(torque.z) });
+        maxError = std::max({ maxError,
+            std::fabs(snapshot.forceX[i] - force.x) / scale,
+            std::fabs(snapshot.forceY[i] - force.y) / scale,
+            std::fabs(snapshot.forceZ[i] - force.z) / scale,
+            std::fabs(snapshot.torqueX[i] - torque.x) / torqueScale,
+            std::fabs(snapshot.torqueY[i] - torque.y) / torqueScale,
+            std::fabs(snapshot.torqueZ[i] - torque.z) / torqueScale });
+
+        const double dx = snapshot.forceX[i] - scene.forceX[i];
+        const double dy = snapshot.forceY[i] - scene.forceY[i];
+        const double dz = snapshot.forceZ[i] - scene.forceZ[i];
+        maxChange = std::max(maxChange, std::sqrt(dx * dx + dy * dy + dz * dz));
+    }
+
+    const bool passed = flagMismatches == 0 && maxError < 1e-9;
+    std::printf("cutoff check (%s, min force %.2f): %llu of %llu candidate pairs kept, max net force change %.3g, "
+        "%zu flag mismatches, max relative error %.3g %s\n",
+        layout_name(layout), MIN_FORCE, (unsigned long long)solver.get_broadphase().get_candidate_pairs(),
+        (unsigned long long)full.get_broadphase().get_candidate_pairs(), maxChange, flagMismatches, maxError, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+
+/**
+ * Solves every 25th magnet of a scene as a subset of it, as done for synchronous magnets while the rest of the scene
+ * is solved pipelined, and compares their results with a solve of the whole scene.
+ *
+ * @return True if the selected magnets' flags match exactly and their vectors agree within tolerance.
+ */
+static bool check_subset(SceneLayout layout) {
+    MagnetSolver full;
+    full.set_incremental(false);
+    generate_scene(full.get_snapshot(), 1000, layout, 31);
+    full.solve();
+    const MagnetSnapshot& reference = full.get_snapshot();
+
+    std::vector<uint32_t> selected;
+    for (uint32_t i = 0; i < reference.size(); i += 25) {
+        selected.push_back(i);
+    }
+    MagnetSolver subset;
+    subset.set_incremental(false);
+    subset.copy_settings(full);
+    subset.solve_subset(reference, selected);
+    const MagnetSnapshot& snapshot = subset.get_snapshot();
+
+    double maxError = 0.0;
+    size_t flagMismatches = 0;
+    for (size_t k = 0; k < selected.size(); k++) {
+        const uint32_t i = selected[k];
+        if (!reference.on[i]) continue;
+        if (snapshot.influenced[k] != reference.influenced[i]) flagMismatches++;
+        const double scale = std::max({ 1e-6, std::fabs(reference.forceX[i]), std::fabs(reference.forceY[i]), std::fabs(reference.forceZ[i]) });
+        const double torqueScale = std::max({ 1e-6, std::fabs(reference.torqueX[i]), std::fabs(reference.torqueY[i]), std::fabs(reference.torqueZ[i]) });
+        maxError = std::max({ maxError,
+            std::fabs(snapshot.forceX[k] - reference.forceX[i]) / scale,
+            std::fabs(snapshot.forceY[k] - reference.forceY[i]) / scale,
+            std::fabs(snapshot.forceZ[k] - reference.forceZ[i]) / scale,
+            std::fabs(snapshot.torqueX[k] - reference.torqueX[i]) / torqueScale,
+            std::fabs(snapshot.torqueY[k] - reference.torqueY[i]) / torqueScale,
+            std::fabs(snapshot.torqueZ[k] - reference.torqueZ[i]) / torqueScale });
+    }
+
+    const bool passed = flagMismatches == 0 && maxError < 1e-9;
+    std::printf("subset check (%s): %zu selected magnets solved with %zu partners, %zu flag mismatches, "
+        "max relative error %.3g %s\n",
+        layout_name(layout), selected.size(), snapshot.size() - selected.size(), flagMismatches, maxError, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+
+/**
+ * Solves a scene with level-of-detail tiers, first at rest, then drifting, and compares the results with a full solve
+ * every tick. Reports how far the cached weak pairs let the results drift, and how evenly the tiers spread their
+ * evaluations over the ticks, then repeats the drift under an evaluation budget.
+ *
+ * @return True if the results at rest match the full solve within rounding, and the budget is respected.
+ */
+static bool check_lod(SceneLayout layout) {
+    constexpr int TICKS = 24;
+    constexpr double DRIFT = 0.02;
+
+    MagnetSolver lod;
+    MagnetSolver full;
+    lod.set_incremental(false);
+    full.set_incremental(false);
+    lod.set_lod_tiers({ { 0.1, 8 }, { 0.5, 4 }, { 2.0, 2 } });
+    generate_scene(full.get_snapshot(), 1000, layout, 37);
+
+    // Error of the net forces over the whole scene, relative to their magnitude, so magnets whose forces nearly cancel
+    // out do not dominate it.
+    const auto scene_error = [](const MagnetSnapshot& snapshot, const MagnetSnapshot& expected) {
+        double errorSqr = 0.0;
+        double magnitudeSqr = 0.0;
+        for (size_t i = 0; i < snapshot.size(); i++) {
+            const double dx = snapshot.forceX[i] - expected.forceX[i];
+            const double dy = snapshot.forceY[i] - expected.forceY[i];
+            const double dz = snapshot.forceZ[i] - expected.forceZ[i];
+            errorSqr += dx * dx + dy * dy + dz * dz;
+            magnitudeSqr += expected.forceX[i] * expected.forceX[i] + expected.forceY[i] * expected.forceY[i] + expected.forceZ[i] * expected.forceZ[i];
+        }
+        return std::sqrt(errorSqr / std::max(magnitudeSqr, 1e-12));
+    };
+
+    // At rest, cached results equal fresh ones, so only the summation order differs.
+    double restError = 0.0;
+    size_t restCached = 0;
+    full.solve();
+    lod.get_snapshot() = full.get_snapshot();
+    for (int tick = 0; tick < 4; tick++) {
+        lod.solve();
+        restError = std::max(restError, scene_error(lod.get_snapshot(), full.get_snapshot()));
+        restCached = std::max(restCached, lod.get_cached_pairs());
+    }
+
+    // Drifting, cached pairs lag behind by up to their tier's interval.
+    std::mt19937 rng(41);
+    std::uniform_real_distribution<double> drift(-DRIFT, DRIFT);
+    const auto drift_tick = [&](MagnetSolver& solver, double& maxDrift, size_t& minEvaluated, size_t& maxEvaluated) {
+        MagnetSnapshot& snapshot = full.get_snapshot();
+        for (size_t i = 0; i < snapshot.size(); i++) {
+            snapshot.posX[i] += drift(rng);
+            snapshot.posY[i] += drift(rng);
+            snapshot.posZ[i] += drift(rng);
+        }
+        full.solve();
+        MagnetSnapshot& copy = solver.get_snapshot();
+        for (size_t i = 0; i < snapshot.size(); i++) {
+            copy.posX[i] = snapshot.posX[i];
+            copy.posY[i] = snapshot.posY[i];
+            copy.posZ[i] = snapshot.posZ[i];
+        }
+        solver.solve();
+        maxDrift = std::max(maxDrift, scene_error(copy, snapshot));
+        minEvaluated = std::min(minEvaluated, solver.get_evaluated_pairs());
+        maxEvaluated = std::max(maxEvaluated, solver.get_evaluated_pairs());
+    };
+    double maxDrift = 0.0;
+    size_t minEvaluated = SIZE_MAX;
+    size_t maxEvaluated = 0;
+    for (int tick = 0; tick < TICKS; tick++) {
+        drift_tick(lod, maxDrift, minEvaluated, maxEvaluated);
+    }
+    const size_t fullPairs = full.get_evaluated_pairs();
+
+    // Under a budget, no tick evaluates more than the budget, unless the full-rate pairs alone exceed it.
+    const uint32_t budget = static_cast<uint32_t>(maxEvaluated / 2);
+    lod.set_lod_budget(budget);
+    double budgetDrift = 0.0;
+    size_t budgetMin = SIZE_MAX;
+    size_t budgetMax = 0;
+    size_t deferred = 0;
+    bool withinBudget = true;
+    for (int tick = 0; tick < TICKS; tick++) {
+        drift_tick(lod, budgetDrift, budgetMin, budgetMax);
+        deferred += lod.get_deferred_pairs();
+        withinBudget = withinBudget && (lod.get_evaluated_pairs() <= budget || lod.get_deferred_pairs() == 0);
+    }
+
+    const bool passed = restError < 1e-9 && restCached > 0 && withinBudget;
+    std::printf("lod check (%s): %zu cached pairs at rest, max relative error %.3g; drifting %zu-%zu of %zu pairs evaluated per tick, "
+        "max relative drift %.3g; budget %u: %zu-%zu evaluated, %zu deferred, max relative drift %.3g %s\n",
+        layout_name(layout), restCached, restError, minEvaluated, maxEvaluated, fullPairs, maxDrift, budget, budgetMin, budgetMax,
+        deferred, budgetDrift, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+
+/**
+ * Compares a float-precision Pairwise solve with the double-precision reference on the same scene.
+ * Influence flags can differ only for pairs within rounding of a sphere of influence boundary, so a small fraction
+ * of mismatches is tolerated.
+ *
+ * @return True if the float results agree within tolerance.
+ */
+static bool check_precision(const MagnetSolver& reference) {
+    MagnetSolver solver;
+    solver.set_precision(MAGNET_PRECISION_FLOAT);
+    solver.get_snapshot() = reference.get_snapshot();
+    solver.solve();
+
+    const MagnetSnapshot& expected = reference.get_snapshot();
+    const MagnetSnapshot& snapshot = solver.get_snapshot();
+    double maxError = 0.0;
+    size_t flagMismatches = 0;
+    size_t compared = 0;
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        if (!snapshot.on[i]) continue;
+        compared++;
+        if (snapshot.influenced[i] != expected.influenced[i]) flagMismatches++;
+        const double scale = std::max({ 1e-6, std::fabs(expected.forceX[i]), std::fabs(expected.forceY[i]), std::fabs(expected.forceZ[i]) });
+        const double torqueScale = std::max({ 1e-6, std::fabs(expected.torqueX[i]), std::fabs(expected.torqueY[i]), std::fabs(expected.torqueZ[i]) });
+        maxError = std::max({ maxError,
+            std::fabs(snapshot.forceX[i] - expected.forceX[i]) / scale,
+            std::fabs(snapshot.forceY[i] - expected.forceY[i]) / scale,
+            std::fabs(snapshot.forceZ[i] - expected.forceZ[i]) / scale,
+            std::fabs(snapshot.torqueX[i] - expected.torqueX[i]) / torqueScale,
+            std::fabs(snapshot.torqueY[i] - expected.torqueY[i]) / torqueScale,
+            std::fabs(snapshot.torqueZ[i] - expected.torqueZ[i]) / torqueScale });
+    }
+
+    const bool passed = flagMismatches * 1000 <= compared && maxError < 1e-3;
+    std::printf("precision check (float vs double, %zu magnets): %zu flag mismatches, max relative error %.3g %s\n",
+        snapshot.size(), flagMismatches, maxError, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+
+/**
+ * Samples forces and fields at random points of a solved scene with MagnetSolver::sample_field, compares them with
+ * brute-force evaluation of every magnet through the shared model, and reports the sampling time.
+ *
+ * @return True if both kinds of samples agree within tolerance.
+ */
+static bool check_field_query(SceneLayout layout, const MagnetTaskRunner& runner) {
+    using Clock = std::chrono::steady_clock;
+    constexpr size_t SAMPLES = 10000;
+
+    MagnetSolver solver;
+    generate_scene(solver.get_snapshot(), 1000, layout, 17);
+    solver.solve(runner);
+    const MagnetSnapshot& snapshot = solver.get_snapshot();
+
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    const double extent = MAGNET_SPACING * std::cbrt(double(snapshot.size()));
+    std::vector<MagnetVector> points(SAMPLES);
+    for (MagnetVector& point : points) {
+        point = MagnetVector{ unit(rng) * extent, unit(rng) * extent, unit(rng) * extent };
+    }
+    const MagnetVector axis{ 0.0, 0.6, 0.8 };
+
+    std::vector<MagnetVector> forces(SAMPLES), fields(SAMPLES);
+    const Clock::time_point start = Clock::now();
+    solver.sample_field(points.data(), SAMPLES, &axis, forces.data(), runner);
+    const double forceMsec = std::chrono::duration<double>(Clock::now() - start).count() * 1000.0;
+    solver.sample_field(points.data(), SAMPLES, nullptr, fields.data(), runner);
+
+    // The field must reproduce the torque of every source on the probe: axis x field.
+    double maxError = 0.0;
+    for (size_t p = 0; p < SAMPLES; p++) {
+        MagnetVector force, torque;
+        for (size_t j = 0; j < snapshot.size(); j++) {
+            if (!snapshot.on[j]) continue;
+            const MagnetVector separation{ snapshot.posX[j] - points[p].x, snapshot.posY[j] - points[p].y, snapshot.posZ[j] - points[p].z };
+            if (separation.x * separation.x + separation.y * separation.y + separation.z * separation.z > snapshot.radiusSqr[j]) continue;
+            const MagnetVector f = magnet_calculate_force(separation, axis, 1.0, snapshot.axis(j), snapshot.strength[j]);
+            const MagnetVector t = magnet_calculate_torque(separation, axis, 1.0, snapshot.axis(j), snapshot.strength[j]);
+            force.x += f.x; force.y += f.y; force.z += f.z;
+            torque.x += t.x; torque.y += t.y; torque.z += t.z;
+        }
+        const MagnetVector& field = fields[p];
+        const MagnetVector fieldTorque{ axis.y * field.z - axis.z * field.y, axis.z * field.x - axis.x * field.z, axis.x * field.y - axis.y * field.x };
+        const double scale = std::max({ 1e-6, std::fabs(force.x), std::fabs(force.y), std::fabs(force.z) });
+        const double torqueScale = std::max({ 1e-6, std::fabs(torque.x), std::fabs(torque.y), std::fabs(torque.z) });
+        maxError = std::max({ maxError,
+            std::fabs(forces[p].x - force.x) / scale, std::fabs(forces[p].y - force.y) / scale, std::fabs(forces[p].z - force.z) / scale,
+            std::fabs(fieldTorque.x - torque.x) / torqueScale, std::fabs(fieldTorque.y - torque.y) / torqueScale,
+            std::fabs(fieldTorque.z - torque.z) / torqueScale });
+    }
+
+    const bool passed = maxError < 1e-9;
+    std::printf("field query check (%s, %zu samples in %.2f ms): max relative error %.3g %s\n",
+        layout_name(layout), SAMPLES, forceMsec, maxError, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+
+// --- Recordings ---
+
+/**
+ * Outcome of replaying a recording.
+ */
+struct ReplayResult {
+    size_t frames = 0;
+    size_t skippedFrames = 0;
+    size_t magnets = 0;
+    size_t mismatches = 0;
+    double maxError = 0.0;
+    double solveSeconds = 0.0;
+};
+
+/**
+ * Solves every frame of a recording with its recorded settings and compares the results with the recorded ones.
+ * Frames whose results include a baked static field, or cached LOD pair results, are solved but not compared, as
+ * neither the field nor the cached results are recorded.
+ *
+ * @param path The recording.
+ * @param runner Runs the solver's tasks.
+ * @param result Receives the totals.
+ * @return True if the recording could be read.
+ */
+static bool replay_recording(const std::string& path, const MagnetTaskRunner& runner, ReplayResult& result) {
+    using Clock = std::chrono::steady_clock;
+    MagnetRecordReader reader;
+    if (!reader.open(path)) return false;
+
+    MagnetSolver solver;
+    for (size_t f = 0; f < reader.get_frame_count(); f++) {
+        const MagnetRecordFrame frame = reader.get_frame(f);
+        frame.load_settings(solver);
+        frame.load_state(solver.get_snapshot());
+
+        const Clock::time_point start = Clock::now();
+        solver.solve(runner);
+        result.solveSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+        result.frames++;
+        result.magnets = std::max<size_t>(result.magnets, frame.header.magnetCount);
+        if (frame.header.flags & (MAGNET_RECORD_STATIC_FIELD | MAGNET_RECORD_LOD)) {
+            result.skippedFrames++;
+            continue;
+        }
+
+        // Same build and settings reproduce the recorded results exactly; other builds are held to a tolerance.
+        const MagnetSnapshot& snapshot = solver.get_snapshot();
+        for (size_t i = 0; i < snapshot.size(); i++) {
+            if (!snapshot.on[i]) continue;
+            const double scale = std::max({ 1e-6, std::fabs(frame.forceX[i]), std::fabs(frame.forceY[i]), std::fabs(frame.forceZ[i]) });
+            const double torqueScale = std::max({ 1e-6, std::fabs(frame.torqueX[i]), std::fabs(frame.torqueY[i]), std::fabs(frame.torqueZ[i]) });
+            const double error = std::max({
+                std::fabs(snapshot.forceX[i] - frame.forceX[i]) / scale,
+                std::fabs(snapshot.forceY[i] - frame.forceY[i]) / scale,
+                std::fabs(snapshot.forceZ[i] - frame.forceZ[i]) / scale,
+                std::fabs(snapshot.torqueX[i] - frame.torqueX[i]) / torqueScale,
+                std::fabs(snapshot.torqueY[i] - frame.torqueY[i]) / torqueScale,
+                std::fabs(snapshot.torqueZ[i] - frame.torqueZ[i]) / torqueScale });
+            result.maxError = std::max(result.maxError, error);
+            if (error > 1e-9 || snapshot.influenced[i] != frame.influenced[i]) result.mismatches++;
+        }
+    }
+    return true;
+}
+
+/**
+ * Solves a close pair of magnets starting at rest, as a settled projectile next to a coil switching on, with stiff
+ * pair sub-stepping. Compares the force averaged over the tick with a fine integration of the same pair.
+ *
+ * @return True if the pair is sub-stepped and its averaged force matches the fine integration within tolerance.
+ */
+static bool check_substep_from_rest() {
+    constexpr double TIMESTEP = 1.0 / 60.0;
+    constexpr double SEPARATION = 0.5;
+    constexpr int REFERENCE_STEPS = 100000;
+
+    MagnetSolver solver;
+    solver.set_incremental(false);
+    solver.set_substep_distance(1.0);
+    solver.set_timestep(TIMESTEP);
+    MagnetSnapshot& snapshot = solver.get_snapshot();
+    generate_scene(snapshot, 2, LAYOUT_UNIFORM, 43);
+    for (size_t i = 0; i < 2; i++) {
+        snapshot.type[i] = MAGNET_PERMANENT;
+        snapshot.on[i] = 1;
+        snapshot.strength[i] = 1.0;
+        snapshot.radiusSqr[i] = magnet_influence_radius_sqr(snapshot.strength[i]);
+        snapshot.layer[i] = MAGNET_DEFAULT_LAYERS;
+        snapshot.mask[i] = MAGNET_DEFAULT_LAYERS;
+        snapshot.posX[i] = snapshot.posY[i] = 0.0;
+        snapshot.posZ[i] = i * SEPARATION;
+        snapshot.axisX[i] = snapshot.axisY[i] = 0.0;
+        snapshot.axisZ[i] = 1.0;
+        snapshot.velX[i] = snapshot.velY[i] = snapshot.velZ[i] = 0.0;
+        snapshot.inverseMass[i] = 1.0;
+    }
+    solver.solve();
+
+    // Fine semi-implicit Euler integration of the pair alone, averaging the force on the first magnet.
+    const MagnetVector axis{ 0.0, 0.0, 1.0 };
+    const double h = TIMESTEP / REFERENCE_STEPS;
+    double gap = SEPARATION;
+    double closing = 0.0;
+    double forceSum = 0.0;
+    for (int step = 0; step < REFERENCE_STEPS; step++) {
+        const double force = magnet_calculate_force(MagnetVector{ 0.0, 0.0, gap }, axis, 1.0, axis, 1.0).z;
+        forceSum += force * h;
+        closing += h * 2.0 * force;
+        gap -= h * closing;
+    }
+    const double expected = forceSum / TIMESTEP;
+    const double single = magnet_calculate_force(MagnetVector{ 0.0, 0.0, SEPARATION }, axis, 1.0, axis, 1.0).z;
+    const double error = std::fabs(snapshot.forceZ[0] - expected) / std::fabs(expected);
+    const double singleError = std::fabs(single - expected) / std::fabs(expected);
+
+    const bool passed = solver.get_substepped_pairs() == 1 && error < 0.05;
+    std::printf("substep check (pair at rest): %zu sub-stepped pairs, relative error %.3g vs %.3g for a single evaluation %s\n",
+        solver.get_substepped_pairs(), error, singleError, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+
+/**
+ * Records a few ticks of a moving scene, first in Pairwise mode with a pair cutoff (and LOD tiers for two ticks),
+ * then in Octree mode with a non-default opening angle, then replays the recording.
+ *
+ * @return True if every frame was read back and reproduces the recorded results.
+ */
+static bool check_recording() {
+    constexpr int TICKS = 8;
+    const std::string path = (std::filesystem::temp_directory_path() / "magnetism_benchmark.magrec").string();
+
+    MagnetSolver solver;
+    solver.set_substep_distance(1.0);
+    solver.set_timestep(1.0 / 60.0);
+    solver.set_min_force(0.05);
+    solver.set_cutoff_falloff(0.2);
+    generate_scene(solver.get_snapshot(), 1000, LAYOUT_CLUSTERED, 13);
+    MagnetSnapshot& snapshot = solver.get_snapshot();
+    std::vector<uint64_t> ids(snapshot.size());
+    for (size_t i = 0; i < ids.size(); i++) ids[i] = 1000 + i;
+
+    MagnetRecordWriter writer;
+    if (!writer.open(path)) {
+        std::printf("recording check: could not create %s FAILED\n", path.c_str());
+        return false;
+    }
+    for (int tick = 0; tick < TICKS; tick++) {
+        if (tick == TICKS / 2 - 2) {
+            solver.set_lod_tiers({ { 0.5, 4 } });
+        }
+        if (tick == TICKS / 2) {
+            solver.set_lod_tiers({});
+            solver.set_mode(MAGNET_SOLVER_OCTREE);
+            solver.get_octree().set_opening_angle(0.8);
+            solver.invalidate();
+
+            // Stronger magnets reach far enough for whole octree nodes to be approximated.
+            for (size_t i = 0; i < snapshot.size(); i++) {
+                snapshot.strength[i] *= 4.0;
+                snapshot.radiusSqr[i] = magnet_influence_radius_sqr(snapshot.strength[i]);
+            }
+        }
+        for (size_t i = tick; i < snapshot.size(); i += TICKS) {
+            snapshot.posX[i] += 0.1;
+        }
+        solver.solve();
+        writer.write_frame(snapshot, ids.data(), solver, 0);
+    }
+    const uint64_t bytes = writer.get_byte_count();
+    const bool written = writer.close();
+
+    ReplayResult result;
+    const bool read = replay_recording(path, magnet_run_tasks_serial, result);
+    std::filesystem::remove(path);
+
+    const bool passed = written && read && result.frames == TICKS && result.skippedFrames == 2 && result.mismatches == 0;
+    std::printf("recording check (%d ticks, %llu bytes): %zu frames replayed, %zu LOD frames not compared, %zu mismatches %s\n",
+        TICKS, (unsigned long long)bytes, result.frames, result.skippedFrames, result.mismatches, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+
+/**
+ * Bakes a few static permanent magnets into field grids of increasing resolution and reports how far the sampled
+ * forces of random probe magnets are from exact pair evaluation.
+ * The grid is an approximation, so only the coverage is checked; the force error is reported for tuning.
+ *
+ * @return True if the finest grid's coverage agrees with the exact spheres of influence for nearly every probe.
+ */
+static bool report_static_field() {
+    constexpr double EXTENT = 40.0;
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    // Static magnets in the middle of the region, and probe magnets of every type anywhere in it.
+    MagnetSnapshot sources;
+    generate_scene(sources, 8, LAYOUT_UNIFORM, 3);
+    for (size_t j = 0; j < sources.size(); j++) {
+        sources.posX[j] = EXTENT * (0.25 + 0.5 * unit(rng));
+        sources.posY[j] = EXTENT * (0.25 + 0.5 * unit(rng));
+        sources.posZ[j] = EXTENT * (0.25 + 0.5 * unit(rng));
+        sources.type[j] = MAGNET_PERMANENT;
+        sources.strength[j] = 0.5 + 0.5 * unit(rng);
+        sources.radiusSqr[j] = magnet_influence_radius_sqr(sources.strength[j]);
+        sources.on[j] = 1;
+    }
+    MagnetSnapshot probes;
+    generate_scene(probes, 2000, LAYOUT_UNIFORM, 4);
+    for (size_t i = 0; i < probes.size(); i++) {
+        probes.posX[i] = EXTENT * unit(rng);
+        probes.posY[i] = EXTENT * unit(rng);
+        probes.posZ[i] = EXTENT * unit(rng);
+    }
+
+    bool passed = true;
+    for (uint32_t resolution : { 16u, 32u, 64u }) {
+        MagnetFieldGrid grid;
+        grid.configure(MagnetVector{ 0.0, 0.0, 0.0 }, MagnetVector{ EXTENT, EXTENT, EXTENT }, resolution, resolution, resolution);
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        grid.bake(sources);
+        const double bakeMsec = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::vector<double> errors;
+        size_t coverageMismatches = 0;
+        for (size_t i = 0; i < probes.size(); i++) {
+            const MagnetVector position = probes.position(i);
+            const MagnetVector axis = probes.axis(i);
+
+            // Exact reference through the shared model. Probes near a static magnet are skipped: no grid resolves the
+            // singularity, and in a scene the magnets' colliders keep them apart anyway.
+            MagnetVector exact;
+            bool covered = false, nearSource = false;
+            for (size_t j = 0; j < sources.size(); j++) {
+                const MagnetVector r{ sources.posX[j] - position.x, sources.posY[j] - position.y, sources.posZ[j] - position.z };
+                const double distanceSqr = r.x * r.x + r.y * r.y + r.z * r.z;
+                nearSource = nearSource || distanceSqr < 4.0;
+                if (distanceSqr > sources.radiusSqr[j]) continue;
+                const MagnetVector f = magnet_calculate_force(r, axis, probes.strength[i], sources.axis(j), sources.strength[j]);
+                exact.x += f.x; exact.y += f.y; exact.z += f.z;
+                covered = true;
+            }
+            if (nearSource) continue;
+
+            MagnetVector force, torque;
+            const bool sampled = grid.sample(position, axis, probes.strength[i], force, torque);
+            if (sampled != covered) {
+                coverageMismatches++;
+                continue;
+            }
+            if (!covered) continue;
+
+            const double dx = force.x - exact.x, dy = force.y - exact.y, dz = force.z - exact.z;
+            const double exactLength = std::sqrt(exact.x * exact.x + exact.y * exact.y + exact.z * exact.z);
+            errors.push_back(std::sqrt(dx * dx + dy * dy + dz * dz) / std::max(1e-9, exactLength));
+        }
+
+        std::sort(errors.begin(), errors.end());
+        const double median = errors.empty() ? 0.0 : errors[errors.size() / 2];
+        const double p95 = errors.empty() ? 0.0 : errors[errors.size() * 95 / 100];
+
+        // Coverage is interpolated, so probes right at the edge of a sphere of influence may fall either way.
+        const bool resolutionPassed = resolution < 64 || coverageMismatches * 100 <= probes.size();
+        passed = passed && resolutionPassed;
+        std::printf("static field (%u^3 grid, %zu sources, bake %.1f ms): force error median %.3g, p95 %.3g, %zu coverage mismatches %s\n",
+            resolution, sources.size(), bakeMsec, median, p95, coverageMismatches, resolutionPassed ? "ok" : "FAILED");
+    }
+    return passed;
+}
+
+
+// --- Benchmark ---
+
+/**
+ * Solves one scene repeatedly and prints the average cost per tick.
+ */
+static void run_case(MagnetSolver& solver, MagnetSolverMode mode, MagnetPrecision precision, SceneLayout layout, const MagnetTaskRunner& runner, int ticks) {
+    using Clock = std::chrono::steady_clock;
+    solver.set_mode(mode);
+    solver.set_precision(precision);
+
+    // Every tick is timed as a full solve; an unchanged scene would otherwise reuse all results.
+    solver.set_incremental(false);
+
+    // Warm up once, so allocations are not timed.
+    solver.solve(runner);
+
+    const Clock::time_point start = Clock::now();
+    for (int tick = 0; tick < ticks; tick++) {
+        solver.solve(runner);
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    const double msPerTick = seconds * 1000.0 / ticks;
+
+    // Pair evaluations: candidate pairs in Pairwise mode, exact plus far-field interactions in Octree mode.
+    uint64_t evaluations;
+    if (mode == MAGNET_SOLVER_OCTREE) {
+        evaluations = solver.get_octree().get_exact_evaluations() + solver.get_octree().get_far_field_evaluations();
+    } else {
+        evaluations = solver.get_broadphase().get_candidate_pairs();
+    }
+    const double nsPerPair = evaluations > 0 ? seconds * 1e9 / (double(evaluations) * ticks) : 0.0;
+
+    std::printf("%8zu  %-9s  %-8s  %-9s  %14llu  %10.2f  %10.3f\n",
+        solver.get_snapshot().size(), layout_name(layout), mode == MAGNET_SOLVER_OCTREE ? "octree" : "pairwise",
+        precision == MAGNET_PRECISION_FLOAT ? "float" : "double", (unsigned long long)evaluations, nsPerPair, msPerTick);
+}
+
+int main(int argc, char** argv) {
+    unsigned threadCount = 1;
+    size_t maxMagnets = 100000;
+    int ticks = 5;
+    const char* replayPath = nullptr;
+
+    for (int a = 1; a < argc; a++) {
+        if (std::strcmp(argv[a], "--threads") == 0 && a + 1 < argc) {
+            threadCount = static_cast<unsigned>(std::atoi(argv[++a]));
+            if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+        } else if (std::strcmp(argv[a], "--max-magnets") == 0 && a + 1 < argc) {
+            maxMagnets = static_cast<size_t>(std::atoll(argv[++a]));
+        } else if (std::strcmp(argv[a], "--ticks") == 0 && a + 1 < argc) {
+            ticks = std::max(1, std::atoi(argv[++a]));
+        } else if (std::strcmp(argv[a], "--replay") == 0 && a + 1 < argc) {
+            replayPath = argv[++a];
+        } else {
+            std::fprintf(stderr, "usage: %s [--threads N (0 = all cores)] [--max-magnets N] [--ticks N] [--replay FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const ThreadTaskRunner threadRunner(threadCount);
+    const MagnetTaskRunner runner = [&threadRunner](uint32_t taskCount, const MagnetTaskFunction& task) {
+        threadRunner(taskCount, task);
+    };
+
+    // Replay a recorded session instead of the synthetic scenes.
+    if (replayPath != nullptr) {
+        ReplayResult result;
+        if (!replay_recording(replayPath, runner, result)) {
+            std::fprintf(stderr, "could not read recording %s\n", replayPath);
+            return 2;
+        }
+        std::printf("replay (%s, threads: %u): %zu frames, up to %zu magnets, %.3f ms/frame\n", magnet_batch_kernel_isa(), threadCount,
+            result.frames, result.magnets, result.frames > 0 ? result.solveSeconds * 1000.0 / result.frames : 0.0);
+        std::printf("diff against recorded results: %zu mismatching magnets, max relative error %.3g, %zu frames with a static field or LOD not compared\n",
+            result.mismatches, result.maxError, result.skippedFrames);
+        return result.mismatches == 0 ? 0 : 1;
+    }
+
+    // Accuracy checks on small scenes.
+    bool passed = true;
+    for (SceneLayout layout : { LAYOUT_UNIFORM, LAYOUT_CLUSTERED }) {
+        MagnetSolver solver;
+        generate_scene(solver.get_snapshot(), 1000, layout, 7);
+        passed = check_kernel(solver.get_snapshot()) && passed;
+        passed = check_interaction(solver.get_snapshot()) && passed;
+        passed = check_solver(solver) && passed;
+        passed = check_precision(solver) && passed;
+        passed = check_incremental(layout) && passed;
+        passed = check_layers(layout) && passed;
+        passed = check_neighbor_list(layout) && passed;
+        passed = check_cutoff(layout) && passed;
+        passed = check_subset(layout) && passed;
+        passed = check_lod(layout) && passed;
+        passed = check_field_query(layout, runner) && passed;
+    }
+    passed = check_substep_from_rest() && passed;
+    passed = check_recording() && passed;
+    passed = report_static_field() && passed;
+    if (!passed) {
+        return 1;
+    }
+
+    std::printf("\nkernel: %s, threads: %u, ticks per case: %d\n", magnet_batch_kernel_isa(), threadCount, ticks);
+    std::printf("%8s  %-9s  %-8s  %-9s  %14s  %10s  %10s\n", "magnets", "layout", "mode", "precision", "pair evals", "ns/pair", "ms/tick");
+    for (size_t count = 100; count <= maxMagnets; count *= 10) {
+        for (SceneLayout layout : { LAYOUT_UNIFORM, LAYOUT_CLUSTERED }) {
+            MagnetSolver solver;
+            generate_scene(solver.get_snapshot(), count, layout, 42);
+            run_case(solver, MAGNET_SOLVER_PAIRWISE, MAGNET_PRECISION_DOUBLE, layout, runner, ticks);
+            run_case(solver, MAGNET_SOLVER_PAIRWISE, MAGNET_PRECISION_FLOAT, layout, runner, ticks);
+            run_case(solver, MAGNET_SOLVER_OCTREE, MAGNET_PRECISION_DOUBLE, layout, runner, ticks);
+        }
+    }
+    return 0;
+}
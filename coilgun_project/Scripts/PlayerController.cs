@@ -99,7 +99,7 @@ public partial class PlayerController : CharacterBody3D
     {
 		if (@event.IsActionPressed("interact"))
         {
-			coilgunNode.Call("fire_coilgun");
+			coilgunNode.Call("fire");
         }
     }
 
@@ -0,0 +1,240 @@
+#include "coilguncontroller.h"
+#include <godot_cpp/classes/engine.hpp>
+#include <godot_cpp/core/object.hpp>
+#include <algorithm>
+
+using namespace godot;
+
+// --- Godot bindings ---
+
+void CoilgunController::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("fire"), &CoilgunController::fire);
+
+    ClassDB::bind_method(D_METHOD("set_projectile_scene", "scene"), &CoilgunController::set_projectile_scene);
+    ClassDB::bind_method(D_METHOD("get_projectile_scene"), &CoilgunController::get_projectile_scene);
+
+    ClassDB::bind_method(D_METHOD("set_spawn_point", "spawn_point"), &CoilgunController::set_spawn_point);
+    ClassDB::bind_method(D_METHOD("get_spawn_point"), &CoilgunController::get_spawn_point);
+
+    ClassDB::bind_method(D_METHOD("set_physics_steps_per_activation", "steps"), &CoilgunController::set_physics_steps_per_activation);
+    ClassDB::bind_method(D_METHOD("get_physics_steps_per_activation"), &CoilgunController::get_physics_steps_per_activation);
+
+    ClassDB::bind_method(D_METHOD("set_max_projectile_speed", "speed"), &CoilgunController::set_max_projectile_speed);
+    ClassDB::bind_method(D_METHOD("get_max_projectile_speed"), &CoilgunController::get_max_projectile_speed);
+
+    ClassDB::bind_method(D_METHOD("set_projectile_lifetime", "lifetime"), &CoilgunController::set_projectile_lifetime);
+    ClassDB::bind_method(D_METHOD("get_projectile_lifetime"), &CoilgunController::get_projectile_lifetime);
+
+    ClassDB::bind_method(D_METHOD("set_pool_size", "size"), &CoilgunController::set_pool_size);
+    ClassDB::bind_method(D_METHOD("get_pool_size"), &CoilgunController::get_pool_size);
+
+    ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "projectile_scene", PROPERTY_HINT_RESOURCE_TYPE, "PackedScene"), "set_projectile_scene", "get_projectile_scene");
+    ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "spawn_point", PROPERTY_HINT_NODE_TYPE, "Node3D"), "set_spawn_point", "get_spawn_point");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "physics_steps_per_activation", PROPERTY_HINT_RANGE, "1,60,1,or_greater"), "set_physics_steps_per_activation", "get_physics_steps_per_activation");
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "max_projectile_speed", PROPERTY_HINT_RANGE, "0.1,1000,0.1,or_greater"), "set_max_projectile_speed", "get_max_projectile_speed");
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "projectile_lifetime", PROPERTY_HINT_RANGE, "0,60,0.1,or_greater"), "set_projectile_lifetime", "get_projectile_lifetime");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "pool_size", PROPERTY_HINT_RANGE, "1,64,1,or_greater"), "set_pool_size", "get_pool_size");
+
+    ADD_SIGNAL(MethodInfo("fired", PropertyInfo(Variant::OBJECT, "projectile", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_DEFAULT, "MagneticBody3D")));
+    ADD_SIGNAL(MethodInfo("finished"));
+}
+
+
+// --- Core coilgun methods ---
+
+void CoilgunController::_ready() {
+    // The coils are the electromagnet children, ordered once along the barrel.
+    coils.clear();
+    for (int i = 0; i < get_child_count(); i++) {
+        MagneticBody3D* magnet = Object::cast_to<MagneticBody3D>(get_child(i));
+        if (magnet != nullptr && magnet->get_magnet_type() == MagneticBody3D::Electromagnet) {
+            coils.push_back(magnet);
+        }
+    }
+    std::stable_sort(coils.begin(), coils.end(), [](const MagneticBody3D* a, const MagneticBody3D* b) {
+        return a->get_global_position().z > b->get_global_position().z;
+    });
+
+    // Projectiles are instanced and registered once, up front.
+    if (!Engine::get_singleton()->is_editor_hint() && projectileScene.is_valid()) {
+        pool.fill(this, projectileScene, poolSize);
+    }
+}
+
+void CoilgunController::fire() {
+    if (state != Idle) return;
+    reset();
+
+    MagneticBody3D* projectile = spawn_projectile();
+    if (projectile == nullptr) return;
+
+    projectileId = ObjectID(projectile->get_instance_id());
+    settleSteps = 0;
+    state = Settling;
+}
+
+void CoilgunController::_physics_process(double delta) {
+    if (Engine::get_singleton()->is_editor_hint()) return;
+
+    pool.update(delta);
+    if (state == Idle) return;
+
+    MagneticBody3D* projectile = get_projectile();
+
+    if (state == Settling) {
+        // The projectile stays frozen for a few steps, then gets one free step before the first coil switches on.
+        settleSteps++;
+        if (projectile == nullptr) {
+            reset();
+        } else if (settleSteps == SETTLE_FROZEN_STEPS) {
+            projectile->set_deferred("freeze", false);
+        } else if (settleSteps >= SETTLE_STEPS) {
+            state = Firing;
+            currentCoil = -1;
+            stepsRemaining = 0;
+            activate_next_coil();
+            emit_signal("fired", projectile);
+        }
+        return;
+    }
+
+    // Clamp the projectile's speed to prevent extreme physics responses.
+    if (projectile != nullptr) {
+        const Vector3 velocity = projectile->get_linear_velocity();
+        if (velocity.length_squared() > maxProjectileSpeed * maxProjectileSpeed) {
+            projectile->set_linear_velocity(velocity.normalized() * maxProjectileSpeed);
+        }
+    }
+
+    // Coil timing
+    if (stepsRemaining > 0) {
+        stepsRemaining--;
+        if (stepsRemaining == 0) {
+            deactivate_current_coil();
+        }
+    } else if (currentCoil < (int)coils.size() - 1) {
+        activate_next_coil();
+    } else {
+        end_firing_sequence();
+    }
+}
+
+
+// --- Firing sequence ---
+
+MagneticBody3D* CoilgunController::get_projectile() const {
+    return Object::cast_to<MagneticBody3D>(ObjectDB::get_instance(projectileId));
+}
+
+MagneticBody3D* CoilgunController::spawn_projectile() {
+    ERR_FAIL_COND_V_MSG(pool.get_size() == 0, nullptr, "No projectiles pooled; set a projectile scene.");
+
+    // Place it at the spawn point, or behind the first coil.
+    Transform3D transform;
+    if (spawnPoint != nullptr) {
+        transform = spawnPoint->get_global_transform();
+    } else if (!coils.empty()) {
+        transform.origin = coils[0]->get_global_position();
+        transform.origin.z -= 1.0;
+    }
+    return pool.acquire(transform, projectileLifetime);
+}
+
+void CoilgunController::activate_next_coil() {
+    // Coils the projectile has already passed are skipped.
+    const MagneticBody3D* projectile = get_projectile();
+    for (currentCoil++; currentCoil < (int)coils.size(); currentCoil++) {
+        MagneticBody3D* coil = coils[currentCoil];
+        if (projectile != nullptr && is_projectile_valid_for_coil(*coil)) {
+            coil->set_on(true);
+            stepsRemaining = physicsStepsPerActivation;
+            return;
+        }
+    }
+}
+
+void CoilgunController::deactivate_current_coil() {
+    if (currentCoil >= 0 && currentCoil < (int)coils.size()) {
+        coils[currentCoil]->set_on(false);
+    }
+}
+
+bool CoilgunController::is_projectile_valid_for_coil(const MagneticBody3D& coil) const {
+    const Transform3D coilTransform = coil.get_global_transform();
+    const Vector3 toProjectile = get_projectile()->get_global_position() - coilTransform.origin;
+    const Vector3 forward = -coilTransform.basis.get_column(2);
+    return toProjectile.dot(forward) < 0.0;
+}
+
+void CoilgunController::end_firing_sequence() {
+    deactivate_current_coil();
+    state = Idle;
+    currentCoil = -1;
+    stepsRemaining = 0;
+    projectileId = ObjectID();
+    emit_signal("finished");
+}
+
+void CoilgunController::reset() {
+    state = Idle;
+    currentCoil = -1;
+    stepsRemaining = 0;
+    for (MagneticBody3D* coil : coils) {
+        coil->set_on(false);
+    }
+}
+
+
+// --- Getters and setters ---
+
+// Projectile scene
+Ref<PackedScene> CoilgunController::get_projectile_scene() const {
+    return projectileScene;
+}
+void CoilgunController::set_projectile_scene(const Ref<PackedScene>& newScene) {
+    projectileScene = newScene;
+}
+
+// Spawn point
+Node3D* CoilgunController::get_spawn_point() const {
+    return spawnPoint;
+}
+void CoilgunController::set_spawn_point(Node3D* newSpawnPoint) {
+    spawnPoint = newSpawnPoint;
+}
+
+// Steps per activation
+int CoilgunController::get_physics_steps_per_activation() const {
+    return physicsStepsPerActivation;
+}
+void CoilgunController::set_physics_steps_per_activation(const int newSteps) {
+    ERR_FAIL_COND_MSG(newSteps < 1, "Physics steps per activation must be at least 1.");
+    physicsStepsPerActivation = newSteps;
+}
+
+// Max projectile speed
+double CoilgunController::get_max_projectile_speed() const {
+    return maxProjectileSpeed;
+}
+void CoilgunController::set_max_projectile_speed(const double newSpeed) {
+    ERR_FAIL_COND_MSG(newSpeed <= 0.0, "Max projectile speed must be positive.");
+    maxProjectileSpeed = newSpeed;
+}
+
+// Projectile lifetime
+double CoilgunController::get_projectile_lifetime() const {
+    return projectileLifetime;
+}
+void CoilgunController::set_projectile_lifetime(const double newLifetime) {
+    ERR_FAIL_COND_MSG(newLifetime < 0.0, "Projectile lifetime must not be negative.");
+    projectileLifetime = newLifetime;
+}
+
+// Pool size
+int CoilgunController::get_pool_size() const {
+    return poolSize;
+}
+void CoilgunController::set_pool_size(const int newSize) {
+    ERR_FAIL_COND_MSG(newSize < 1, "Pool size must be at least 1.");
+    poolSize = newSize;
+}
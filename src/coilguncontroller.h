@@ -0,0 +1,266 @@
+#ifndef COILGUN_CONTROLLER_H
+#define COILGUN_CONTROLLER_H
+
+#include <godot_cpp/classes/node3d.hpp>
+#include <godot_cpp/classes/packed_scene.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/core/object_id.hpp>
+#include <vector>
+
+#include "magneticbody3d.h"
+#include "magneticbodypool.h"
+
+using namespace godot;
+
+/**
+ * Drives the firing sequence of a coilgun natively, replacing the former Coilgun.gd script.
+ * The electromagnet children of this node are the coils. They are collected and ordered along the barrel once, when
+ * the node becomes ready. Firing places a projectile at the spawn point, lets it settle, then switches the coils on
+ * one after another, each for a fixed number of physics steps, while clamping the projectile's speed.
+ * Projectiles come from a pool filled when the node becomes ready, so firing allocates nothing.
+ *
+ * Scripts only call fire() and listen to the fired and finished signals; the per-tick work never crosses into script.
+ */
+class CoilgunController : public Node3D {
+    GDCLASS(CoilgunController, Node3D)
+
+public:
+
+    // --- Constructor/destructor ---
+
+    /** Default constructor */
+    CoilgunController() = default;
+
+    /** Default destructor */
+    ~CoilgunController() = default;
+
+
+    // --- Public getters and setters ---
+
+    /**
+     * Gets the scene the pooled projectiles are instanced from.
+     *
+     * @return The projectile scene.
+     */
+    Ref<PackedScene> get_projectile_scene() const;
+
+    /**
+     * Sets the scene the pooled projectiles are instanced from, when the node becomes ready.
+     * Its root must be a MagneticBody3D.
+     *
+     * @param newScene The new projectile scene.
+     */
+    void set_projectile_scene(const Ref<PackedScene>& newScene);
+
+    /**
+     * Gets the node marking where projectiles are spawned.
+     *
+     * @return The spawn point; may be null.
+     */
+    Node3D* get_spawn_point() const;
+
+    /**
+     * Sets the node marking where projectiles are spawned.
+     * Without a spawn point, projectiles are spawned one unit behind the first coil.
+     *
+     * @param newSpawnPoint The new spawn point; may be null.
+     */
+    void set_spawn_point(Node3D* newSpawnPoint);
+
+    /**
+     * Gets the number of physics steps each coil stays on.
+     *
+     * @return The steps per activation.
+     */
+    int get_physics_steps_per_activation() const;
+
+    /**
+     * Sets the number of physics steps each coil stays on.
+     *
+     * @param newSteps The new steps per activation; at least 1.
+     */
+    void set_physics_steps_per_activation(const int newSteps);
+
+    /**
+     * Gets the speed the projectile is clamped to while firing.
+     *
+     * @return The maximum projectile speed.
+     */
+    double get_max_projectile_speed() const;
+
+    /**
+     * Sets the speed the projectile is clamped to while firing, preventing extreme physics responses.
+     *
+     * @param newSpeed The new maximum projectile speed. Must be positive.
+     */
+    void set_max_projectile_speed(const double newSpeed);
+
+    /**
+     * Gets the time after which projectiles are returned to the pool.
+     *
+     * @return The projectile lifetime in seconds; 0 means projectiles are kept until the pool recycles them.
+     */
+    double get_projectile_lifetime() const;
+
+    /**
+     * Sets the time after which projectiles are returned to the pool.
+     *
+     * @param newLifetime The new projectile lifetime in seconds; 0 keeps projectiles until the pool recycles them.
+     */
+    void set_projectile_lifetime(const double newLifetime);
+
+    /**
+     * Gets the number of pooled projectiles.
+     *
+     * @return The pool size.
+     */
+    int get_pool_size() const;
+
+    /**
+     * Sets the number of pooled projectiles, instanced when the node becomes ready.
+     * When every projectile is in flight, firing recycles the oldest one.
+     *
+     * @param newSize The new pool size; at least 1.
+     */
+    void set_pool_size(const int newSize);
+
+
+    // --- Core coilgun methods ---
+
+    /**
+     * Fires the coilgun, unless a firing sequence is already running.
+     * Emits fired once the projectile has settled and the first coil switches on, and finished after the last coil.
+     */
+    void fire();
+
+    /**
+     * Collects and orders the coils, and fills the projectile pool.
+     */
+    virtual void _ready() override;
+
+    /**
+     * Advances the firing sequence by one physics step.
+     */
+    virtual void _physics_process(double delta) override;
+
+protected:
+    /**
+     * Binds methods and registers properties and signals for the editor.
+     */
+    static void _bind_methods();
+
+private:
+
+    // --- Private fields ---
+
+    /**
+     * The phases of a firing sequence.
+     * Idle: no sequence is running.
+     * Settling: the projectile was spawned frozen and is given a few physics steps to stabilize.
+     * Firing: the coils are switched on one after another.
+     */
+    enum FiringStates {
+        Idle,
+        Settling,
+        Firing
+    };
+
+    /**
+     * Number of physics steps a new projectile stays frozen, and the step after which firing starts.
+     */
+    static constexpr int SETTLE_FROZEN_STEPS = 2;
+    static constexpr int SETTLE_STEPS = 3;
+
+    /**
+     * Editor settings; see the corresponding getters.
+     */
+    Ref<PackedScene> projectileScene;
+    Node3D* spawnPoint = nullptr;
+    int physicsStepsPerActivation = 2;
+    double maxProjectileSpeed = 100.0;
+    double projectileLifetime = 1.0;
+    int poolSize = 4;
+
+    /**
+     * The pre-instantiated projectiles.
+     */
+    MagneticBodyPool pool;
+
+    /**
+     * The electromagnet children, in firing order (descending global Z).
+     */
+    std::vector<MagneticBody3D*> coils;
+
+    /**
+     * The phase of the firing sequence.
+     */
+    FiringStates state = Idle;
+
+    /**
+     * The projectile of the running sequence. Held by ID, so a projectile freed by other code is detected.
+     */
+    ObjectID projectileId;
+
+    /**
+     * Physics steps spent settling the projectile.
+     */
+    int settleSteps = 0;
+
+    /**
+     * Index of the coil currently on; -1 before the first coil.
+     */
+    int currentCoil = -1;
+
+    /**
+     * Physics steps the current coil stays on.
+     */
+    int stepsRemaining = 0;
+
+
+    // --- Firing sequence ---
+
+    /**
+     * Gets the projectile of the running sequence.
+     *
+     * @return The projectile, or nullptr if there is none or it was freed.
+     */
+    MagneticBody3D* get_projectile() const;
+
+    /**
+     * Takes a projectile from the pool and places it at the spawn point, frozen so it can settle.
+     *
+     * @return The projectile, or nullptr if the pool is empty.
+     */
+    MagneticBody3D* spawn_projectile();
+
+    /**
+     * Switches on the next coil the projectile has not passed yet, skipping the ones it has.
+     */
+    void activate_next_coil();
+
+    /**
+     * Switches off the coil currently on.
+     */
+    void deactivate_current_coil();
+
+    /**
+     * Determines if the projectile is still behind a coil, so that switching it on pulls the projectile forward.
+     *
+     * @param coil The coil.
+     * @return True if the coil should be switched on, false if not.
+     */
+    bool is_projectile_valid_for_coil(const MagneticBody3D& coil) const;
+
+    /**
+     * Ends the firing sequence and emits finished.
+     */
+    void end_firing_sequence();
+
+    /**
+     * Switches off every coil and returns to Idle.
+     */
+    void reset();
+};
+
+
+#endif // COILGUN_CONTROLLER_H
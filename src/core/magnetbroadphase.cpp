@@ -0,0 +1,326 @@
+#include "magnetbroadphase.h"
+#include <algorithm>
+#include <cmath>
+
+// Cell coordinates are clamped to this range so they fit in 21 bits per axis.
+static constexpr int32_t MAX_CELL_COORD = (1 << 20) - 1;
+
+// --- Settings ---
+
+double MagnetBroadphase::get_cell_size() const {
+    return cellSize;
+}
+
+void MagnetBroadphase::set_cell_size(double newCellSize) {
+    if (newCellSize > 0.0) {
+        cellSize = newCellSize;
+    }
+}
+
+double MagnetBroadphase::get_skin() const {
+    return skin;
+}
+
+void MagnetBroadphase::set_skin(double newSkin) {
+    if (newSkin >= 0.0 && newSkin != skin) {
+        skin = newSkin;
+        rebuildCount = 0;
+        invalidate();
+    }
+}
+
+double MagnetBroadphase::get_min_force() const {
+    return minForce;
+}
+
+void MagnetBroadphase::set_min_force(double newMinForce) {
+    if (newMinForce >= 0.0 && newMinForce != minForce) {
+        minForce = newMinForce;
+        invalidate();
+    }
+}
+
+void MagnetBroadphase::invalidate() {
+    listValid = false;
+}
+
+
+// --- Core methods ---
+
+void MagnetBroadphase::find_pairs(const MagnetSnapshot& snapshot, std::vector<MagnetPair>& outPairs) {
+    outPairs.clear();
+    rebuilt = false;
+
+    // While the neighbor list holds every pair that can be in range, filtering it replaces the grid query. The grid
+    // is not rehashed, so point queries allow for the magnets having moved up to half the skin since.
+    if (skin > 0.0 && list_covers(snapshot)) {
+        filter_list(snapshot, outPairs);
+        candidatePairs = outPairs.size();
+        gridSlack = skin * 0.5;
+        listAge++;
+        return;
+    }
+
+    build(snapshot);
+
+    const uint64_t activeCount = sortedMagnets.size();
+    totalPairs = activeCount > 1 ? activeCount * (activeCount - 1) / 2 : 0;
+
+    // With a skin, the query collects the neighbor list, and the candidates are filtered from it afterwards.
+    std::vector<MagnetPair>& collected = skin > 0.0 ? neighborPairs : outPairs;
+    collected.clear();
+
+    // Tests one potential partner j for magnet i and reports the pair if i is responsible for it.
+    // A pair is reported by the magnet with the larger sphere of influence (the lower index on ties), since that
+    // magnet's query is guaranteed to reach the other whenever either lies inside the other's sphere.
+    auto test_partner = [&](uint32_t i, uint32_t j, double reachSqr) {
+        if (i == j) return;
+
+        // Magnets on layers neither one masks never influence each other, so they are rejected before any distance math.
+        if (((snapshot.layer[i] & snapshot.mask[j]) | (snapshot.layer[j] & snapshot.mask[i])) == 0) return;
+
+        const double radiusSqrI = snapshot.radiusSqr[i];
+        const double radiusSqrJ = snapshot.radiusSqr[j];
+        if (radiusSqrJ > radiusSqrI || (radiusSqrJ == radiusSqrI && j < i)) return;
+
+        const double dx = snapshot.posX[j] - snapshot.posX[i];
+        const double dy = snapshot.posY[j] - snapshot.posY[i];
+        const double dz = snapshot.posZ[j] - snapshot.posZ[i];
+        const double distanceSqr = dx * dx + dy * dy + dz * dz;
+        if (distanceSqr > reachSqr) return;
+
+        // The pair's own cutoff radius may be closer than the sphere of influence.
+        if (minForce > 0.0) {
+            double cutoffSqr = pair_reach_sqr(snapshot, i, j);
+            if (skin > 0.0) {
+                const double cutoff = std::sqrt(cutoffSqr) + skin;
+                cutoffSqr = cutoff * cutoff;
+            }
+            if (distanceSqr > cutoffSqr) return;
+        }
+
+        collected.push_back(MagnetPair{ i, j });
+    };
+
+    // Query the cells within each magnet's reach, grown by the skin.
+    for (const auto& entry : sortedMagnets) {
+        const uint32_t i = entry.second;
+        const double sphereRadius = std::sqrt(snapshot.radiusSqr[i]) + skin;
+        const double reachSqr = skin > 0.0 ? sphereRadius * sphereRadius : snapshot.radiusSqr[i];
+        const double radius = minForce > 0.0 ? std::sqrt(reach_sqr(snapshot, i)) + skin : sphereRadius;
+
+        const int32_t minX = cell_coord(snapshot.posX[i] - radius), maxX = cell_coord(snapshot.posX[i] + radius);
+        const int32_t minY = cell_coord(snapshot.posY[i] - radius), maxY = cell_coord(snapshot.posY[i] + radius);
+        const int32_t minZ = cell_coord(snapshot.posZ[i] - radius), maxZ = cell_coord(snapshot.posZ[i] + radius);
+        const uint64_t spanCells = uint64_t(maxX - minX + 1) * uint64_t(maxY - minY + 1) * uint64_t(maxZ - minZ + 1);
+
+        // A sphere covering more cells than are occupied is cheaper to test against every active magnet directly.
+        if (spanCells >= cells.size()) {
+            for (const auto& other : sortedMagnets) {
+                test_partner(i, other.second, reachSqr);
+            }
+            continue;
+        }
+
+        for (int32_t x = minX; x <= maxX; x++) {
+            for (int32_t y = minY; y <= maxY; y++) {
+                for (int32_t z = minZ; z <= maxZ; z++) {
+                    const auto cell = cells.find(cell_key(x, y, z));
+                    if (cell == cells.end()) continue;
+                    for (uint32_t k = cell->second.first; k < cell->second.second; k++) {
+                        test_partner(i, sortedMagnets[k].second, reachSqr);
+                    }
+                }
+            }
+        }
+    }
+
+    if (skin > 0.0) {
+        // Sorted pairs keep the reported order independent of when the list was rebuilt, so results do not depend
+        // on the rebuild schedule, and pairs sharing a first magnet stay consecutive.
+        std::sort(neighborPairs.begin(), neighborPairs.end(), [](const MagnetPair& a, const MagnetPair& b) {
+            return a.first != b.first ? a.first < b.first : a.second < b.second;
+        });
+        filter_list(snapshot, outPairs);
+
+        const size_t count = snapshot.size();
+        listState.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            listState[i] = ListEntry{ snapshot.posX[i], snapshot.posY[i], snapshot.posZ[i], snapshot.radiusSqr[i],
+                snapshot.strength[i], snapshot.layer[i], snapshot.mask[i], snapshot.on[i] };
+        }
+        listValid = true;
+        rebuilt = true;
+        rebuildCount++;
+        listAge = 0;
+    }
+
+    candidatePairs = outPairs.size();
+}
+
+
+void MagnetBroadphase::build(const MagnetSnapshot& snapshot) {
+    sortedMagnets.clear();
+    cells.clear();
+    maxRadius = 0.0;
+    maxStrength = 0.0;
+    gridSlack = 0.0;
+
+    const size_t count = snapshot.size();
+
+    // Hash every active magnet into the cell containing its position.
+    // Magnets that are off neither exert nor experience any influence, so they are left out of the grid entirely.
+    double maxRadiusSqr = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        if (!snapshot.on[i]) continue;
+
+        const uint64_t key = cell_key(cell_coord(snapshot.posX[i]), cell_coord(snapshot.posY[i]), cell_coord(snapshot.posZ[i]));
+        sortedMagnets.emplace_back(key, static_cast<uint32_t>(i));
+        maxRadiusSqr = std::max(maxRadiusSqr, snapshot.radiusSqr[i]);
+        maxStrength = std::max(maxStrength, std::fabs(snapshot.strength[i]));
+    }
+    maxRadius = std::sqrt(maxRadiusSqr);
+
+    // Group magnets by cell so each cell maps to one contiguous range.
+    std::sort(sortedMagnets.begin(), sortedMagnets.end());
+    for (uint32_t start = 0; start < sortedMagnets.size();) {
+        uint32_t end = start + 1;
+        while (end < sortedMagnets.size() && sortedMagnets[end].first == sortedMagnets[start].first) end++;
+        cells.emplace(sortedMagnets[start].first, std::make_pair(start, end));
+        start = end;
+    }
+}
+
+void MagnetBroadphase::find_sources(const MagnetSnapshot& snapshot, const MagnetVector& point, std::vector<uint32_t>& outSources) const {
+    outSources.clear();
+
+    auto test_source = [&](uint32_t j) {
+        const double dx = snapshot.posX[j] - point.x;
+        const double dy = snapshot.posY[j] - point.y;
+        const double dz = snapshot.posZ[j] - point.z;
+        if (dx * dx + dy * dy + dz * dz <= snapshot.radiusSqr[j]) outSources.push_back(j);
+    };
+
+    // Any magnet reaching the point lies within the largest sphere of influence around it, and was hashed at most
+    // the grid slack away from where it is now.
+    const double reach = maxRadius + gridSlack;
+    const int32_t minX = cell_coord(point.x - reach), maxX = cell_coord(point.x + reach);
+    const int32_t minY = cell_coord(point.y - reach), maxY = cell_coord(point.y + reach);
+    const int32_t minZ = cell_coord(point.z - reach), maxZ = cell_coord(point.z + reach);
+    const uint64_t spanCells = uint64_t(maxX - minX + 1) * uint64_t(maxY - minY + 1) * uint64_t(maxZ - minZ + 1);
+
+    // A query covering more cells than are occupied is cheaper to test against every active magnet directly.
+    if (spanCells >= cells.size()) {
+        for (const auto& entry : sortedMagnets) {
+            test_source(entry.second);
+        }
+        return;
+    }
+
+    for (int32_t x = minX; x <= maxX; x++) {
+        for (int32_t y = minY; y <= maxY; y++) {
+            for (int32_t z = minZ; z <= maxZ; z++) {
+                const auto cell = cells.find(cell_key(x, y, z));
+                if (cell == cells.end()) continue;
+                for (uint32_t k = cell->second.first; k < cell->second.second; k++) {
+                    test_source(sortedMagnets[k].second);
+                }
+            }
+        }
+    }
+}
+
+double MagnetBroadphase::reach_sqr(const MagnetSnapshot& snapshot, size_t i) const {
+    const double radiusSqr = snapshot.radiusSqr[i];
+    if (minForce <= 0.0) return radiusSqr;
+    return std::min(radiusSqr, magnet_cutoff_radius_sqr(snapshot.strength[i], maxStrength, minForce));
+}
+
+
+// --- Stats ---
+
+uint64_t MagnetBroadphase::get_total_pairs() const {
+    return totalPairs;
+}
+
+uint64_t MagnetBroadphase::get_candidate_pairs() const {
+    return candidatePairs;
+}
+
+uint64_t MagnetBroadphase::get_culled_pairs() const {
+    return totalPairs - candidatePairs;
+}
+
+size_t MagnetBroadphase::get_occupied_cells() const {
+    return cells.size();
+}
+
+bool MagnetBroadphase::was_rebuilt() const {
+    return rebuilt;
+}
+
+uint64_t MagnetBroadphase::get_rebuild_count() const {
+    return rebuildCount;
+}
+
+uint32_t MagnetBroadphase::get_list_age() const {
+    return listAge;
+}
+
+size_t MagnetBroadphase::get_neighbor_pairs() const {
+    return neighborPairs.size();
+}
+
+
+// --- Private helpers ---
+
+bool MagnetBroadphase::list_covers(const MagnetSnapshot& snapshot) const {
+    if (!listValid || listState.size() != snapshot.size()) return false;
+
+    // Two magnets that each moved at most half the skin closed their gap by at most the skin, so every pair now in
+    // range was within range plus skin when the list was built.
+    const double limitSqr = skin * skin * 0.25;
+    for (size_t i = 0; i < listState.size(); i++) {
+        const ListEntry& entry = listState[i];
+        if (entry.on != snapshot.on[i]) return false;
+        if (!entry.on) continue;
+        if (entry.radiusSqr != snapshot.radiusSqr[i] || entry.strength != snapshot.strength[i]
+            || entry.layer != snapshot.layer[i] || entry.mask != snapshot.mask[i]) return false;
+
+        const double dx = snapshot.posX[i] - entry.x;
+        const double dy = snapshot.posY[i] - entry.y;
+        const double dz = snapshot.posZ[i] - entry.z;
+        if (dx * dx + dy * dy + dz * dz > limitSqr) return false;
+    }
+    return true;
+}
+
+void MagnetBroadphase::filter_list(const MagnetSnapshot& snapshot, std::vector<MagnetPair>& outPairs) const {
+    // The first magnet of each pair has the larger sphere of influence, as in the grid query.
+    for (const MagnetPair& pair : neighborPairs) {
+        const double dx = snapshot.posX[pair.second] - snapshot.posX[pair.first];
+        const double dy = snapshot.posY[pair.second] - snapshot.posY[pair.first];
+        const double dz = snapshot.posZ[pair.second] - snapshot.posZ[pair.first];
+        if (dx * dx + dy * dy + dz * dz <= pair_reach_sqr(snapshot, pair.first, pair.second)) outPairs.push_back(pair);
+    }
+}
+
+double MagnetBroadphase::pair_reach_sqr(const MagnetSnapshot& snapshot, uint32_t first, uint32_t second) const {
+    const double radiusSqr = snapshot.radiusSqr[first];
+    if (minForce <= 0.0) return radiusSqr;
+    return std::min(radiusSqr, magnet_cutoff_radius_sqr(snapshot.strength[first], snapshot.strength[second], minForce));
+}
+
+int32_t MagnetBroadphase::cell_coord(double value) const {
+    const double coord = std::floor(value / cellSize);
+    if (coord < -MAX_CELL_COORD) return -MAX_CELL_COORD;
+    if (coord > MAX_CELL_COORD) return MAX_CELL_COORD;
+    return static_cast<int32_t>(coord);
+}
+
+uint64_t MagnetBroadphase::cell_key(int32_t x, int32_t y, int32_t z) {
+    const uint64_t mask = (uint64_t(1) << 21) - 1;
+    return ((uint64_t(x + MAX_CELL_COORD) & mask) << 42) |
+           ((uint64_t(y + MAX_CELL_COORD) & mask) << 21) |
+           (uint64_t(z + MAX_CELL_COORD) & mask);
+}
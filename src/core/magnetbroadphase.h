@@ -0,0 +1,279 @@
+#ifndef MAGNET_BROADPHASE_H
+#define MAGNET_BROADPHASE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "magnetsnapshot.h"
+
+/**
+ * A pair of snapshot indices that may influence each other.
+ * first is the magnet whose query reported the pair; pairs sharing the same first are reported consecutively,
+ * so they can be evaluated as one batch.
+ */
+struct MagnetPair {
+    uint32_t first;
+    uint32_t second;
+};
+
+/**
+ * Uniform-grid (spatial hash) broadphase for magnet pairs.
+ * Every active magnet is hashed into the grid cell containing its position. Each magnet then queries the cells
+ * overlapped by its own sphere of influence, so only pairs where at least one magnet lies inside the other's sphere
+ * of influence, and at least one magnet's layer is in the other's mask, are reported. Each candidate pair is reported
+ * exactly once, by the magnet with the larger sphere. With a minimum force, pairs beyond their cutoff radius are left
+ * out too, and each query only covers the magnet's cutoff radius against the strongest magnet.
+ *
+ * With a positive skin distance, the grid query also collects a Verlet neighbor list: every pair within the larger
+ * sphere of influence radius plus the skin. While no magnet has moved more than half the skin since, and no magnet's
+ * on-state, sphere of influence or layers changed, later calls only filter that list instead of querying the grid.
+ * In that mode pairs are reported in ascending (first, second) order, whether the list is rebuilt or reused.
+ */
+class MagnetBroadphase {
+public:
+
+    // --- Constructor ---
+
+    /** Default constructor */
+    MagnetBroadphase() = default;
+
+
+    // --- Settings ---
+
+    /**
+     * Gets the edge length of a grid cell.
+     *
+     * @return The cell size.
+     */
+    double get_cell_size() const;
+
+    /**
+     * Sets the edge length of a grid cell. Non-positive values are ignored.
+     * Cells around the typical influence radius work best; much smaller cells make large spheres visit many cells.
+     *
+     * @param newCellSize The new cell size.
+     */
+    void set_cell_size(double newCellSize);
+
+    /**
+     * Gets the skin distance added to the spheres of influence in the neighbor list.
+     *
+     * @return The skin distance; 0 disables the neighbor list.
+     */
+    double get_skin() const;
+
+    /**
+     * Sets the skin distance added to the spheres of influence in the neighbor list. Negative values are ignored.
+     * A larger skin makes the list longer to filter, but rebuilt less often. Discards the current list.
+     *
+     * @param newSkin The new skin distance; 0 disables the neighbor list.
+     */
+    void set_skin(double newSkin);
+
+    /**
+     * Gets the minimum force below which pairs are cut off.
+     *
+     * @return The minimum force; 0 disables the cutoff.
+     */
+    double get_min_force() const;
+
+    /**
+     * Sets the minimum force below which pairs are cut off. Negative values are ignored.
+     * Pairs farther apart than their cutoff radius (see magnet_cutoff_radius_sqr) are not reported, even inside a
+     * sphere of influence. Discards the neighbor list.
+     *
+     * @param newMinForce The new minimum force; 0 disables the cutoff.
+     */
+    void set_min_force(double newMinForce);
+
+    /**
+     * Discards the neighbor list, so the next find_pairs call rebuilds it.
+     * Must be called whenever a snapshot index may refer to a different magnet than in the previous call.
+     */
+    void invalidate();
+
+
+    // --- Core methods ---
+
+    /**
+     * Hashes the active magnets of the snapshot and collects every candidate pair.
+     *
+     * @param snapshot The magnet state for the current tick.
+     * @param outPairs Receives the candidate pairs; cleared first.
+     */
+    void find_pairs(const MagnetSnapshot& snapshot, std::vector<MagnetPair>& outPairs);
+
+    /**
+     * Hashes the active magnets of the snapshot without collecting pairs, so find_sources can be used.
+     * find_pairs does this as its first step.
+     *
+     * @param snapshot The magnet state for the current tick.
+     */
+    void build(const MagnetSnapshot& snapshot);
+
+    /**
+     * Collects the active magnets whose sphere of influence contains a point, using the grid of the last build or
+     * find_pairs call. Safe to call concurrently.
+     *
+     * @param snapshot The snapshot the grid was built from.
+     * @param point The query point.
+     * @param outSources Receives the snapshot indices of the magnets; cleared first.
+     */
+    void find_sources(const MagnetSnapshot& snapshot, const MagnetVector& point, std::vector<uint32_t>& outSources) const;
+
+    /**
+     * Gets the square of the largest separation at which a magnet can influence any magnet hashed by the last build
+     * or find_pairs call: its sphere of influence, shrunk to its cutoff radius against the strongest magnet.
+     *
+     * @param snapshot The snapshot the grid was built from.
+     * @param i Index of the magnet.
+     * @return The square of the magnet's reach.
+     */
+    double reach_sqr(const MagnetSnapshot& snapshot, size_t i) const;
+
+
+    // --- Stats for the last find_pairs call ---
+
+    /**
+     * Gets the number of pairs between active magnets, i.e. the pairs an all-pairs loop would test.
+     */
+    uint64_t get_total_pairs() const;
+
+    /**
+     * Gets the number of pairs reported as candidates.
+     */
+    uint64_t get_candidate_pairs() const;
+
+    /**
+     * Gets the number of pairs culled without reaching the force kernel.
+     */
+    uint64_t get_culled_pairs() const;
+
+    /**
+     * Gets the number of occupied grid cells.
+     */
+    size_t get_occupied_cells() const;
+
+    /**
+     * Gets whether the last find_pairs call rebuilt the neighbor list.
+     */
+    bool was_rebuilt() const;
+
+    /**
+     * Gets the number of neighbor list rebuilds since the skin was set.
+     */
+    uint64_t get_rebuild_count() const;
+
+    /**
+     * Gets the number of find_pairs calls that reused the neighbor list since it was last rebuilt.
+     */
+    uint32_t get_list_age() const;
+
+    /**
+     * Gets the number of pairs in the neighbor list.
+     */
+    size_t get_neighbor_pairs() const;
+
+private:
+
+    // --- Private fields ---
+
+    /**
+     * Edge length of a grid cell.
+     */
+    double cellSize = 10.0;
+
+    /**
+     * Active magnets sorted by cell key, so each cell's magnets are contiguous.
+     * Each entry holds the cell key and the snapshot index.
+     */
+    std::vector<std::pair<uint64_t, uint32_t>> sortedMagnets;
+
+    /**
+     * Maps a cell key to the [start, end) range of its magnets in sortedMagnets.
+     */
+    std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> cells;
+
+    /**
+     * Largest sphere of influence radius among the hashed magnets, which bounds point queries.
+     */
+    double maxRadius = 0.0;
+
+    /**
+     * Largest absolute strength among the hashed magnets, which bounds every cutoff radius.
+     */
+    double maxStrength = 0.0;
+
+    /**
+     * Minimum force of the pair cutoff; 0 disables it.
+     */
+    double minForce = 0.0;
+
+    /**
+     * Distance by which the hashed positions may lag the snapshot, as the grid is not rehashed while the neighbor
+     * list is reused. Point queries are widened by it.
+     */
+    double gridSlack = 0.0;
+
+    /**
+     * Skin distance of the neighbor list; 0 disables it.
+     */
+    double skin = 0.0;
+
+    /**
+     * State of one magnet when the neighbor list was built, to detect when the list must be rebuilt.
+     */
+    struct ListEntry {
+        double x, y, z;
+        double radiusSqr, strength;
+        uint32_t layer, mask;
+        uint8_t on;
+    };
+
+    /** The neighbor list, and the state of every magnet it was built from. */
+    std::vector<MagnetPair> neighborPairs;
+    std::vector<ListEntry> listState;
+    bool listValid = false;
+
+    /** Stats for the last find_pairs call. */
+    uint64_t totalPairs = 0;
+    uint64_t candidatePairs = 0;
+    bool rebuilt = false;
+    uint64_t rebuildCount = 0;
+    uint32_t listAge = 0;
+
+
+    // --- Private helpers ---
+
+    /**
+     * Gets the square of the separation within which a pair is a candidate: the sphere of influence of its first
+     * magnet, shrunk to the pair's cutoff radius.
+     */
+    double pair_reach_sqr(const MagnetSnapshot& snapshot, uint32_t first, uint32_t second) const;
+
+    /**
+     * Determines if the neighbor list still holds every candidate pair of the snapshot.
+     */
+    bool list_covers(const MagnetSnapshot& snapshot) const;
+
+    /**
+     * Collects the pairs of the neighbor list that are candidates for the snapshot.
+     */
+    void filter_list(const MagnetSnapshot& snapshot, std::vector<MagnetPair>& outPairs) const;
+
+    /**
+     * Computes the integer cell coordinate containing a world coordinate.
+     */
+    int32_t cell_coord(double value) const;
+
+    /**
+     * Packs integer cell coordinates into a single hash key (21 bits per axis).
+     */
+    static uint64_t cell_key(int32_t x, int32_t y, int32_t z);
+};
+
+
+#endif // MAGNET_BROADPHASE_H
@@ -0,0 +1,183 @@
+#include "magnetfieldgrid.h"
+#include <algorithm>
+#include <cmath>
+
+// --- Layout ---
+
+void MagnetFieldGrid::configure(const MagnetVector& newMin, const MagnetVector& newMax, uint32_t newNodesX, uint32_t newNodesY, uint32_t newNodesZ) {
+    boundsMin = newMin;
+    boundsMax = newMax;
+    nodesX = std::max<uint32_t>(newNodesX, 2);
+    nodesY = std::max<uint32_t>(newNodesY, 2);
+    nodesZ = std::max<uint32_t>(newNodesZ, 2);
+    data.clear();
+}
+
+const MagnetVector& MagnetFieldGrid::get_bounds_min() const {
+    return boundsMin;
+}
+
+const MagnetVector& MagnetFieldGrid::get_bounds_max() const {
+    return boundsMax;
+}
+
+uint32_t MagnetFieldGrid::get_nodes_x() const {
+    return nodesX;
+}
+
+uint32_t MagnetFieldGrid::get_nodes_y() const {
+    return nodesY;
+}
+
+uint32_t MagnetFieldGrid::get_nodes_z() const {
+    return nodesZ;
+}
+
+
+// --- Baking and sampling ---
+
+void MagnetFieldGrid::bake(const MagnetSnapshot& sources, const MagnetTaskRunner& runner) {
+    data.assign(value_count(), 0.0f);
+
+    const double stepX = (boundsMax.x - boundsMin.x) / (nodesX - 1);
+    const double stepY = (boundsMax.y - boundsMin.y) / (nodesY - 1);
+    const double stepZ = (boundsMax.z - boundsMin.z) / (nodesZ - 1);
+
+    // Each task bakes one Z slice, so tasks write disjoint ranges of the data.
+    runner(nodesZ, [&](uint32_t z) {
+        for (uint32_t y = 0; y < nodesY; y++) {
+            for (uint32_t x = 0; x < nodesX; x++) {
+                const double px = boundsMin.x + x * stepX;
+                const double py = boundsMin.y + y * stepY;
+                const double pz = boundsMin.z + z * stepZ;
+
+                // Accumulate in double precision; only the result is stored as float.
+                double values[CHANNELS] = {};
+                uint32_t covered = 0;
+                for (size_t j = 0; j < sources.size(); j++) {
+                    if (!sources.on[j]) continue;
+
+                    const double rx = sources.posX[j] - px;
+                    const double ry = sources.posY[j] - py;
+                    const double rz = sources.posZ[j] - pz;
+                    const double distanceSqr = rx * rx + ry * ry + rz * rz;
+                    if (distanceSqr > sources.radiusSqr[j]) continue;
+                    covered++;
+
+                    // Same distance clamps as magnet_calculate_force and magnet_calculate_torque.
+                    const double distance = std::sqrt(distanceSqr);
+                    const double forceDistance = std::max(distance, MAGNET_FORCE_MIN_DISTANCE);
+                    const double torqueDistance = std::max(distance, MAGNET_TORQUE_MIN_DISTANCE);
+                    const double forceScale = sources.strength[j] / (forceDistance * forceDistance * forceDistance);
+                    const double torqueScale = sources.strength[j] / (torqueDistance * torqueDistance);
+
+                    const double r[3] = { rx, ry, rz };
+                    const double a[3] = { sources.axisX[j], sources.axisY[j], sources.axisZ[j] };
+                    for (int row = 0; row < 3; row++) {
+                        for (int column = 0; column < 3; column++) {
+                            values[row * 3 + column] += forceScale * r[row] * a[column];
+                        }
+                        values[9 + row] += torqueScale * a[row];
+                    }
+                }
+                values[12] = covered > 0 ? 1.0 : 0.0;
+
+                float* node = &data[((size_t(z) * nodesY + y) * nodesX + x) * CHANNELS];
+                for (size_t c = 0; c < CHANNELS; c++) {
+                    node[c] = static_cast<float>(values[c]);
+                }
+            }
+        }
+    });
+}
+
+bool MagnetFieldGrid::is_baked() const {
+    return !data.empty() && data.size() == value_count();
+}
+
+const std::vector<float>& MagnetFieldGrid::get_data() const {
+    return data;
+}
+
+bool MagnetFieldGrid::set_data(const std::vector<float>& newData) {
+    if (newData.size() != value_count()) {
+        data.clear();
+        return false;
+    }
+    data = newData;
+    return true;
+}
+
+bool MagnetFieldGrid::sample(const MagnetVector& position, const MagnetVector& axis, double strength, MagnetVector& outForce, MagnetVector& outTorque) const {
+    if (!is_baked()) return false;
+
+    // Continuous grid coordinates of the position; outside the grid, the static field is not known.
+    const double gx = (position.x - boundsMin.x) / (boundsMax.x - boundsMin.x) * (nodesX - 1);
+    const double gy = (position.y - boundsMin.y) / (boundsMax.y - boundsMin.y) * (nodesY - 1);
+    const double gz = (position.z - boundsMin.z) / (boundsMax.z - boundsMin.z) * (nodesZ - 1);
+    if (!(gx >= 0.0 && gy >= 0.0 && gz >= 0.0 && gx <= nodesX - 1 && gy <= nodesY - 1 && gz <= nodesZ - 1)) return false;
+
+    const uint32_t x0 = std::min(static_cast<uint32_t>(gx), nodesX - 2);
+    const uint32_t y0 = std::min(static_cast<uint32_t>(gy), nodesY - 2);
+    const uint32_t z0 = std::min(static_cast<uint32_t>(gz), nodesZ - 2);
+    const double fx = gx - x0;
+    const double fy = gy - y0;
+    const double fz = gz - z0;
+
+    // Trilinear blend of the 8 surrounding nodes.
+    double values[CHANNELS] = {};
+    for (int corner = 0; corner < 8; corner++) {
+        const uint32_t dx = corner & 1, dy = (corner >> 1) & 1, dz = (corner >> 2) & 1;
+        const double weight = (dx ? fx : 1.0 - fx) * (dy ? fy : 1.0 - fy) * (dz ? fz : 1.0 - fz);
+        if (weight == 0.0) continue;
+
+        const float* node = &data[((size_t(z0 + dz) * nodesY + (y0 + dy)) * nodesX + (x0 + dx)) * CHANNELS];
+        for (size_t c = 0; c < CHANNELS; c++) {
+            values[c] += weight * node[c];
+        }
+    }
+
+    // The sphere of influence boundary is placed halfway between covered and uncovered nodes.
+    if (values[12] < 0.5) return false;
+
+    const double forceScale = MAGNET_FORCE_SCALING * strength;
+    outForce = MagnetVector{
+        forceScale * (values[0] * axis.x + values[1] * axis.y + values[2] * axis.z),
+        forceScale * (values[3] * axis.x + values[4] * axis.y + values[5] * axis.z),
+        forceScale * (values[6] * axis.x + values[7] * axis.y + values[8] * axis.z)
+    };
+
+    const double torqueScale = MAGNET_TORQUE_SCALING * strength;
+    outTorque = MagnetVector{
+        torqueScale * (axis.y * values[11] - axis.z * values[10]),
+        torqueScale * (axis.z * values[9] - axis.x * values[11]),
+        torqueScale * (axis.x * values[10] - axis.y * values[9])
+    };
+    return true;
+}
+
+void MagnetFieldGrid::apply(MagnetSnapshot& snapshot, uint32_t layers) const {
+    if (!is_baked()) return;
+
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        if (!snapshot.on[i] || !snapshot.updated[i] || !magnet_layers_allow(snapshot.mask[i], layers)) continue;
+
+        MagnetVector force, torque;
+        if (!sample(snapshot.position(i), snapshot.axis(i), snapshot.strength[i], force, torque)) continue;
+
+        snapshot.forceX[i] += force.x;
+        snapshot.forceY[i] += force.y;
+        snapshot.forceZ[i] += force.z;
+        snapshot.torqueX[i] += torque.x;
+        snapshot.torqueY[i] += torque.y;
+        snapshot.torqueZ[i] += torque.z;
+        snapshot.influenced[i] = 1;
+    }
+}
+
+
+// --- Private helpers ---
+
+size_t MagnetFieldGrid::value_count() const {
+    return size_t(nodesX) * nodesY * nodesZ * CHANNELS;
+}
@@ -0,0 +1,132 @@
+#ifndef MAGNET_FIELD_GRID_H
+#define MAGNET_FIELD_GRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "magnetmodel.h"
+#include "magnetsnapshot.h"
+#include "magnettasks.h"
+
+/**
+ * Baked field of a set of static magnets, sampled on a regular 3D grid.
+ * The force and torque a magnet receives from the static magnets are linear in its pole direction and strength:
+ *   force  = MAGNET_FORCE_SCALING * strength * M * axis,   M = sum_j strength_j * r_j * axis_j^T / |r_j|^3
+ *   torque = MAGNET_TORQUE_SCALING * strength * (axis x B),  B = sum_j strength_j * axis_j / |r_j|^2
+ * so each grid node stores M, B and whether any static magnet's sphere of influence covers it, and a magnet of any
+ * orientation and strength is handled with one trilinear lookup instead of one pair evaluation per static magnet.
+ *
+ * Static magnets are assumed to be permanent: they are always on and influence every magnet type.
+ */
+class MagnetFieldGrid {
+public:
+
+    /**
+     * Number of values stored per grid node: M (9, row-major), B (3), and coverage (1).
+     */
+    static constexpr size_t CHANNELS = 13;
+
+    // --- Constructor ---
+
+    /** Default constructor */
+    MagnetFieldGrid() = default;
+
+
+    // --- Layout ---
+
+    /**
+     * Sets the region covered by the grid and its number of nodes along each axis.
+     * Discards any baked data.
+     *
+     * @param newMin The minimum corner of the region.
+     * @param newMax The maximum corner of the region.
+     * @param nodesX Number of nodes along X; at least 2.
+     * @param nodesY Number of nodes along Y; at least 2.
+     * @param nodesZ Number of nodes along Z; at least 2.
+     */
+    void configure(const MagnetVector& newMin, const MagnetVector& newMax, uint32_t nodesX, uint32_t nodesY, uint32_t nodesZ);
+
+    /** Gets the minimum corner of the region covered by the grid. */
+    const MagnetVector& get_bounds_min() const;
+
+    /** Gets the maximum corner of the region covered by the grid. */
+    const MagnetVector& get_bounds_max() const;
+
+    /** Gets the number of nodes along X, Y and Z. */
+    uint32_t get_nodes_x() const;
+    uint32_t get_nodes_y() const;
+    uint32_t get_nodes_z() const;
+
+
+    // --- Baking and sampling ---
+
+    /**
+     * Samples the combined field of every magnet that is on in sources at each grid node.
+     *
+     * @param sources The static magnets.
+     * @param runner Runs one task per Z slice of the grid, possibly in parallel.
+     */
+    void bake(const MagnetSnapshot& sources, const MagnetTaskRunner& runner = magnet_run_tasks_serial);
+
+    /**
+     * Determines if the grid holds baked data matching its layout.
+     */
+    bool is_baked() const;
+
+    /**
+     * Gets the baked node values, CHANNELS per node, X fastest then Y then Z.
+     */
+    const std::vector<float>& get_data() const;
+
+    /**
+     * Replaces the baked node values, e.g. when loading a saved grid.
+     * The data is ignored (and the grid left unbaked) if its size does not match the layout.
+     *
+     * @param newData The node values.
+     * @return True if the data was accepted.
+     */
+    bool set_data(const std::vector<float>& newData);
+
+    /**
+     * Computes the force and torque the static magnets exert on a magnet, by trilinear interpolation.
+     *
+     * @param position Position of the magnet.
+     * @param axis Normalized pole direction of the magnet.
+     * @param strength Strength of the magnet.
+     * @param outForce Receives the force.
+     * @param outTorque Receives the torque.
+     * @return True if the magnet is inside the grid and inside the static magnets' spheres of influence.
+     */
+    bool sample(const MagnetVector& position, const MagnetVector& axis, double strength, MagnetVector& outForce, MagnetVector& outTorque) const;
+
+    /**
+     * Adds the static field to the results of every updated magnet that is on and masks one of the static layers.
+     *
+     * @param snapshot The magnet state and results for the current tick.
+     * @param layers Magnetic layers of the static magnets the field was baked from.
+     */
+    void apply(MagnetSnapshot& snapshot, uint32_t layers = MAGNET_ALL_LAYERS) const;
+
+private:
+
+    // --- Private fields ---
+
+    /** Region covered by the grid. */
+    MagnetVector boundsMin, boundsMax;
+
+    /** Number of nodes along each axis. */
+    uint32_t nodesX = 2, nodesY = 2, nodesZ = 2;
+
+    /** Node values, CHANNELS per node. */
+    std::vector<float> data;
+
+
+    // --- Private helpers ---
+
+    /** Gets the number of values a fully baked grid holds. */
+    size_t value_count() const;
+};
+
+
+#endif // MAGNET_FIELD_GRID_H
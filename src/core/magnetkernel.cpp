@@ -0,0 +1,414 @@
+#include "magnetkernel.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// --- Vector operations per instruction set ---
+// Each wrapper exposes the same minimal set of lane-wise operations for one scalar type, so the kernel math is written
+// once for every instruction set and precision.
+
+namespace {
+
+template <typename T>
+struct ScalarOps {
+    using Vec = T;
+    static constexpr size_t WIDTH = 1;
+    static Vec load(const T* p) { return *p; }
+    static void store(T* p, Vec v) { *p = v; }
+    static Vec set1(T v) { return v; }
+    static Vec add(Vec a, Vec b) { return a + b; }
+    static Vec sub(Vec a, Vec b) { return a - b; }
+    static Vec mul(Vec a, Vec b) { return a * b; }
+    static Vec div(Vec a, Vec b) { return a / b; }
+    static Vec max(Vec a, Vec b) { return a < b ? b : a; }
+    static Vec sqrt(Vec a) { return std::sqrt(a); }
+};
+
+template <typename T>
+struct VectorOps;
+
+#if defined(__AVX2__)
+constexpr const char* ISA_NAME = "AVX2";
+
+template <>
+struct VectorOps<double> {
+    using Vec = __m256d;
+    static constexpr size_t WIDTH = 4;
+    static Vec load(const double* p) { return _mm256_load_pd(p); }
+    static void store(double* p, Vec v) { _mm256_store_pd(p, v); }
+    static Vec set1(double v) { return _mm256_set1_pd(v); }
+    static Vec add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm256_sub_pd(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+    static Vec div(Vec a, Vec b) { return _mm256_div_pd(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm256_max_pd(a, b); }
+    static Vec sqrt(Vec a) { return _mm256_sqrt_pd(a); }
+};
+
+template <>
+struct VectorOps<float> {
+    using Vec = __m256;
+    static constexpr size_t WIDTH = 8;
+    static Vec load(const float* p) { return _mm256_load_ps(p); }
+    static void store(float* p, Vec v) { _mm256_store_ps(p, v); }
+    static Vec set1(float v) { return _mm256_set1_ps(v); }
+    static Vec add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+    static Vec div(Vec a, Vec b) { return _mm256_div_ps(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+    static Vec sqrt(Vec a) { return _mm256_sqrt_ps(a); }
+};
+#elif defined(__SSE2__) || defined(_M_X64)
+constexpr const char* ISA_NAME = "SSE2";
+
+template <>
+struct VectorOps<double> {
+    using Vec = __m128d;
+    static constexpr size_t WIDTH = 2;
+    static Vec load(const double* p) { return _mm_load_pd(p); }
+    static void store(double* p, Vec v) { _mm_store_pd(p, v); }
+    static Vec set1(double v) { return _mm_set1_pd(v); }
+    static Vec add(Vec a, Vec b) { return _mm_add_pd(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm_sub_pd(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm_mul_pd(a, b); }
+    static Vec div(Vec a, Vec b) { return _mm_div_pd(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm_max_pd(a, b); }
+    static Vec sqrt(Vec a) { return _mm_sqrt_pd(a); }
+};
+
+template <>
+struct VectorOps<float> {
+    using Vec = __m128;
+    static constexpr size_t WIDTH = 4;
+    static Vec load(const float* p) { return _mm_load_ps(p); }
+    static void store(float* p, Vec v) { _mm_store_ps(p, v); }
+    static Vec set1(float v) { return _mm_set1_ps(v); }
+    static Vec add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+    static Vec div(Vec a, Vec b) { return _mm_div_ps(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm_max_ps(a, b); }
+    static Vec sqrt(Vec a) { return _mm_sqrt_ps(a); }
+};
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+constexpr const char* ISA_NAME = "NEON";
+
+template <>
+struct VectorOps<double> {
+    using Vec = float64x2_t;
+    static constexpr size_t WIDTH = 2;
+    static Vec load(const double* p) { return vld1q_f64(p); }
+    static void store(double* p, Vec v) { vst1q_f64(p, v); }
+    static Vec set1(double v) { return vdupq_n_f64(v); }
+    static Vec add(Vec a, Vec b) { return vaddq_f64(a, b); }
+    static Vec sub(Vec a, Vec b) { return vsubq_f64(a, b); }
+    static Vec mul(Vec a, Vec b) { return vmulq_f64(a, b); }
+    static Vec div(Vec a, Vec b) { return vdivq_f64(a, b); }
+    static Vec max(Vec a, Vec b) { return vmaxq_f64(a, b); }
+    static Vec sqrt(Vec a) { return vsqrtq_f64(a); }
+};
+
+template <>
+struct VectorOps<float> {
+    using Vec = float32x4_t;
+    static constexpr size_t WIDTH = 4;
+    static Vec load(const float* p) { return vld1q_f32(p); }
+    static void store(float* p, Vec v) { vst1q_f32(p, v); }
+    static Vec set1(float v) { return vdupq_n_f32(v); }
+    static Vec add(Vec a, Vec b) { return vaddq_f32(a, b); }
+    static Vec sub(Vec a, Vec b) { return vsubq_f32(a, b); }
+    static Vec mul(Vec a, Vec b) { return vmulq_f32(a, b); }
+    static Vec div(Vec a, Vec b) { return vdivq_f32(a, b); }
+    static Vec max(Vec a, Vec b) { return vmaxq_f32(a, b); }
+    static Vec sqrt(Vec a) { return vsqrtq_f32(a); }
+};
+#else
+constexpr const char* ISA_NAME = "Scalar";
+
+template <typename T>
+struct VectorOps : ScalarOps<T> {};
+#endif
+
+/**
+ * Read-only view of the kernel inputs of every magnet, in either precision.
+ */
+template <typename Scalar>
+struct KernelInputs {
+    const Scalar* posX;
+    const Scalar* posY;
+    const Scalar* posZ;
+    const Scalar* axisX;
+    const Scalar* axisY;
+    const Scalar* axisZ;
+    const Scalar* strength;
+    const Scalar* radiusSqr;
+};
+
+KernelInputs<double> inputs_of(const MagnetSnapshot& snapshot) {
+    return KernelInputs<double>{ snapshot.posX.data(), snapshot.posY.data(), snapshot.posZ.data(),
+        snapshot.axisX.data(), snapshot.axisY.data(), snapshot.axisZ.data(), snapshot.strength.data(), snapshot.radiusSqr.data() };
+}
+
+KernelInputs<float> inputs_of(const MagnetKernelStateF& state) {
+    return KernelInputs<float>{ state.posX.data(), state.posY.data(), state.posZ.data(),
+        state.axisX.data(), state.axisY.data(), state.axisZ.data(), state.strength.data(), state.radiusSqr.data() };
+}
+
+/**
+ * Partner state gathered into contiguous, aligned lanes.
+ */
+template <typename Scalar>
+struct alignas(32) GatheredPartners {
+    Scalar posX[MAGNET_BATCH_SIZE], posY[MAGNET_BATCH_SIZE], posZ[MAGNET_BATCH_SIZE];
+    Scalar axisX[MAGNET_BATCH_SIZE], axisY[MAGNET_BATCH_SIZE], axisZ[MAGNET_BATCH_SIZE];
+    Scalar strength[MAGNET_BATCH_SIZE];
+};
+
+/**
+ * Copies the partners' state into lanes, zero-padding up to a multiple of the vector width.
+ * Padded lanes have zero strength and produce zero force and torque; callers never read them.
+ *
+ * @return The padded lane count.
+ */
+template <typename Scalar>
+size_t gather_partners(const KernelInputs<Scalar>& inputs, const uint32_t* others, size_t count, size_t width, GatheredPartners<Scalar>& lanes) {
+    for (size_t k = 0; k < count; k++) {
+        const uint32_t j = others[k];
+        lanes.posX[k] = inputs.posX[j];
+        lanes.posY[k] = inputs.posY[j];
+        lanes.posZ[k] = inputs.posZ[j];
+        lanes.axisX[k] = inputs.axisX[j];
+        lanes.axisY[k] = inputs.axisY[j];
+        lanes.axisZ[k] = inputs.axisZ[j];
+        lanes.strength[k] = inputs.strength[j];
+    }
+
+    const size_t padded = (count + width - 1) / width * width;
+    for (size_t k = count; k < padded; k++) {
+        lanes.posX[k] = lanes.posY[k] = lanes.posZ[k] = Scalar(0);
+        lanes.axisX[k] = lanes.axisY[k] = lanes.axisZ[k] = Scalar(0);
+        lanes.strength[k] = Scalar(0);
+    }
+    return padded;
+}
+
+/**
+ * State of the magnet experiencing the forces of a batch.
+ */
+template <typename Scalar>
+struct SelfMagnet {
+    Scalar posX, posY, posZ;
+    Scalar axisX, axisY, axisZ;
+    Scalar strength;
+};
+
+template <typename Scalar>
+SelfMagnet<Scalar> self_of(const KernelInputs<Scalar>& inputs, uint32_t self) {
+    return SelfMagnet<Scalar>{ inputs.posX[self], inputs.posY[self], inputs.posZ[self],
+        inputs.axisX[self], inputs.axisY[self], inputs.axisZ[self], inputs.strength[self] };
+}
+
+/**
+ * Kernel math, written once for every instruction set and precision.
+ * Same models as MagnetSnapshot::calculate_force and MagnetSnapshot::calculate_torque, with the force's two divisions
+ * folded into one; results match the snapshot kernels to within rounding.
+ */
+template <typename Ops, typename Scalar>
+void evaluate_lanes(const SelfMagnet<Scalar>& self, const GatheredPartners<Scalar>& lanes, size_t padded, MagnetBatchResultT<Scalar>& out) {
+    using Vec = typename Ops::Vec;
+
+    const Vec selfX = Ops::set1(self.posX);
+    const Vec selfY = Ops::set1(self.posY);
+    const Vec selfZ = Ops::set1(self.posZ);
+    const Vec selfAxisX = Ops::set1(self.axisX);
+    const Vec selfAxisY = Ops::set1(self.axisY);
+    const Vec selfAxisZ = Ops::set1(self.axisZ);
+    const Vec forceStrength = Ops::set1(static_cast<Scalar>(MAGNET_FORCE_SCALING * self.strength));
+    const Vec torqueStrength = Ops::set1(static_cast<Scalar>(MAGNET_TORQUE_SCALING * self.strength));
+    const Vec forceMinDistance = Ops::set1(static_cast<Scalar>(MAGNET_FORCE_MIN_DISTANCE));
+    const Vec torqueMinDistance = Ops::set1(static_cast<Scalar>(MAGNET_TORQUE_MIN_DISTANCE));
+
+    for (size_t k = 0; k < padded; k += Ops::WIDTH) {
+        // Separation vector and its (clamped) lengths.
+        const Vec rx = Ops::sub(Ops::load(lanes.posX + k), selfX);
+        const Vec ry = Ops::sub(Ops::load(lanes.posY + k), selfY);
+        const Vec rz = Ops::sub(Ops::load(lanes.posZ + k), selfZ);
+        const Vec distanceSqr = Ops::add(Ops::add(Ops::mul(rx, rx), Ops::mul(ry, ry)), Ops::mul(rz, rz));
+        const Vec distance = Ops::sqrt(distanceSqr);
+        const Vec forceDistance = Ops::max(distance, forceMinDistance);
+        const Vec torqueDistance = Ops::max(distance, torqueMinDistance);
+
+        // Pole alignment and torque direction.
+        const Vec axisX = Ops::load(lanes.axisX + k);
+        const Vec axisY = Ops::load(lanes.axisY + k);
+        const Vec axisZ = Ops::load(lanes.axisZ + k);
+        const Vec alignment = Ops::add(Ops::add(Ops::mul(selfAxisX, axisX), Ops::mul(selfAxisY, axisY)), Ops::mul(selfAxisZ, axisZ));
+        const Vec crossX = Ops::sub(Ops::mul(selfAxisY, axisZ), Ops::mul(selfAxisZ, axisY));
+        const Vec crossY = Ops::sub(Ops::mul(selfAxisZ, axisX), Ops::mul(selfAxisX, axisZ));
+        const Vec crossZ = Ops::sub(Ops::mul(selfAxisX, axisY), Ops::mul(selfAxisY, axisX));
+
+        // Inverse-square magnitudes. The force scale also divides by the distance to normalize the separation vector.
+        const Vec strength = Ops::load(lanes.strength + k);
+        const Vec forceDistanceSqr = Ops::mul(forceDistance, forceDistance);
+        const Vec forceScale = Ops::div(Ops::mul(Ops::mul(forceStrength, strength), alignment), Ops::mul(forceDistanceSqr, forceDistance));
+        const Vec torqueMagnitude = Ops::div(Ops::mul(torqueStrength, strength), Ops::mul(torqueDistance, torqueDistance));
+
+        Ops::store(out.forceX + k, Ops::mul(rx, forceScale));
+        Ops::store(out.forceY + k, Ops::mul(ry, forceScale));
+        Ops::store(out.forceZ + k, Ops::mul(rz, forceScale));
+        Ops::store(out.torqueX + k, Ops::mul(crossX, torqueMagnitude));
+        Ops::store(out.torqueY + k, Ops::mul(crossY, torqueMagnitude));
+        Ops::store(out.torqueZ + k, Ops::mul(crossZ, torqueMagnitude));
+        Ops::store(out.distanceSqr + k, distanceSqr);
+    }
+}
+
+/**
+ * Influence flags of a group of pairs sharing a first magnet of type FirstType and second magnets of type SecondType.
+ * Instantiated for every combination of types, so the type rules are resolved at compile time. Layers are tested
+ * per direction, as the broadphase only rejects pairs where neither magnet can influence the other.
+ */
+template <typename Scalar, uint8_t FirstType, uint8_t SecondType>
+void influence_flags(const MagnetSnapshot& snapshot, const KernelInputs<Scalar>& inputs, uint32_t self, const uint32_t* partners, size_t count, const Scalar* distanceSqr, uint8_t* out) {
+    // Whether the first magnet can influence its partners does not depend on the partner, as they all share a type.
+    const uint8_t selfInfluences = MagnetInfluenceRule<SecondType, FirstType>::allows(snapshot.on[self], snapshot.magnetized[self]);
+    const Scalar selfRadiusSqr = inputs.radiusSqr[self];
+    const uint32_t selfLayer = snapshot.layer[self];
+    const uint32_t selfMask = snapshot.mask[self];
+
+    for (size_t k = 0; k < count; k++) {
+        const uint32_t j = partners[k];
+        const uint8_t first = uint8_t(distanceSqr[k] <= inputs.radiusSqr[j]) & uint8_t((snapshot.layer[j] & selfMask) != 0)
+            & MagnetInfluenceRule<FirstType, SecondType>::allows(snapshot.on[j], snapshot.magnetized[j]);
+        const uint8_t second = uint8_t(distanceSqr[k] <= selfRadiusSqr) & uint8_t((selfLayer & snapshot.mask[j]) != 0) & selfInfluences;
+        out[k] = uint8_t(first * MAGNET_PAIR_FIRST_INFLUENCED | second * MAGNET_PAIR_SECOND_INFLUENCED);
+    }
+}
+
+/**
+ * Specialized influence flag kernels, indexed by the types of the first and second magnets.
+ */
+template <typename Scalar>
+struct InfluenceFlagKernels {
+    using Function = void (*)(const MagnetSnapshot&, const KernelInputs<Scalar>&, uint32_t, const uint32_t*, size_t, const Scalar*, uint8_t*);
+
+    static constexpr Function TABLE[MAGNET_TYPE_COUNT][MAGNET_TYPE_COUNT] = {
+        { &influence_flags<Scalar, MAGNET_PERMANENT, MAGNET_PERMANENT>, &influence_flags<Scalar, MAGNET_PERMANENT, MAGNET_TEMPORARY>, &influence_flags<Scalar, MAGNET_PERMANENT, MAGNET_ELECTROMAGNET> },
+        { &influence_flags<Scalar, MAGNET_TEMPORARY, MAGNET_PERMANENT>, &influence_flags<Scalar, MAGNET_TEMPORARY, MAGNET_TEMPORARY>, &influence_flags<Scalar, MAGNET_TEMPORARY, MAGNET_ELECTROMAGNET> },
+        { &influence_flags<Scalar, MAGNET_ELECTROMAGNET, MAGNET_PERMANENT>, &influence_flags<Scalar, MAGNET_ELECTROMAGNET, MAGNET_TEMPORARY>, &influence_flags<Scalar, MAGNET_ELECTROMAGNET, MAGNET_ELECTROMAGNET> },
+    };
+};
+
+/**
+ * Pair evaluation, written once for both precisions.
+ */
+template <typename Scalar>
+void evaluate_pairs(const MagnetSnapshot& snapshot, const KernelInputs<Scalar>& inputs, const MagnetPair* pairs, size_t count, MagnetPairResultsT<Scalar>& out, size_t offset) {
+    using Ops = VectorOps<Scalar>;
+    uint32_t partners[MAGNET_BATCH_SIZE];
+    GatheredPartners<Scalar> lanes;
+    MagnetBatchResultT<Scalar> results;
+
+    size_t start = 0;
+    while (start < count) {
+        // Collect the run of pairs sharing this first magnet and the type of the second, up to one batch.
+        const uint32_t self = pairs[start].first;
+        const uint8_t partnerType = snapshot.type[pairs[start].second];
+        size_t batchCount = 0;
+        while (start + batchCount < count && batchCount < MAGNET_BATCH_SIZE) {
+            const MagnetPair& pair = pairs[start + batchCount];
+            if (pair.first != self || snapshot.type[pair.second] != partnerType) break;
+            partners[batchCount++] = pair.second;
+        }
+
+        const size_t padded = gather_partners(inputs, partners, batchCount, Ops::WIDTH, lanes);
+        evaluate_lanes<Ops>(self_of(inputs, self), lanes, padded, results);
+
+        const size_t base = offset + start;
+        std::copy(results.forceX, results.forceX + batchCount, out.forceX.begin() + base);
+        std::copy(results.forceY, results.forceY + batchCount, out.forceY.begin() + base);
+        std::copy(results.forceZ, results.forceZ + batchCount, out.forceZ.begin() + base);
+        std::copy(results.torqueX, results.torqueX + batchCount, out.torqueX.begin() + base);
+        std::copy(results.torqueY, results.torqueY + batchCount, out.torqueY.begin() + base);
+        std::copy(results.torqueZ, results.torqueZ + batchCount, out.torqueZ.begin() + base);
+        std::copy(results.distanceSqr, results.distanceSqr + batchCount, out.distanceSqr.begin() + base);
+        InfluenceFlagKernels<Scalar>::TABLE[snapshot.type[self]][partnerType](
+            snapshot, inputs, self, partners, batchCount, results.distanceSqr, out.influence.data() + base);
+
+        start += batchCount;
+    }
+}
+
+/**
+ * Batch kernel entry point, written once for both precisions.
+ */
+template <typename Ops, typename Scalar>
+void batch_kernel(const KernelInputs<Scalar>& inputs, uint32_t self, const uint32_t* others, size_t count, MagnetBatchResultT<Scalar>& out) {
+    GatheredPartners<Scalar> lanes;
+    const size_t padded = gather_partners(inputs, others, count, Ops::WIDTH, lanes);
+    evaluate_lanes<Ops>(self_of(inputs, self), lanes, padded, out);
+}
+
+} // namespace
+
+
+// --- Kernel state ---
+
+void MagnetKernelStateF::gather(const MagnetSnapshot& snapshot) {
+    const size_t count = snapshot.size();
+    posX.assign(snapshot.posX.begin(), snapshot.posX.begin() + count);
+    posY.assign(snapshot.posY.begin(), snapshot.posY.begin() + count);
+    posZ.assign(snapshot.posZ.begin(), snapshot.posZ.begin() + count);
+    axisX.assign(snapshot.axisX.begin(), snapshot.axisX.begin() + count);
+    axisY.assign(snapshot.axisY.begin(), snapshot.axisY.begin() + count);
+    axisZ.assign(snapshot.axisZ.begin(), snapshot.axisZ.begin() + count);
+    strength.assign(snapshot.strength.begin(), snapshot.strength.begin() + count);
+    radiusSqr.assign(snapshot.radiusSqr.begin(), snapshot.radiusSqr.begin() + count);
+}
+
+
+// --- Batch kernels ---
+
+void magnet_batch_kernel(const MagnetSnapshot& snapshot, uint32_t self, const uint32_t* others, size_t count, MagnetBatchResult& out) {
+    batch_kernel<VectorOps<double>>(inputs_of(snapshot), self, others, count, out);
+}
+
+void magnet_batch_kernel(const MagnetKernelStateF& state, uint32_t self, const uint32_t* others, size_t count, MagnetBatchResultT<float>& out) {
+    batch_kernel<VectorOps<float>>(inputs_of(state), self, others, count, out);
+}
+
+void magnet_batch_kernel_scalar(const MagnetSnapshot& snapshot, uint32_t self, const uint32_t* others, size_t count, MagnetBatchResult& out) {
+    batch_kernel<ScalarOps<double>>(inputs_of(snapshot), self, others, count, out);
+}
+
+void magnet_batch_kernel_scalar(const MagnetKernelStateF& state, uint32_t self, const uint32_t* others, size_t count, MagnetBatchResultT<float>& out) {
+    batch_kernel<ScalarOps<float>>(inputs_of(state), self, others, count, out);
+}
+
+void magnet_probe_kernel(const MagnetSnapshot& snapshot, const MagnetVector& position, const MagnetVector& axis, double strength,
+    const uint32_t* others, size_t count, MagnetBatchResult& out) {
+    using Ops = VectorOps<double>;
+    GatheredPartners<double> lanes;
+    const size_t padded = gather_partners(inputs_of(snapshot), others, count, Ops::WIDTH, lanes);
+    evaluate_lanes<Ops>(SelfMagnet<double>{ position.x, position.y, position.z, axis.x, axis.y, axis.z, strength }, lanes, padded, out);
+}
+
+void magnet_evaluate_pairs(const MagnetSnapshot& snapshot, const MagnetPair* pairs, size_t count, MagnetPairResults& out, size_t offset) {
+    evaluate_pairs(snapshot, inputs_of(snapshot), pairs, count, out, offset);
+}
+
+void magnet_evaluate_pairs(const MagnetSnapshot& snapshot, const MagnetKernelStateF& state, const MagnetPair* pairs, size_t count, MagnetPairResultsT<float>& out, size_t offset) {
+    evaluate_pairs(snapshot, inputs_of(state), pairs, count, out, offset);
+}
+
+const char* magnet_batch_kernel_isa() {
+    return ISA_NAME;
+}
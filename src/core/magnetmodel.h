@@ -0,0 +1,253 @@
+#ifndef MAGNET_MODEL_H
+#define MAGNET_MODEL_H
+
+#include <cmath>
+#include <cstdint>
+
+// Magnetism model shared by every solver path and by MagneticBody3D.
+// This header, like the rest of src/core, uses only plain C++ types so it can be built and benchmarked without Godot.
+
+/**
+ * Scaling factor applied to magnetic forces to make them visible in-game.
+ */
+constexpr double MAGNET_FORCE_SCALING = 100.0;
+
+/**
+ * Scaling factor applied to alignment torques to make them visible in-game.
+ */
+constexpr double MAGNET_TORQUE_SCALING = 10.0;
+
+/**
+ * Minimum separation used in force calculations, preventing division by zero and too large forces at very small distances.
+ */
+constexpr double MAGNET_FORCE_MIN_DISTANCE = 0.01;
+
+/**
+ * Minimum separation used in torque calculations, preventing division by zero and too large torques at very small distances.
+ */
+constexpr double MAGNET_TORQUE_MIN_DISTANCE = 0.1;
+
+/**
+ * Factor relating a magnet's strength to the square of its sphere of influence radius.
+ */
+constexpr double MAGNET_INFLUENCE_RADIUS_SQR_PER_STRENGTH_SQR = 500.0;
+
+/**
+ * Magnet types. These mirror MagneticBody3D::MagnetTypes.
+ */
+enum MagnetType : uint8_t {
+    MAGNET_PERMANENT = 0,
+    MAGNET_TEMPORARY = 1,
+    MAGNET_ELECTROMAGNET = 2
+};
+
+/**
+ * Number of magnet types.
+ */
+constexpr uint8_t MAGNET_TYPE_COUNT = 3;
+
+/**
+ * Magnetic layer bitmasks. These mirror MagneticBody3D's magnetic_layer and magnetic_mask: a magnet is only
+ * influenced by magnets on at least one of the layers in its mask.
+ */
+constexpr uint32_t MAGNET_DEFAULT_LAYERS = 1;
+constexpr uint32_t MAGNET_ALL_LAYERS = 0xFFFFFFFFu;
+
+/**
+ * Plain 3D vector used by the core.
+ */
+struct MagnetVector {
+    double x = 0.0, y = 0.0, z = 0.0;
+};
+
+
+// --- Pair model ---
+
+/**
+ * Computes the square of the sphere of influence radius of a magnet with the given strength.
+ *
+ * @param strength The magnet's strength.
+ * @return The square of the max influence radius.
+ */
+inline double magnet_influence_radius_sqr(double strength) {
+    return strength * strength * MAGNET_INFLUENCE_RADIUS_SQR_PER_STRENGTH_SQR;
+}
+
+/**
+ * Determines if a magnet can exert an influence on another, ignoring distance.
+ *
+ * @param selfType Type of the magnet which may be influenced.
+ * @param otherType Type of the magnet which may exert an influence.
+ * @param otherOn Whether the other magnet is on.
+ * @param otherMagnetized Whether the other magnet is magnetized.
+ * @return True if the other magnet is on and the magnet types allow an influence, false if not.
+ */
+inline bool magnet_can_be_influenced_by(uint8_t selfType, uint8_t otherType, bool otherOn, bool otherMagnetized) {
+    // If the other magnet is off, it exerts no influence.
+    if (!otherOn) {
+        return false;
+    }
+
+    // Unmagnetized temporary magnets do not influence other temporary magnets.
+    return !(selfType == MAGNET_TEMPORARY && otherType == MAGNET_TEMPORARY && !otherMagnetized);
+}
+
+/**
+ * Determines if the layers of a magnet let it influence another, ignoring type, state and distance.
+ *
+ * @param selfMask Magnetic mask of the magnet which may be influenced.
+ * @param otherLayer Magnetic layer of the magnet which may exert an influence.
+ * @return True if the other magnet is on a layer in the mask, false if not.
+ */
+inline bool magnet_layers_allow(uint32_t selfMask, uint32_t otherLayer) {
+    return (selfMask & otherLayer) != 0;
+}
+
+/**
+ * Compile-time specialization of magnet_can_be_influenced_by for one combination of magnet types.
+ * Only temporary magnets influencing temporary magnets depend on magnetization; every other combination reduces to
+ * the on-state, so kernels instantiated per combination evaluate the influence test without branching on types.
+ *
+ * @tparam SelfType Type of the magnet which may be influenced.
+ * @tparam OtherType Type of the magnet which may exert an influence.
+ */
+template <uint8_t SelfType, uint8_t OtherType>
+struct MagnetInfluenceRule {
+    /** Whether the other magnet's magnetization matters for this combination. */
+    static constexpr bool NEEDS_MAGNETIZED = SelfType == MAGNET_TEMPORARY && OtherType == MAGNET_TEMPORARY;
+
+    /**
+     * Same semantics as magnet_can_be_influenced_by for this combination of types.
+     *
+     * @param otherOn Whether the other magnet is on (0 or 1).
+     * @param otherMagnetized Whether the other magnet is magnetized (0 or 1).
+     * @return 1 if the other magnet can exert an influence, 0 if not.
+     */
+    static uint8_t allows(uint8_t otherOn, uint8_t otherMagnetized) {
+        return NEEDS_MAGNETIZED ? uint8_t(otherOn & otherMagnetized) : otherOn;
+    }
+};
+
+/**
+ * Force, torque and influence of one magnet on another, as computed together by magnet_calculate_interaction.
+ */
+struct MagnetInteraction {
+    /** The force the magnet experiences. */
+    MagnetVector force;
+
+    /** The torque the magnet experiences. */
+    MagnetVector torque;
+
+    /** Unclamped length of the separation vector. */
+    double distance = 0.0;
+
+    /** Whether the other magnet exerts an influence on the magnet. */
+    bool influenced = false;
+};
+
+/**
+ * Calculates the force and the torque exerted on a magnet by another magnet, and whether the other magnet influences
+ * it, from one separation length. The force and torque are computed even when the magnet is not influenced.
+ * The inverse square law is used for both magnitudes, scaled by the magnets' strengths; the force is further scaled
+ * by the magnets' relative alignment and points along the separation vector, and the torque is the cross product of
+ * the two pole directions.
+ *
+ * @param separation Vector from the magnet to the other magnet.
+ * @param selfAxis Normalized pole direction (local Z axis) of the magnet.
+ * @param selfStrength Strength of the magnet.
+ * @param otherAxis Normalized pole direction of the other magnet.
+ * @param otherStrength Strength of the other magnet.
+ * @param canBeInfluenced Whether types, state and layers let the other magnet influence the magnet, ignoring distance.
+ * @param otherRadiusSqr Square of the other magnet's sphere of influence radius.
+ * @return The force, the torque, the separation length and the influence flag.
+ */
+inline MagnetInteraction magnet_calculate_interaction(const MagnetVector& separation, const MagnetVector& selfAxis, double selfStrength, const MagnetVector& otherAxis, double otherStrength, bool canBeInfluenced, double otherRadiusSqr) {
+    const double distanceSqr = separation.x * separation.x + separation.y * separation.y + separation.z * separation.z;
+    const double distance = std::sqrt(distanceSqr);
+    const double forceDistance = distance < MAGNET_FORCE_MIN_DISTANCE ? MAGNET_FORCE_MIN_DISTANCE : distance;
+    const double torqueDistance = distance < MAGNET_TORQUE_MIN_DISTANCE ? MAGNET_TORQUE_MIN_DISTANCE : distance;
+
+    MagnetInteraction interaction;
+    interaction.distance = distance;
+    interaction.influenced = canBeInfluenced && distanceSqr <= otherRadiusSqr;
+
+    // Alignment factor (-1 to 1) determines whether attraction or repulsion occurs, and at what strength.
+    const double alignment = selfAxis.x * otherAxis.x + selfAxis.y * otherAxis.y + selfAxis.z * otherAxis.z;
+    const double forceMagnitude = MAGNET_FORCE_SCALING * selfStrength * otherStrength * alignment / (forceDistance * forceDistance);
+    const double scale = forceMagnitude / forceDistance;
+    interaction.force = MagnetVector{ separation.x * scale, separation.y * scale, separation.z * scale };
+
+    const double torqueMagnitude = MAGNET_TORQUE_SCALING * selfStrength * otherStrength / (torqueDistance * torqueDistance);
+    interaction.torque = MagnetVector{
+        (selfAxis.y * otherAxis.z - selfAxis.z * otherAxis.y) * torqueMagnitude,
+        (selfAxis.z * otherAxis.x - selfAxis.x * otherAxis.z) * torqueMagnitude,
+        (selfAxis.x * otherAxis.y - selfAxis.y * otherAxis.x) * torqueMagnitude
+    };
+    return interaction;
+}
+
+/**
+ * Calculates the magnetic force exerted on a magnet by another magnet (see magnet_calculate_interaction).
+ *
+ * @param separation Vector from the magnet to the other magnet.
+ * @param selfAxis Normalized pole direction (local Z axis) of the magnet.
+ * @param selfStrength Strength of the magnet.
+ * @param otherAxis Normalized pole direction of the other magnet.
+ * @param otherStrength Strength of the other magnet.
+ * @return The force the magnet experiences.
+ */
+inline MagnetVector magnet_calculate_force(const MagnetVector& separation, const MagnetVector& selfAxis, double selfStrength, const MagnetVector& otherAxis, double otherStrength) {
+    return magnet_calculate_interaction(separation, selfAxis, selfStrength, otherAxis, otherStrength, false, 0.0).force;
+}
+
+/**
+ * Calculates the alignment torque exerted on a magnet by another magnet due to their dipoles seeking to align (see
+ * magnet_calculate_interaction).
+ *
+ * @param separation Vector from the magnet to the other magnet.
+ * @param selfAxis Normalized pole direction (local Z axis) of the magnet.
+ * @param selfStrength Strength of the magnet.
+ * @param otherAxis Normalized pole direction of the other magnet.
+ * @param otherStrength Strength of the other magnet.
+ * @return The torque the magnet experiences.
+ */
+inline MagnetVector magnet_calculate_torque(const MagnetVector& separation, const MagnetVector& selfAxis, double selfStrength, const MagnetVector& otherAxis, double otherStrength) {
+    return magnet_calculate_interaction(separation, selfAxis, selfStrength, otherAxis, otherStrength, false, 0.0).torque;
+}
+
+
+// --- Force threshold cutoff ---
+
+/**
+ * Computes the square of the separation beyond which the force and the torque between two magnets stay below a
+ * minimum force, whatever their orientation. Both fall off with the inverse square of the separation, scaled by the
+ * product of the strengths, so the cutoff depends on both magnets.
+ *
+ * @param strength Strength of one magnet.
+ * @param otherStrength Strength of the other magnet.
+ * @param minForce The minimum force; must be positive.
+ * @return The square of the pair's cutoff radius.
+ */
+inline double magnet_cutoff_radius_sqr(double strength, double otherStrength, double minForce) {
+    const double scaling = MAGNET_FORCE_SCALING > MAGNET_TORQUE_SCALING ? MAGNET_FORCE_SCALING : MAGNET_TORQUE_SCALING;
+    return scaling * std::fabs(strength * otherStrength) / minForce;
+}
+
+/**
+ * Computes the weight applied to a pair's force and torque near its cutoff, so pairs fade out instead of popping
+ * when they cross it: 1 up to the inner radius, then a smoothstep in the squared separation down to 0 at the cutoff.
+ *
+ * @param distanceSqr Squared separation of the pair.
+ * @param cutoffSqr Squared cutoff radius of the pair.
+ * @param innerSqr Squared radius where the falloff starts; at most cutoffSqr.
+ * @return The weight, between 0 and 1.
+ */
+inline double magnet_cutoff_weight(double distanceSqr, double cutoffSqr, double innerSqr) {
+    if (distanceSqr <= innerSqr) return 1.0;
+    if (distanceSqr >= cutoffSqr) return 0.0;
+    const double t = (cutoffSqr - distanceSqr) / (cutoffSqr - innerSqr);
+    return t * t * (3.0 - 2.0 * t);
+}
+
+
+#endif // MAGNET_MODEL_H
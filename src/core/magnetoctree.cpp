@@ -0,0 +1,310 @@
+#include "magnetoctree.h"
+#include "magnetkernel.h"
+#include <algorithm>
+#include <cmath>
+
+// Magnets per leaf before a node is subdivided.
+static constexpr uint32_t LEAF_SIZE = 8;
+
+// Depth limit guarding against many magnets at (almost) the same position.
+static constexpr int MAX_DEPTH = 24;
+
+// Receivers per solver task. Fixed, so the task split never depends on the number of threads.
+static constexpr uint32_t RECEIVERS_PER_TASK = 128;
+
+// --- Settings ---
+
+double MagnetOctree::get_opening_angle() const {
+    return openingAngle;
+}
+
+void MagnetOctree::set_opening_angle(double newAngle) {
+    if (newAngle >= 0.0) {
+        openingAngle = newAngle;
+    }
+}
+
+
+// --- Core methods ---
+
+void MagnetOctree::build(const MagnetSnapshot& snapshot) {
+    nodes.clear();
+    magnetIndices.clear();
+
+    // Magnets that are off neither exert nor experience any influence.
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        if (snapshot.on[i]) {
+            magnetIndices.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    scratch.resize(magnetIndices.size());
+
+    if (!magnetIndices.empty()) {
+        build_node(snapshot, 0, static_cast<uint32_t>(magnetIndices.size()), 0);
+    }
+}
+
+int32_t MagnetOctree::build_node(const MagnetSnapshot& snapshot, uint32_t start, uint32_t end, int depth) {
+    const int32_t nodeIndex = static_cast<int32_t>(nodes.size());
+    nodes.emplace_back();
+
+    // Compute bounds, radius range and aggregates in a single pass.
+    Node node;
+    node.minX = node.minY = node.minZ = INFINITY;
+    node.maxX = node.maxY = node.maxZ = -INFINITY;
+    node.minRadiusSqr = INFINITY;
+    node.maxRadiusSqr = 0.0;
+    node.anyLayers = 0;
+    node.commonLayers = MAGNET_ALL_LAYERS;
+    node.start = start;
+    node.end = end;
+    std::fill(std::begin(node.children), std::end(node.children), -1);
+
+    double weights[2] = { 0.0, 0.0 };
+    for (uint32_t k = start; k < end; k++) {
+        const uint32_t i = magnetIndices[k];
+        node.minX = std::min(node.minX, snapshot.posX[i]);
+        node.minY = std::min(node.minY, snapshot.posY[i]);
+        node.minZ = std::min(node.minZ, snapshot.posZ[i]);
+        node.maxX = std::max(node.maxX, snapshot.posX[i]);
+        node.maxY = std::max(node.maxY, snapshot.posY[i]);
+        node.maxZ = std::max(node.maxZ, snapshot.posZ[i]);
+        node.minRadiusSqr = std::min(node.minRadiusSqr, snapshot.radiusSqr[i]);
+        node.maxRadiusSqr = std::max(node.maxRadiusSqr, snapshot.radiusSqr[i]);
+        node.anyLayers |= snapshot.layer[i];
+        node.commonLayers &= snapshot.layer[i];
+
+        // Unmagnetized temporary magnets only influence non-temporary magnets.
+        const bool seenByTemporary = snapshot.type[i] != MAGNET_TEMPORARY || snapshot.magnetized[i];
+        for (int group = 0; group < 2; group++) {
+            if (group == 1 && !seenByTemporary) continue;
+
+            Aggregate& aggregate = node.aggregates[group];
+            const double weight = std::abs(snapshot.strength[i]);
+            aggregate.count++;
+            aggregate.centerX += snapshot.posX[i] * weight;
+            aggregate.centerY += snapshot.posY[i] * weight;
+            aggregate.centerZ += snapshot.posZ[i] * weight;
+            aggregate.dipoleX += snapshot.axisX[i] * snapshot.strength[i];
+            aggregate.dipoleY += snapshot.axisY[i] * snapshot.strength[i];
+            aggregate.dipoleZ += snapshot.axisZ[i] * snapshot.strength[i];
+            weights[group] += weight;
+        }
+    }
+
+    // Normalize centroids; zero-strength groups fall back to the middle of the bounds.
+    for (int group = 0; group < 2; group++) {
+        Aggregate& aggregate = node.aggregates[group];
+        if (weights[group] > 0.0) {
+            aggregate.centerX /= weights[group];
+            aggregate.centerY /= weights[group];
+            aggregate.centerZ /= weights[group];
+        } else {
+            aggregate.centerX = (node.minX + node.maxX) * 0.5;
+            aggregate.centerY = (node.minY + node.maxY) * 0.5;
+            aggregate.centerZ = (node.minZ + node.maxZ) * 0.5;
+        }
+    }
+
+    const bool degenerate = node.minX == node.maxX && node.minY == node.maxY && node.minZ == node.maxZ;
+    node.leaf = end - start <= LEAF_SIZE || depth >= MAX_DEPTH || degenerate;
+    nodes[nodeIndex] = node;
+    if (node.leaf) {
+        return nodeIndex;
+    }
+
+    // Partition the magnets into the eight octants around the middle of the bounds.
+    const double midX = (node.minX + node.maxX) * 0.5;
+    const double midY = (node.minY + node.maxY) * 0.5;
+    const double midZ = (node.minZ + node.maxZ) * 0.5;
+    auto octant_of = [&](uint32_t i) {
+        return (snapshot.posX[i] > midX ? 1 : 0) | (snapshot.posY[i] > midY ? 2 : 0) | (snapshot.posZ[i] > midZ ? 4 : 0);
+    };
+
+    uint32_t octantStart[9] = { 0 };
+    for (uint32_t k = start; k < end; k++) {
+        octantStart[octant_of(magnetIndices[k]) + 1]++;
+    }
+    for (int octant = 0; octant < 8; octant++) {
+        octantStart[octant + 1] += octantStart[octant];
+    }
+    uint32_t cursor[8];
+    std::copy(octantStart, octantStart + 8, cursor);
+    for (uint32_t k = start; k < end; k++) {
+        const uint32_t i = magnetIndices[k];
+        scratch[start + cursor[octant_of(i)]++] = i;
+    }
+    std::copy(scratch.begin() + start, scratch.begin() + end, magnetIndices.begin() + start);
+
+    // Build the non-empty children. The nodes vector may grow during recursion, so children are written by index.
+    for (int octant = 0; octant < 8; octant++) {
+        const uint32_t childStart = start + octantStart[octant];
+        const uint32_t childEnd = start + octantStart[octant + 1];
+        if (childStart == childEnd) continue;
+
+        const int32_t child = build_node(snapshot, childStart, childEnd, depth + 1);
+        nodes[nodeIndex].children[octant] = child;
+    }
+
+    return nodeIndex;
+}
+
+void MagnetOctree::solve(MagnetSnapshot& snapshot, const MagnetTaskRunner& runner) {
+    exactEvaluations = 0;
+    farFieldEvaluations = 0;
+#ifdef MAGNET_PROFILING
+    kernelEvaluations = 0;
+    culledNodes = 0;
+#endif
+    if (nodes.empty()) return;
+
+    const uint32_t receiverCount = static_cast<uint32_t>(magnetIndices.size());
+    const uint32_t taskCount = (receiverCount + RECEIVERS_PER_TASK - 1) / RECEIVERS_PER_TASK;
+    taskStates.resize(taskCount);
+
+    runner(taskCount, [&](uint32_t taskIndex) {
+        TaskState& state = taskStates[taskIndex];
+        state.exactEvaluations = 0;
+        state.farFieldEvaluations = 0;
+#ifdef MAGNET_PROFILING
+        state.kernelEvaluations = 0;
+        state.culledNodes = 0;
+#endif
+
+        const uint32_t start = taskIndex * RECEIVERS_PER_TASK;
+        solve_receivers(snapshot, start, std::min(start + RECEIVERS_PER_TASK, receiverCount), state);
+    });
+
+    for (const TaskState& state : taskStates) {
+        exactEvaluations += state.exactEvaluations;
+        farFieldEvaluations += state.farFieldEvaluations;
+#ifdef MAGNET_PROFILING
+        kernelEvaluations += state.kernelEvaluations;
+        culledNodes += state.culledNodes;
+#endif
+    }
+}
+
+void MagnetOctree::solve_receivers(MagnetSnapshot& snapshot, uint32_t start, uint32_t end, TaskState& state) const {
+    const double openingAngleSqr = openingAngle * openingAngle;
+    std::vector<int32_t>& stack = state.stack;
+    MagnetBatchResult results;
+
+    for (uint32_t receiver = start; receiver < end; receiver++) {
+        const uint32_t i = magnetIndices[receiver];
+        const double px = snapshot.posX[i];
+        const double py = snapshot.posY[i];
+        const double pz = snapshot.posZ[i];
+        const int group = snapshot.type[i] == MAGNET_TEMPORARY ? 1 : 0;
+        const uint32_t mask = snapshot.mask[i];
+
+        stack.clear();
+        stack.push_back(0);
+        while (!stack.empty()) {
+            const Node& node = nodes[stack.back()];
+            stack.pop_back();
+
+            const Aggregate& aggregate = node.aggregates[group];
+            if (aggregate.count == 0 || (node.anyLayers & mask) == 0) continue;
+
+            // Skip the node if the receiver is outside the sphere of influence of every magnet in it.
+            const double nearX = std::max({ node.minX - px, 0.0, px - node.maxX });
+            const double nearY = std::max({ node.minY - py, 0.0, py - node.maxY });
+            const double nearZ = std::max({ node.minZ - pz, 0.0, pz - node.maxZ });
+            const double nearSqr = nearX * nearX + nearY * nearY + nearZ * nearZ;
+            if (nearSqr > node.maxRadiusSqr) {
+#ifdef MAGNET_PROFILING
+                state.culledNodes++;
+#endif
+                continue;
+            }
+
+            if (node.leaf) {
+                // Evaluate the leaf's magnets exactly, in batches with the vector kernel.
+                for (uint32_t batchStart = node.start; batchStart < node.end; batchStart += MAGNET_BATCH_SIZE) {
+                    const size_t count = std::min<size_t>(node.end - batchStart, MAGNET_BATCH_SIZE);
+                    magnet_batch_kernel(snapshot, i, &magnetIndices[batchStart], count, results);
+#ifdef MAGNET_PROFILING
+                    state.kernelEvaluations += count;
+#endif
+
+                    for (size_t k = 0; k < count; k++) {
+                        const uint32_t j = magnetIndices[batchStart + k];
+                        if (j == i || results.distanceSqr[k] > snapshot.radiusSqr[j] || !snapshot.can_be_influenced_by(i, j)) continue;
+
+                        snapshot.forceX[i] += results.forceX[k];
+                        snapshot.forceY[i] += results.forceY[k];
+                        snapshot.forceZ[i] += results.forceZ[k];
+                        snapshot.torqueX[i] += results.torqueX[k];
+                        snapshot.torqueY[i] += results.torqueY[k];
+                        snapshot.torqueZ[i] += results.torqueZ[k];
+                        snapshot.influenced[i] = 1;
+                        state.exactEvaluations++;
+                    }
+                }
+                continue;
+            }
+
+            // Approximate the node as one dipole if the receiver is outside it, inside the sphere of influence of
+            // every magnet in it, masks a layer every magnet in it is on, and the node appears small enough from the
+            // receiver.
+            const double farX = std::max(std::abs(px - node.minX), std::abs(px - node.maxX));
+            const double farY = std::max(std::abs(py - node.minY), std::abs(py - node.maxY));
+            const double farZ = std::max(std::abs(pz - node.minZ), std::abs(pz - node.maxZ));
+            const double farSqr = farX * farX + farY * farY + farZ * farZ;
+
+            const double rx = aggregate.centerX - px;
+            const double ry = aggregate.centerY - py;
+            const double rz = aggregate.centerZ - pz;
+            const double distanceSqr = rx * rx + ry * ry + rz * rz;
+            const double size = std::max({ node.maxX - node.minX, node.maxY - node.minY, node.maxZ - node.minZ });
+
+            if (nearSqr > 0.0 && farSqr <= node.minRadiusSqr && (node.commonLayers & mask) != 0
+                && size * size < openingAngleSqr * distanceSqr) {
+                // Same force and torque model as the pairwise kernel, with the aggregate dipole (its strength folded
+                // into its axis) as the source.
+                const MagnetVector dipole{ aggregate.dipoleX, aggregate.dipoleY, aggregate.dipoleZ };
+                const MagnetInteraction interaction = magnet_calculate_interaction(MagnetVector{ rx, ry, rz }, snapshot.axis(i), snapshot.strength[i], dipole, 1.0, true, 0.0);
+                snapshot.forceX[i] += interaction.force.x;
+                snapshot.forceY[i] += interaction.force.y;
+                snapshot.forceZ[i] += interaction.force.z;
+                snapshot.torqueX[i] += interaction.torque.x;
+                snapshot.torqueY[i] += interaction.torque.y;
+                snapshot.torqueZ[i] += interaction.torque.z;
+
+                snapshot.influenced[i] = 1;
+                state.farFieldEvaluations++;
+                continue;
+            }
+
+            for (const int32_t child : node.children) {
+                if (child >= 0) stack.push_back(child);
+            }
+        }
+    }
+}
+
+
+// --- Stats ---
+
+uint64_t MagnetOctree::get_exact_evaluations() const {
+    return exactEvaluations;
+}
+
+uint64_t MagnetOctree::get_far_field_evaluations() const {
+    return farFieldEvaluations;
+}
+
+size_t MagnetOctree::get_node_count() const {
+    return nodes.size();
+}
+
+#ifdef MAGNET_PROFILING
+uint64_t MagnetOctree::get_kernel_evaluations() const {
+    return kernelEvaluations;
+}
+
+uint64_t MagnetOctree::get_culled_nodes() const {
+    return culledNodes;
+}
+#endif
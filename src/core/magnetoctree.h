@@ -0,0 +1,217 @@
+#ifndef MAGNET_OCTREE_H
+#define MAGNET_OCTREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "magnetprofiling.h"
+#include "magnetsnapshot.h"
+#include "magnettasks.h"
+
+/**
+ * Barnes-Hut octree for approximating the magnetic influence of distant clusters of magnets.
+ *
+ * Every active magnet is inserted into the tree. Each node summarizes its magnets as an aggregate dipole:
+ * the summed strength-weighted pole axis (sum of strength * axis) placed at the strength-weighted centroid.
+ * Because the force and torque models are linear in strength * axis of the source magnet, a cluster collapsed
+ * onto its centroid produces exactly the pairwise result, and the error grows with the cluster's size relative
+ * to its distance. The opening angle bounds that ratio.
+ *
+ * Spheres of influence are kept exact: a node is skipped when the receiver is outside every sphere of its magnets,
+ * and only approximated when the receiver is inside every sphere. Nodes straddling the cutoff are opened.
+ * Magnetic layers are kept exact the same way: a node is skipped when the receiver masks none of its magnets' layers,
+ * and only approximated when the receiver masks a layer all of its magnets share.
+ */
+class MagnetOctree {
+public:
+
+    // --- Constructor ---
+
+    /** Default constructor */
+    MagnetOctree() = default;
+
+
+    // --- Settings ---
+
+    /**
+     * Gets the opening angle (node size / distance) below which a node is approximated as a single dipole.
+     *
+     * @return The opening angle.
+     */
+    double get_opening_angle() const;
+
+    /**
+     * Sets the opening angle. Zero always opens nodes (exact, but slower than the pairwise path);
+     * larger values approximate more aggressively. Negative values are ignored.
+     *
+     * @param newAngle The new opening angle.
+     */
+    void set_opening_angle(double newAngle);
+
+
+    // --- Core methods ---
+
+    /**
+     * Builds the tree from the active magnets of the snapshot.
+     *
+     * @param snapshot The magnet state for the current tick.
+     */
+    void build(const MagnetSnapshot& snapshot);
+
+    /**
+     * Accumulates the force and torque on every active magnet of the snapshot into its result buffers.
+     * The snapshot must be the one the tree was built from.
+     * Receivers are split into fixed-size tasks; each receiver only writes its own results, so the outcome does not
+     * depend on how the runner schedules the tasks.
+     *
+     * @param snapshot The magnet state for the current tick.
+     * @param runner Runs the receiver tasks, possibly in parallel.
+     */
+    void solve(MagnetSnapshot& snapshot, const MagnetTaskRunner& runner = magnet_run_tasks_serial);
+
+
+    // --- Stats for the last solve call ---
+
+    /**
+     * Gets the number of exact pair evaluations performed at leaves.
+     */
+    uint64_t get_exact_evaluations() const;
+
+    /**
+     * Gets the number of aggregate dipole evaluations performed.
+     */
+    uint64_t get_far_field_evaluations() const;
+
+    /**
+     * Gets the number of nodes in the tree.
+     */
+    size_t get_node_count() const;
+
+#ifdef MAGNET_PROFILING
+    /**
+     * Gets the number of source magnets evaluated by the leaf kernels, including those outside the receiver's sphere.
+     */
+    uint64_t get_kernel_evaluations() const;
+
+    /**
+     * Gets the number of nodes skipped because the receiver was outside every sphere of influence in them.
+     */
+    uint64_t get_culled_nodes() const;
+#endif
+
+private:
+
+    // --- Private types ---
+
+    /**
+     * Aggregate dipole of a group of source magnets.
+     */
+    struct Aggregate {
+        /** Number of magnets in the group. */
+        uint32_t count = 0;
+        /** Strength-weighted centroid. */
+        double centerX = 0.0, centerY = 0.0, centerZ = 0.0;
+        /** Sum of strength * axis. */
+        double dipoleX = 0.0, dipoleY = 0.0, dipoleZ = 0.0;
+    };
+
+    /**
+     * A node of the octree.
+     */
+    struct Node {
+        /** Tight bounds of the magnets in this node. */
+        double minX, minY, minZ;
+        double maxX, maxY, maxZ;
+
+        /** Smallest and largest sphere of influence (squared) among the magnets in this node. */
+        double minRadiusSqr, maxRadiusSqr;
+
+        /** Layers of any magnet, and layers shared by every magnet, in this node. */
+        uint32_t anyLayers, commonLayers;
+
+        /**
+         * Aggregates for the two kinds of receivers.
+         * [0]: all magnets, as seen by permanent magnets and electromagnets.
+         * [1]: magnets excluding unmagnetized temporary magnets, as seen by temporary magnets.
+         */
+        Aggregate aggregates[2];
+
+        /** Index of each child node, or -1. Unused for leaves. */
+        int32_t children[8];
+
+        /** Range [start, end) of this node's magnets in the magnet index array. */
+        uint32_t start, end;
+
+        /** Whether this node is a leaf. */
+        bool leaf;
+    };
+
+    /**
+     * Per-task traversal state and counters.
+     */
+    struct TaskState {
+        /** Traversal stack reused between receivers. */
+        std::vector<int32_t> stack;
+        uint64_t exactEvaluations = 0;
+        uint64_t farFieldEvaluations = 0;
+#ifdef MAGNET_PROFILING
+        uint64_t kernelEvaluations = 0;
+        uint64_t culledNodes = 0;
+#endif
+    };
+
+
+    // --- Private fields ---
+
+    /**
+     * Opening angle below which nodes are approximated.
+     */
+    double openingAngle = 0.5;
+
+    /**
+     * Tree nodes; the root is node 0.
+     */
+    std::vector<Node> nodes;
+
+    /**
+     * Snapshot indices of the active magnets, permuted so each node's magnets are contiguous.
+     */
+    std::vector<uint32_t> magnetIndices;
+
+    /**
+     * Scratch buffer used while partitioning magnets into octants.
+     */
+    std::vector<uint32_t> scratch;
+
+    /**
+     * State of each receiver task, indexed by task.
+     */
+    std::vector<TaskState> taskStates;
+
+    /** Stats for the last solve call. */
+    uint64_t exactEvaluations = 0;
+    uint64_t farFieldEvaluations = 0;
+#ifdef MAGNET_PROFILING
+    uint64_t kernelEvaluations = 0;
+    uint64_t culledNodes = 0;
+#endif
+
+
+    // --- Private helpers ---
+
+    /**
+     * Recursively builds the node covering magnetIndices[start, end).
+     *
+     * @return The index of the new node.
+     */
+    int32_t build_node(const MagnetSnapshot& snapshot, uint32_t start, uint32_t end, int depth);
+
+    /**
+     * Accumulates the results of the receivers magnetIndices[start, end).
+     */
+    void solve_receivers(MagnetSnapshot& snapshot, uint32_t start, uint32_t end, TaskState& state) const;
+};
+
+
+#endif // MAGNET_OCTREE_H
@@ -0,0 +1,78 @@
+#ifndef MAGNET_PROFILING_H
+#define MAGNET_PROFILING_H
+
+// Profiling instrumentation is compiled only into debug builds, so release builds carry none of it.
+// godot-cpp defines DEBUG_ENABLED for editor and template_debug builds; native builds may define MAGNET_PROFILING.
+#if defined(DEBUG_ENABLED) && !defined(MAGNET_PROFILING)
+#define MAGNET_PROFILING
+#endif
+
+#ifdef MAGNET_PROFILING
+
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Per-tick magnetism profile. Counters and timings cover the last solver step (or debug draw rebuild).
+ */
+struct MagnetProfile {
+    /** Pairs (or octree interactions) evaluated by the force kernels. */
+    uint64_t consideredPairs = 0;
+
+    /** Pairs rejected by the broadphase, or octree nodes rejected by the sphere of influence test. */
+    uint64_t culledPairs = 0;
+
+    /** Pair influences accumulated into a magnet's result (counted once per influenced magnet). */
+    uint64_t appliedPairs = 0;
+
+    /** Temporary magnets magnetized after the step. */
+    uint64_t magnetizedTemporaries = 0;
+
+    /** Bodies that received their net force and torque after the step. */
+    uint64_t forcedBodies = 0;
+
+    /** Force and torque calls made into the physics server after the step (at most two per forced body). */
+    uint64_t physicsCalls = 0;
+
+    /** Broadphase neighbor list rebuilds so far, and solves since the current list was built. */
+    uint64_t neighborListRebuilds = 0;
+    uint64_t neighborListAge = 0;
+
+    /** Level-of-detail pairs that reused their cached results. */
+    uint64_t lodCachedPairs = 0;
+
+    /** Time spent in each solver phase, in milliseconds. */
+    double gatherMsec = 0.0;
+    double solveMsec = 0.0;
+    double applyMsec = 0.0;
+
+    /** Time the physics thread waited for a pipelined solve, and spent solving synchronous magnets, in milliseconds. */
+    double waitMsec = 0.0;
+    double synchronousSolveMsec = 0.0;
+
+    /** Time spent in the last MagneticDebugDraw rebuild, in milliseconds. */
+    double debugDrawMsec = 0.0;
+};
+
+/**
+ * Measures the time elapsed since construction.
+ */
+class MagnetProfileTimer {
+public:
+    MagnetProfileTimer() : start(std::chrono::steady_clock::now()) {}
+
+    /**
+     * Gets the time elapsed since construction, in milliseconds.
+     */
+    double elapsed_msec() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif // MAGNET_PROFILING
+
+
+#endif // MAGNET_PROFILING_H
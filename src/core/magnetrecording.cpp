@@ -0,0 +1,306 @@
+#include "magnetrecording.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static constexpr char RECORD_MAGIC[8] = { 'M', 'A', 'G', 'R', 'E', 'C', '0', '1' };
+
+// File header: magic, version, header size.
+static constexpr size_t FILE_HEADER_SIZE = sizeof(RECORD_MAGIC) + 2 * sizeof(uint32_t);
+
+// Columns per frame, by element type.
+static constexpr size_t DOUBLE_COLUMNS = 18;
+static constexpr size_t WORD_COLUMNS = 2;
+static constexpr size_t BYTE_COLUMNS = 4;
+
+size_t magnet_record_frame_size(uint32_t magnetCount) {
+    const size_t count = magnetCount;
+    const size_t unpadded = sizeof(MagnetRecordFrameHeader) + count * sizeof(uint64_t) + DOUBLE_COLUMNS * count * sizeof(double)
+        + WORD_COLUMNS * count * sizeof(uint32_t) + BYTE_COLUMNS * count;
+    return (unpadded + 7) / 8 * 8;
+}
+
+
+// --- Writer ---
+
+MagnetRecordWriter::~MagnetRecordWriter() {
+    close();
+}
+
+bool MagnetRecordWriter::open(const std::string& path) {
+    close();
+    file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) return false;
+
+    // Frames are buffered here, so the stream's own buffer would only add a copy.
+    std::setvbuf(file, nullptr, _IONBF, 0);
+    good = true;
+    frameCount = 0;
+    byteCount = 0;
+    buffer.clear();
+    buffer.reserve(FLUSH_THRESHOLD * 2);
+
+    const uint32_t version = MAGNET_RECORD_VERSION;
+    const uint32_t headerSize = static_cast<uint32_t>(FILE_HEADER_SIZE);
+    append(RECORD_MAGIC, sizeof(RECORD_MAGIC));
+    append(&version, sizeof(version));
+    append(&headerSize, sizeof(headerSize));
+    return flush();
+}
+
+void MagnetRecordWriter::write_frame(const MagnetSnapshot& snapshot, const uint64_t* ids, const MagnetSolver& solver, uint32_t flags) {
+    if (file == nullptr) return;
+
+    const size_t count = snapshot.size();
+    MagnetRecordFrameHeader header = {};
+    header.magnetCount = static_cast<uint32_t>(count);
+    header.flags = flags;
+    if (solver.get_mode() == MAGNET_SOLVER_PAIRWISE && !solver.get_lod_tiers().empty()) {
+        header.flags |= MAGNET_RECORD_LOD;
+    }
+    header.tick = frameCount;
+    header.timestep = solver.get_timestep();
+    header.substepDistance = solver.get_substep_distance();
+    header.minForce = solver.get_min_force();
+    header.cutoffFalloff = solver.get_cutoff_falloff();
+    header.openingAngle = solver.get_octree().get_opening_angle();
+    header.maxSubsteps = solver.get_max_substeps();
+    header.mode = solver.get_mode();
+    header.precision = solver.get_precision();
+
+    const size_t start = buffer.size();
+    append(&header, sizeof(header));
+    if (ids != nullptr) {
+        append(ids, count * sizeof(uint64_t));
+    } else {
+        buffer.resize(buffer.size() + count * sizeof(uint64_t), 0);
+    }
+    for (const std::vector<double>* column : {
+             &snapshot.posX, &snapshot.posY, &snapshot.posZ, &snapshot.axisX, &snapshot.axisY, &snapshot.axisZ,
+             &snapshot.strength, &snapshot.radiusSqr, &snapshot.velX, &snapshot.velY, &snapshot.velZ, &snapshot.inverseMass,
+             &snapshot.forceX, &snapshot.forceY, &snapshot.forceZ, &snapshot.torqueX, &snapshot.torqueY, &snapshot.torqueZ }) {
+        append(column->data(), count * sizeof(double));
+    }
+    for (const std::vector<uint32_t>* column : { &snapshot.layer, &snapshot.mask }) {
+        append(column->data(), count * sizeof(uint32_t));
+    }
+    for (const std::vector<uint8_t>* column : { &snapshot.type, &snapshot.on, &snapshot.magnetized, &snapshot.influenced }) {
+        append(column->data(), count);
+    }
+    buffer.resize(start + magnet_record_frame_size(header.magnetCount), 0);
+
+    frameCount++;
+    if (buffer.size() >= FLUSH_THRESHOLD) {
+        flush();
+    }
+}
+
+bool MagnetRecordWriter::flush() {
+    if (file == nullptr) return false;
+    if (!buffer.empty()) {
+        good = std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size() && good;
+        byteCount += buffer.size();
+        buffer.clear();
+    }
+    return good;
+}
+
+bool MagnetRecordWriter::close() {
+    if (file == nullptr) return false;
+    const bool flushed = flush();
+    const bool closed = std::fclose(file) == 0;
+    file = nullptr;
+    return flushed && closed;
+}
+
+bool MagnetRecordWriter::is_open() const {
+    return file != nullptr;
+}
+
+uint64_t MagnetRecordWriter::get_frame_count() const {
+    return frameCount;
+}
+
+uint64_t MagnetRecordWriter::get_byte_count() const {
+    return byteCount + buffer.size();
+}
+
+void MagnetRecordWriter::append(const void* source, size_t count) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(source);
+    buffer.insert(buffer.end(), bytes, bytes + count);
+}
+
+
+// --- Frames ---
+
+void MagnetRecordFrame::load_state(MagnetSnapshot& snapshot) const {
+    const size_t count = header.magnetCount;
+    snapshot.resize(count);
+    std::copy(posX, posX + count, snapshot.posX.begin());
+    std::copy(posY, posY + count, snapshot.posY.begin());
+    std::copy(posZ, posZ + count, snapshot.posZ.begin());
+    std::copy(axisX, axisX + count, snapshot.axisX.begin());
+    std::copy(axisY, axisY + count, snapshot.axisY.begin());
+    std::copy(axisZ, axisZ + count, snapshot.axisZ.begin());
+    std::copy(strength, strength + count, snapshot.strength.begin());
+    std::copy(radiusSqr, radiusSqr + count, snapshot.radiusSqr.begin());
+    std::copy(velX, velX + count, snapshot.velX.begin());
+    std::copy(velY, velY + count, snapshot.velY.begin());
+    std::copy(velZ, velZ + count, snapshot.velZ.begin());
+    std::copy(inverseMass, inverseMass + count, snapshot.inverseMass.begin());
+    std::copy(layer, layer + count, snapshot.layer.begin());
+    std::copy(mask, mask + count, snapshot.mask.begin());
+    std::copy(type, type + count, snapshot.type.begin());
+    std::copy(on, on + count, snapshot.on.begin());
+    std::copy(magnetized, magnetized + count, snapshot.magnetized.begin());
+}
+
+void MagnetRecordFrame::load_settings(MagnetSolver& solver) const {
+    solver.set_mode(header.mode == MAGNET_SOLVER_OCTREE ? MAGNET_SOLVER_OCTREE : MAGNET_SOLVER_PAIRWISE);
+    solver.set_precision(header.precision == MAGNET_PRECISION_FLOAT ? MAGNET_PRECISION_FLOAT : MAGNET_PRECISION_DOUBLE);
+    solver.set_substep_distance(header.substepDistance);
+    solver.set_max_substeps(header.maxSubsteps);
+    solver.set_timestep(header.timestep);
+    solver.set_min_force(header.minForce);
+    solver.set_cutoff_falloff(header.cutoffFalloff);
+    if (solver.get_octree().get_opening_angle() != header.openingAngle) {
+        solver.get_octree().set_opening_angle(header.openingAngle);
+        solver.invalidate();
+    }
+}
+
+
+// --- Reader ---
+
+MagnetRecordReader::~MagnetRecordReader() {
+    close();
+}
+
+bool MagnetRecordReader::open(const std::string& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE fileHandleWin = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandleWin == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandleWin, &fileSize) || fileSize.QuadPart < (LONGLONG)FILE_HEADER_SIZE) {
+        CloseHandle(fileHandleWin);
+        return false;
+    }
+    HANDLE mappingHandleWin = CreateFileMappingA(fileHandleWin, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandleWin == nullptr) {
+        CloseHandle(fileHandleWin);
+        return false;
+    }
+    const void* view = MapViewOfFile(mappingHandleWin, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mappingHandleWin);
+        CloseHandle(fileHandleWin);
+        return false;
+    }
+    fileHandle = fileHandleWin;
+    mappingHandle = mappingHandleWin;
+    data = static_cast<const uint8_t*>(view);
+    size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    const int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) return false;
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || status.st_size < (off_t)FILE_HEADER_SIZE) {
+        ::close(descriptor);
+        return false;
+    }
+    void* mapping = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+    // The mapping keeps the file referenced, so the descriptor is not needed anymore.
+    ::close(descriptor);
+    if (mapping == MAP_FAILED) return false;
+    // Frames are read front to back during replay.
+    madvise(mapping, static_cast<size_t>(status.st_size), MADV_SEQUENTIAL);
+    data = static_cast<const uint8_t*>(mapping);
+    size = static_cast<size_t>(status.st_size);
+#endif
+
+    uint32_t version;
+    uint32_t headerSize;
+    std::memcpy(&version, data + sizeof(RECORD_MAGIC), sizeof(version));
+    std::memcpy(&headerSize, data + sizeof(RECORD_MAGIC) + sizeof(version), sizeof(headerSize));
+    if (std::memcmp(data, RECORD_MAGIC, sizeof(RECORD_MAGIC)) != 0 || version != MAGNET_RECORD_VERSION || headerSize != FILE_HEADER_SIZE) {
+        close();
+        return false;
+    }
+
+    // Index the whole frames; a frame cut short by an interrupted recording ends the index.
+    frameOffsets.clear();
+    size_t offset = FILE_HEADER_SIZE;
+    while (offset + sizeof(MagnetRecordFrameHeader) <= size) {
+        MagnetRecordFrameHeader header;
+        std::memcpy(&header, data + offset, sizeof(header));
+        const size_t frameSize = magnet_record_frame_size(header.magnetCount);
+        if (frameSize > size - offset) break;
+        frameOffsets.push_back(offset);
+        offset += frameSize;
+    }
+    return true;
+}
+
+void MagnetRecordReader::close() {
+    if (data != nullptr) {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+        CloseHandle(static_cast<HANDLE>(mappingHandle));
+        CloseHandle(static_cast<HANDLE>(fileHandle));
+        mappingHandle = nullptr;
+        fileHandle = nullptr;
+#else
+        munmap(const_cast<uint8_t*>(data), size);
+#endif
+    }
+    data = nullptr;
+    size = 0;
+    frameOffsets.clear();
+}
+
+size_t MagnetRecordReader::get_frame_count() const {
+    return frameOffsets.size();
+}
+
+MagnetRecordFrame MagnetRecordReader::get_frame(size_t index) const {
+    const uint8_t* cursor = data + frameOffsets[index];
+    MagnetRecordFrame frame;
+    std::memcpy(&frame.header, cursor, sizeof(frame.header));
+    cursor += sizeof(frame.header);
+
+    // Every column is aligned for its element type, as the file header and frame header sizes are multiples of 8.
+    const size_t count = frame.header.magnetCount;
+    frame.id = reinterpret_cast<const uint64_t*>(cursor);
+    cursor += count * sizeof(uint64_t);
+    const double** doubleColumns[DOUBLE_COLUMNS] = {
+        &frame.posX, &frame.posY, &frame.posZ, &frame.axisX, &frame.axisY, &frame.axisZ,
+        &frame.strength, &frame.radiusSqr, &frame.velX, &frame.velY, &frame.velZ, &frame.inverseMass,
+        &frame.forceX, &frame.forceY, &frame.forceZ, &frame.torqueX, &frame.torqueY, &frame.torqueZ
+    };
+    for (const double** column : doubleColumns) {
+        *column = reinterpret_cast<const double*>(cursor);
+        cursor += count * sizeof(double);
+    }
+    const uint32_t** wordColumns[WORD_COLUMNS] = { &frame.layer, &frame.mask };
+    for (const uint32_t** column : wordColumns) {
+        *column = reinterpret_cast<const uint32_t*>(cursor);
+        cursor += count * sizeof(uint32_t);
+    }
+    const uint8_t** byteColumns[BYTE_COLUMNS] = { &frame.type, &frame.on, &frame.magnetized, &frame.influenced };
+    for (const uint8_t** column : byteColumns) {
+        *column = cursor;
+        cursor += count;
+    }
+    return frame;
+}
@@ -0,0 +1,278 @@
+#ifndef MAGNET_RECORDING_H
+#define MAGNET_RECORDING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "magnetkernel.h"
+#include "magnetsnapshot.h"
+#include "magnetsolver.h"
+
+/**
+ * Binary recordings of magnet snapshots, for replaying recorded sessions through the solver offline.
+ *
+ * File layout (native byte order, every column aligned for its element type from the start of the file):
+ * - File header: the 8-byte magic "MAGREC01", then the format version and the header size as uint32.
+ * - One frame per recorded tick: a MagnetRecordFrameHeader, then the columns of its magnetCount magnets in this
+ *   order: uint64 id; double posX, posY, posZ, axisX, axisY, axisZ, strength, radiusSqr, velX, velY, velZ,
+ *   inverseMass, forceX, forceY, forceZ, torqueX, torqueY, torqueZ; uint32 layer, mask; uint8 type, on, magnetized,
+ *   influenced; then zero padding up to the next multiple of 8 bytes.
+ * Frames are only ever appended, so a recording cut short by a crash is still readable up to its last whole frame.
+ */
+
+/**
+ * Format version written to and accepted from the file header.
+ */
+constexpr uint32_t MAGNET_RECORD_VERSION = 4;
+
+/**
+ * Frame flags.
+ */
+enum MagnetRecordFlags : uint32_t {
+    /** A baked static field was added to the recorded results; the field itself is not part of the recording. */
+    MAGNET_RECORD_STATIC_FIELD = 1,
+
+    /**
+     * Weak pairs reused cached results under level-of-detail tiers; those depend on earlier solves, so replaying the
+     * frame, which evaluates every pair, does not reproduce them. Set by write_frame from the solver's settings.
+     */
+    MAGNET_RECORD_LOD = 2
+};
+
+/**
+ * Fixed-size header preceding the columns of every frame.
+ */
+struct MagnetRecordFrameHeader {
+    /** Number of magnets in the frame. */
+    uint32_t magnetCount;
+
+    /** Combination of MagnetRecordFlags. */
+    uint32_t flags;
+
+    /** Tick number, counted from the start of the recording. */
+    uint64_t tick;
+
+    /** Solver settings the frame was solved with. */
+    double timestep;
+    double substepDistance;
+    double minForce;
+    double cutoffFalloff;
+    double openingAngle;
+    uint32_t maxSubsteps;
+    uint8_t mode;
+    uint8_t precision;
+    uint8_t padding[2];
+};
+static_assert(sizeof(MagnetRecordFrameHeader) == 64, "Frame headers must keep the columns 8-byte aligned.");
+
+/**
+ * Appends frames to a recording.
+ * Frames are serialized into a memory buffer and written to the file in large blocks; nothing is ever seeked or
+ * rewritten.
+ */
+class MagnetRecordWriter {
+public:
+
+    // --- Constructor/destructor ---
+
+    /** Default constructor */
+    MagnetRecordWriter() = default;
+
+    /** Destructor; flushes and closes the file. */
+    ~MagnetRecordWriter();
+
+    MagnetRecordWriter(const MagnetRecordWriter&) = delete;
+    MagnetRecordWriter& operator=(const MagnetRecordWriter&) = delete;
+
+
+    // --- Core methods ---
+
+    /**
+     * Creates a recording, replacing any existing file, and writes its file header.
+     *
+     * @param path The file path.
+     * @return True if the file was created.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * Appends one solved tick to the recording. The frame is buffered, and written once the buffer is full.
+     *
+     * @param snapshot The solved snapshot; its gathered state and results are recorded.
+     * @param ids A caller-defined identifier per magnet (e.g. an instance ID), or nullptr to record zeros.
+     * @param solver The solver the snapshot was solved with, for its settings.
+     * @param flags Combination of MagnetRecordFlags; MAGNET_RECORD_LOD is added when the solver used LOD tiers.
+     */
+    void write_frame(const MagnetSnapshot& snapshot, const uint64_t* ids, const MagnetSolver& solver, uint32_t flags);
+
+    /**
+     * Writes the buffered frames to the file.
+     *
+     * @return True if every write succeeded so far.
+     */
+    bool flush();
+
+    /**
+     * Flushes and closes the recording.
+     *
+     * @return True if every write succeeded.
+     */
+    bool close();
+
+    /** Gets whether a recording is open. */
+    bool is_open() const;
+
+    /** Gets the number of frames appended since the recording was opened. */
+    uint64_t get_frame_count() const;
+
+    /** Gets the number of bytes appended since the recording was opened, including buffered ones. */
+    uint64_t get_byte_count() const;
+
+private:
+
+    // --- Private fields ---
+
+    /** Buffered bytes are written once the buffer exceeds this size. */
+    static constexpr size_t FLUSH_THRESHOLD = size_t(1) << 20;
+
+    /** The open file, or nullptr. */
+    std::FILE* file = nullptr;
+
+    /** Serialized frames not written yet. */
+    std::vector<uint8_t> buffer;
+
+    /** Whether every write since opening succeeded. */
+    bool good = false;
+
+    /** Counters since opening. */
+    uint64_t frameCount = 0;
+    uint64_t byteCount = 0;
+
+
+    // --- Private helpers ---
+
+    /** Appends raw bytes to the buffer. */
+    void append(const void* data, size_t size);
+};
+
+/**
+ * Zero-copy view of one recorded frame. Column pointers point into the reader's file mapping and stay valid while
+ * the reader is open.
+ */
+struct MagnetRecordFrame {
+    MagnetRecordFrameHeader header;
+
+    const uint64_t* id;
+    const double* posX;
+    const double* posY;
+    const double* posZ;
+    const double* axisX;
+    const double* axisY;
+    const double* axisZ;
+    const double* strength;
+    const double* radiusSqr;
+    const double* velX;
+    const double* velY;
+    const double* velZ;
+    const double* inverseMass;
+    const double* forceX;
+    const double* forceY;
+    const double* forceZ;
+    const double* torqueX;
+    const double* torqueY;
+    const double* torqueZ;
+    const uint32_t* layer;
+    const uint32_t* mask;
+    const uint8_t* type;
+    const uint8_t* on;
+    const uint8_t* magnetized;
+    const uint8_t* influenced;
+
+    /**
+     * Copies the recorded gathered state into a snapshot, ready to be solved. Results are left for the solver.
+     *
+     * @param snapshot The snapshot to fill; resized to the frame's magnet count.
+     */
+    void load_state(MagnetSnapshot& snapshot) const;
+
+    /**
+     * Applies the recorded solver settings (mode, precision, sub-stepping, timestep, pair cutoff and octree opening
+     * angle) to a solver.
+     *
+     * @param solver The solver to configure.
+     */
+    void load_settings(MagnetSolver& solver) const;
+};
+
+/**
+ * Reads a recording through a read-only memory mapping of the whole file, so frames are read in place, without
+ * copying or buffering them.
+ */
+class MagnetRecordReader {
+public:
+
+    // --- Constructor/destructor ---
+
+    /** Default constructor */
+    MagnetRecordReader() = default;
+
+    /** Destructor; unmaps the file. */
+    ~MagnetRecordReader();
+
+    MagnetRecordReader(const MagnetRecordReader&) = delete;
+    MagnetRecordReader& operator=(const MagnetRecordReader&) = delete;
+
+
+    // --- Core methods ---
+
+    /**
+     * Maps a recording and indexes its frames. A truncated last frame is ignored.
+     *
+     * @param path The file path.
+     * @return True if the file was mapped and its header is valid.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * Unmaps the recording.
+     */
+    void close();
+
+    /** Gets the number of whole frames in the recording. */
+    size_t get_frame_count() const;
+
+    /**
+     * Gets a view of one frame.
+     *
+     * @param index The frame index; must be less than get_frame_count().
+     * @return The frame.
+     */
+    MagnetRecordFrame get_frame(size_t index) const;
+
+private:
+
+    // --- Private fields ---
+
+    /** The mapped file contents, or nullptr. */
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+
+    /** Byte offset of every whole frame. */
+    std::vector<size_t> frameOffsets;
+};
+
+/**
+ * Gets the size in bytes of a frame holding the given number of magnets, header included.
+ */
+size_t magnet_record_frame_size(uint32_t magnetCount);
+
+
+#endif // MAGNET_RECORDING_H
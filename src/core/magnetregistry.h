@@ -0,0 +1,161 @@
+#ifndef MAGNET_REGISTRY_H
+#define MAGNET_REGISTRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Stable, generation-checked reference to an entry of a MagnetRegistry.
+ * A handle stays valid until its entry is removed; afterwards it is rejected even if its slot is reused.
+ */
+struct MagnetHandle {
+    /** Slot index, or INVALID_INDEX for a handle that refers to nothing. */
+    uint32_t index = INVALID_INDEX;
+
+    /** Generation of the slot when the handle was issued. */
+    uint32_t generation = 0;
+
+    static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+    /**
+     * Checks whether this handle was ever issued (it may still be stale).
+     */
+    bool is_set() const {
+        return index != INVALID_INDEX;
+    }
+
+    /**
+     * Checks whether two handles refer to the same slot and generation.
+     */
+    bool operator==(const MagnetHandle& other) const {
+        return index == other.index && generation == other.generation;
+    }
+
+    bool operator!=(const MagnetHandle& other) const {
+        return !(*this == other);
+    }
+};
+
+/**
+ * Slot map holding pointers to registered objects.
+ * Insertion, removal and lookup are O(1): entries live in a dense array (removal swaps the last entry into the gap),
+ * and each slot maps a handle to the entry's current dense position.
+ * The dense array can be iterated directly and contains no gaps.
+ */
+template <typename T>
+class MagnetRegistry {
+public:
+
+    // --- Core methods ---
+
+    /**
+     * Adds an object to the registry.
+     *
+     * @param object The object to add.
+     * @return The handle of the new entry.
+     */
+    MagnetHandle insert(T* object) {
+        uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            slot = static_cast<uint32_t>(slots.size());
+            slots.push_back(Slot());
+        }
+
+        slots[slot].denseIndex = static_cast<uint32_t>(dense.size());
+        dense.push_back(object);
+        denseSlots.push_back(slot);
+        return MagnetHandle{ slot, slots[slot].generation };
+    }
+
+    /**
+     * Removes the entry referred to by a handle. Stale or unset handles are ignored.
+     *
+     * @param handle The handle of the entry to remove.
+     * @return True if an entry was removed, false if the handle was stale.
+     */
+    bool remove(const MagnetHandle& handle) {
+        if (!contains(handle)) {
+            return false;
+        }
+
+        // Move the last entry into the removed entry's place.
+        const uint32_t denseIndex = slots[handle.index].denseIndex;
+        const uint32_t lastIndex = static_cast<uint32_t>(dense.size() - 1);
+        dense[denseIndex] = dense[lastIndex];
+        denseSlots[denseIndex] = denseSlots[lastIndex];
+        slots[denseSlots[denseIndex]].denseIndex = denseIndex;
+        dense.pop_back();
+        denseSlots.pop_back();
+
+        // Invalidate outstanding handles to this slot before it is reused.
+        slots[handle.index].generation++;
+        freeSlots.push_back(handle.index);
+        return true;
+    }
+
+    /**
+     * Checks whether a handle refers to a live entry.
+     *
+     * @param handle The handle to check.
+     * @return True if the entry exists, false if the handle is unset or stale.
+     */
+    bool contains(const MagnetHandle& handle) const {
+        // Removal bumps the slot's generation, so only handles issued for the live entry match.
+        return handle.index < slots.size() && slots[handle.index].generation == handle.generation;
+    }
+
+    /**
+     * Gets the object referred to by a handle.
+     *
+     * @param handle The handle to look up.
+     * @return The object, or nullptr if the handle is unset or stale.
+     */
+    T* get(const MagnetHandle& handle) const {
+        return contains(handle) ? dense[slots[handle.index].denseIndex] : nullptr;
+    }
+
+    /**
+     * Gets the dense array of registered objects, in no particular order.
+     *
+     * @return The registered objects.
+     */
+    const std::vector<T*>& get_dense() const {
+        return dense;
+    }
+
+    /**
+     * Gets the number of registered objects.
+     */
+    size_t size() const {
+        return dense.size();
+    }
+
+private:
+
+    /**
+     * Maps a handle's slot to the entry's position in the dense array.
+     */
+    struct Slot {
+        uint32_t denseIndex = MagnetHandle::INVALID_INDEX;
+        uint32_t generation = 0;
+    };
+
+    /** Slots, indexed by handle index. */
+    std::vector<Slot> slots;
+
+    /** Indices of slots available for reuse. */
+    std::vector<uint32_t> freeSlots;
+
+    /** Registered objects, without gaps. */
+    std::vector<T*> dense;
+
+    /** Slot index of each dense entry, for fixing up slots when entries move. */
+    std::vector<uint32_t> denseSlots;
+};
+
+
+#endif // MAGNET_REGISTRY_H
@@ -0,0 +1,89 @@
+#include "magnetsnapshot.h"
+#include <algorithm>
+
+// --- Buffer management ---
+
+void MagnetSnapshot::resize(size_t count) {
+    posX.resize(count);
+    posY.resize(count);
+    posZ.resize(count);
+    axisX.resize(count);
+    axisY.resize(count);
+    axisZ.resize(count);
+    strength.resize(count);
+    radiusSqr.resize(count);
+    type.resize(count);
+    on.resize(count);
+    magnetized.resize(count);
+    layer.resize(count, MAGNET_DEFAULT_LAYERS);
+    mask.resize(count, MAGNET_DEFAULT_LAYERS);
+    velX.resize(count);
+    velY.resize(count);
+    velZ.resize(count);
+    inverseMass.resize(count);
+
+    forceX.resize(count);
+    forceY.resize(count);
+    forceZ.resize(count);
+    torqueX.resize(count);
+    torqueY.resize(count);
+    torqueZ.resize(count);
+    influenced.resize(count);
+    updated.resize(count);
+}
+
+void MagnetSnapshot::clear_results() {
+    std::fill(forceX.begin(), forceX.end(), 0.0);
+    std::fill(forceY.begin(), forceY.end(), 0.0);
+    std::fill(forceZ.begin(), forceZ.end(), 0.0);
+    std::fill(torqueX.begin(), torqueX.end(), 0.0);
+    std::fill(torqueY.begin(), torqueY.end(), 0.0);
+    std::fill(torqueZ.begin(), torqueZ.end(), 0.0);
+    std::fill(influenced.begin(), influenced.end(), 0);
+}
+
+void MagnetSnapshot::clear_result(size_t i) {
+    forceX[i] = forceY[i] = forceZ[i] = 0.0;
+    torqueX[i] = torqueY[i] = torqueZ[i] = 0.0;
+    influenced[i] = 0;
+}
+
+void MagnetSnapshot::copy_state(const MagnetSnapshot& source) {
+    posX = source.posX;
+    posY = source.posY;
+    posZ = source.posZ;
+    axisX = source.axisX;
+    axisY = source.axisY;
+    axisZ = source.axisZ;
+    strength = source.strength;
+    radiusSqr = source.radiusSqr;
+    type = source.type;
+    on = source.on;
+    magnetized = source.magnetized;
+    layer = source.layer;
+    mask = source.mask;
+    velX = source.velX;
+    velY = source.velY;
+    velZ = source.velZ;
+    inverseMass = source.inverseMass;
+}
+
+void MagnetSnapshot::copy_magnet(const MagnetSnapshot& source, size_t from, size_t to) {
+    posX[to] = source.posX[from];
+    posY[to] = source.posY[from];
+    posZ[to] = source.posZ[from];
+    axisX[to] = source.axisX[from];
+    axisY[to] = source.axisY[from];
+    axisZ[to] = source.axisZ[from];
+    strength[to] = source.strength[from];
+    radiusSqr[to] = source.radiusSqr[from];
+    type[to] = source.type[from];
+    on[to] = source.on[from];
+    magnetized[to] = source.magnetized[from];
+    layer[to] = source.layer[from];
+    mask[to] = source.mask[from];
+    velX[to] = source.velX[from];
+    velY[to] = source.velY[from];
+    velZ[to] = source.velZ[from];
+    inverseMass[to] = source.inverseMass[from];
+}
@@ -0,0 +1,223 @@
+#ifndef MAGNET_SNAPSHOT_H
+#define MAGNET_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "magnetmodel.h"
+
+/**
+ * Structure-of-arrays copy of the state of every magnet in the scene, gathered once per physics tick.
+ * All pair culling, force and torque computations read from these contiguous buffers rather than from the nodes,
+ * and write their per-magnet results into the accumulator buffers.
+ * Index i refers to the same magnet in every buffer.
+ */
+struct MagnetSnapshot {
+
+    // --- Gathered state ---
+
+    /** Global position of each magnet. */
+    std::vector<double> posX, posY, posZ;
+
+    /** Normalized global Z axis (pole direction) of each magnet. */
+    std::vector<double> axisX, axisY, axisZ;
+
+    /** Strength of each magnet. */
+    std::vector<double> strength;
+
+    /** Square of the radius of the sphere of influence of each magnet. */
+    std::vector<double> radiusSqr;
+
+    /** Magnet type of each magnet (see MagnetType). */
+    std::vector<uint8_t> type;
+
+    /** Activation state of each magnet (0 = off, 1 = on). */
+    std::vector<uint8_t> on;
+
+    /** Magnetization state of each magnet at the start of the tick (0 = not magnetized, 1 = magnetized). */
+    std::vector<uint8_t> magnetized;
+
+    /** Magnetic layer and mask of each magnet; a magnet is only influenced by magnets on a layer in its mask. */
+    std::vector<uint32_t> layer, mask;
+
+    /** Linear velocity of each magnet. Only read by stiff pair sub-stepping; may be left at zero otherwise. */
+    std::vector<double> velX, velY, velZ;
+
+    /** Inverse mass of each magnet (0 for frozen or static magnets). Only read by stiff pair sub-stepping. */
+    std::vector<double> inverseMass;
+
+
+    // --- Per-tick results ---
+
+    /** Net force accumulated on each magnet. */
+    std::vector<double> forceX, forceY, forceZ;
+
+    /** Net torque accumulated on each magnet. */
+    std::vector<double> torqueX, torqueY, torqueZ;
+
+    /** Whether each magnet was influenced by at least one other magnet. */
+    std::vector<uint8_t> influenced;
+
+    /** Whether each magnet's results were recomputed by the last solve (0 = kept from the solve before it). */
+    std::vector<uint8_t> updated;
+
+
+    // --- Buffer management ---
+
+    /**
+     * Gets the number of magnets in the snapshot.
+     *
+     * @return The magnet count.
+     */
+    size_t size() const {
+        return posX.size();
+    }
+
+    /**
+     * Resizes every buffer to hold the given number of magnets.
+     * Capacity is retained between ticks, so steady-state gathering does not allocate. Added magnets start on the
+     * default layer, with the default mask.
+     *
+     * @param count The number of magnets.
+     */
+    void resize(size_t count);
+
+    /**
+     * Zeroes the per-tick result buffers.
+     */
+    void clear_results();
+
+    /**
+     * Zeroes the per-tick results of one magnet.
+     *
+     * @param i Index of the magnet.
+     */
+    void clear_result(size_t i);
+
+    /**
+     * Copies the gathered state (not the results) of another snapshot.
+     *
+     * @param source The snapshot to copy from.
+     */
+    void copy_state(const MagnetSnapshot& source);
+
+    /**
+     * Copies the gathered state (not the results) of one magnet of another snapshot.
+     *
+     * @param source The snapshot to copy from.
+     * @param from Index of the magnet in source.
+     * @param to Index of the magnet in this snapshot; must be less than size().
+     */
+    void copy_magnet(const MagnetSnapshot& source, size_t from, size_t to);
+
+    /**
+     * Determines if a magnet's gathered state is identical to that of the same index in another snapshot.
+     *
+     * @param other The snapshot to compare with; must have at least i + 1 magnets.
+     * @param i Index of the magnet.
+     * @return True if every gathered value is equal, false if not.
+     */
+    bool same_state(const MagnetSnapshot& other, size_t i) const {
+        return posX[i] == other.posX[i] && posY[i] == other.posY[i] && posZ[i] == other.posZ[i]
+            && axisX[i] == other.axisX[i] && axisY[i] == other.axisY[i] && axisZ[i] == other.axisZ[i]
+            && strength[i] == other.strength[i] && radiusSqr[i] == other.radiusSqr[i]
+            && type[i] == other.type[i] && on[i] == other.on[i] && magnetized[i] == other.magnetized[i]
+            && layer[i] == other.layer[i] && mask[i] == other.mask[i]
+            && velX[i] == other.velX[i] && velY[i] == other.velY[i] && velZ[i] == other.velZ[i]
+            && inverseMass[i] == other.inverseMass[i];
+    }
+
+
+    // --- Accessors ---
+
+    /**
+     * Gets the position of a magnet.
+     */
+    MagnetVector position(size_t i) const {
+        return MagnetVector{ posX[i], posY[i], posZ[i] };
+    }
+
+    /**
+     * Gets the normalized pole direction of a magnet.
+     */
+    MagnetVector axis(size_t i) const {
+        return MagnetVector{ axisX[i], axisY[i], axisZ[i] };
+    }
+
+
+    // --- Pair kernels ---
+
+    /**
+     * Determines if magnet other can exert an influence on magnet self, ignoring distance.
+     *
+     * @param self Index of the magnet which may be influenced.
+     * @param other Index of the magnet which may exert an influence.
+     * @return True if other is on and the magnet types and layers allow an influence, false if not.
+     */
+    bool can_be_influenced_by(size_t self, size_t other) const {
+        return magnet_layers_allow(mask[self], layer[other])
+            && magnet_can_be_influenced_by(type[self], type[other], on[other] != 0, magnetized[other] != 0);
+    }
+
+    /**
+     * Determines if magnet self will be influenced by magnet other.
+     * Same semantics as MagneticBody3D::will_be_influenced_by.
+     *
+     * @param self Index of the magnet which may be influenced.
+     * @param other Index of the magnet which may exert an influence.
+     * @return True if other exerts an influence on self, false if not.
+     */
+    bool will_be_influenced_by(size_t self, size_t other) const {
+        if (!can_be_influenced_by(self, other)) {
+            return false;
+        }
+
+        // Check if self is within the other's sphere of influence.
+        const double dx = posX[other] - posX[self];
+        const double dy = posY[other] - posY[self];
+        const double dz = posZ[other] - posZ[self];
+        return dx * dx + dy * dy + dz * dz <= radiusSqr[other];
+    }
+
+    /**
+     * Calculates the magnetic force exerted on magnet self by magnet other (see magnet_calculate_force).
+     *
+     * @param self Index of the magnet experiencing the force.
+     * @param other Index of the magnet exerting the force.
+     * @return The force vector.
+     */
+    MagnetVector calculate_force(size_t self, size_t other) const {
+        const MagnetVector separation{ posX[other] - posX[self], posY[other] - posY[self], posZ[other] - posZ[self] };
+        return magnet_calculate_force(separation, axis(self), strength[self], axis(other), strength[other]);
+    }
+
+    /**
+     * Calculates the alignment torque exerted on magnet self by magnet other (see magnet_calculate_torque).
+     *
+     * @param self Index of the magnet experiencing the torque.
+     * @param other Index of the magnet exerting the torque.
+     * @return The torque vector.
+     */
+    MagnetVector calculate_torque(size_t self, size_t other) const {
+        const MagnetVector separation{ posX[other] - posX[self], posY[other] - posY[self], posZ[other] - posZ[self] };
+        return magnet_calculate_torque(separation, axis(self), strength[self], axis(other), strength[other]);
+    }
+
+    /**
+     * Calculates the force and the torque exerted on magnet self by magnet other, and whether other influences self,
+     * in one pass (see magnet_calculate_interaction).
+     *
+     * @param self Index of the magnet experiencing the interaction.
+     * @param other Index of the magnet exerting it.
+     * @return The force, the torque and the influence flag.
+     */
+    MagnetInteraction calculate_interaction(size_t self, size_t other) const {
+        const MagnetVector separation{ posX[other] - posX[self], posY[other] - posY[self], posZ[other] - posZ[self] };
+        return magnet_calculate_interaction(separation, axis(self), strength[self], axis(other), strength[other],
+            can_be_influenced_by(self, other), radiusSqr[other]);
+    }
+};
+
+
+#endif // MAGNET_SNAPSHOT_H
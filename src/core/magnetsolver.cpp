@@ -0,0 +1,845 @@
+#include "magnetsolver.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+// Candidate pairs per solver task. Fixed, so the task split never depends on the number of threads.
+static constexpr uint32_t PAIRS_PER_TASK = 1024;
+
+// Sample points per sample_field task.
+static constexpr uint32_t POINTS_PER_TASK = 256;
+
+// Entries kept in the level-of-detail cache for pairs not seen during the last solve, beyond twice those seen.
+static constexpr size_t LOD_CACHE_SLACK = 1024;
+
+// Largest fraction of a stiff pair's separation either magnet may travel, relative to the other, in one sub-step.
+static constexpr double SUBSTEP_MAX_TRAVEL = 0.1;
+
+// Evaluates a range of pairs at the precision of the results buffer.
+static void evaluate_range(const MagnetSnapshot& snapshot, const MagnetKernelStateF&, const MagnetPair* pairs, size_t count, MagnetPairResults& out, size_t offset) {
+    magnet_evaluate_pairs(snapshot, pairs, count, out, offset);
+}
+
+static void evaluate_range(const MagnetSnapshot& snapshot, const MagnetKernelStateF& state, const MagnetPair* pairs, size_t count, MagnetPairResultsT<float>& out, size_t offset) {
+    magnet_evaluate_pairs(snapshot, state, pairs, count, out, offset);
+}
+
+// Drops the pairs of a range beyond their cutoff radius, and fades out the force and torque of those near it.
+template <typename Scalar>
+static void apply_cutoff(const MagnetSnapshot& snapshot, const MagnetPair* pairs, size_t count, MagnetPairResultsT<Scalar>& out, size_t offset,
+    double minForce, double innerFraction) {
+    const double innerScale = innerFraction * innerFraction;
+    for (size_t k = 0; k < count; k++) {
+        const size_t p = offset + k;
+        const double cutoffSqr = magnet_cutoff_radius_sqr(snapshot.strength[pairs[k].first], snapshot.strength[pairs[k].second], minForce);
+        const double distanceSqr = out.distanceSqr[p];
+        if (distanceSqr > cutoffSqr) {
+            out.influence[p] = 0;
+            continue;
+        }
+        const double weight = magnet_cutoff_weight(distanceSqr, cutoffSqr, cutoffSqr * innerScale);
+        if (weight == 1.0) continue;
+        out.forceX[p] *= Scalar(weight);
+        out.forceY[p] *= Scalar(weight);
+        out.forceZ[p] *= Scalar(weight);
+        out.torqueX[p] *= Scalar(weight);
+        out.torqueY[p] *= Scalar(weight);
+        out.torqueZ[p] *= Scalar(weight);
+    }
+}
+
+// --- Settings ---
+
+MagnetSolverMode MagnetSolver::get_mode() const {
+    return mode;
+}
+
+void MagnetSolver::set_mode(MagnetSolverMode newMode) {
+    if (newMode != mode) invalidate();
+    mode = newMode;
+}
+
+double MagnetSolver::get_substep_distance() const {
+    return substepDistance;
+}
+
+void MagnetSolver::set_substep_distance(double distance) {
+    if (distance != substepDistance) invalidate();
+    substepDistance = std::max(distance, 0.0);
+}
+
+uint32_t MagnetSolver::get_max_substeps() const {
+    return maxSubsteps;
+}
+
+void MagnetSolver::set_max_substeps(uint32_t count) {
+    if (count != maxSubsteps) invalidate();
+    maxSubsteps = std::max<uint32_t>(count, 1);
+}
+
+double MagnetSolver::get_timestep() const {
+    return timestep;
+}
+
+void MagnetSolver::set_timestep(double delta) {
+    if (delta != timestep) invalidate();
+    timestep = delta;
+}
+
+const MagnetFieldGrid* MagnetSolver::get_static_field() const {
+    return staticField;
+}
+
+void MagnetSolver::set_static_field(const MagnetFieldGrid* field, uint32_t layers) {
+    if (field != staticField || layers != staticFieldLayers) invalidate();
+    staticField = field;
+    staticFieldLayers = layers;
+}
+
+double MagnetSolver::get_min_force() const {
+    return broadphase.get_min_force();
+}
+
+void MagnetSolver::set_min_force(double minForce) {
+    if (minForce != broadphase.get_min_force()) invalidate();
+    broadphase.set_min_force(minForce);
+}
+
+double MagnetSolver::get_cutoff_falloff() const {
+    return cutoffFalloff;
+}
+
+void MagnetSolver::set_cutoff_falloff(double fraction) {
+    fraction = std::min(std::max(fraction, 0.0), 1.0);
+    if (fraction != cutoffFalloff) invalidate();
+    cutoffFalloff = fraction;
+}
+
+MagnetPrecision MagnetSolver::get_precision() const {
+    return precision;
+}
+
+void MagnetSolver::set_precision(MagnetPrecision newPrecision) {
+    if (newPrecision != precision) invalidate();
+    precision = newPrecision;
+}
+
+bool MagnetSolver::get_incremental() const {
+    return incremental;
+}
+
+void MagnetSolver::set_incremental(bool enabled) {
+    if (!enabled) invalidate();
+    incremental = enabled;
+}
+
+const std::vector<MagnetLodTier>& MagnetSolver::get_lod_tiers() const {
+    return lodTiers;
+}
+
+void MagnetSolver::set_lod_tiers(const std::vector<MagnetLodTier>& tiers) {
+    lodTiers.clear();
+    for (const MagnetLodTier& tier : tiers) {
+        if (tier.maxForce > 0.0 && tier.interval > 1) lodTiers.push_back(tier);
+    }
+    std::sort(lodTiers.begin(), lodTiers.end(), [](const MagnetLodTier& a, const MagnetLodTier& b) {
+        return a.maxForce < b.maxForce;
+    });
+    lodCache.clear();
+}
+
+uint32_t MagnetSolver::get_lod_budget() const {
+    return lodBudget;
+}
+
+void MagnetSolver::set_lod_budget(uint32_t maxEvaluations) {
+    lodBudget = maxEvaluations;
+}
+
+void MagnetSolver::copy_settings(const MagnetSolver& other) {
+    set_mode(other.mode);
+    set_precision(other.precision);
+    set_substep_distance(other.substepDistance);
+    set_max_substeps(other.maxSubsteps);
+    set_timestep(other.timestep);
+    set_static_field(other.staticField, other.staticFieldLayers);
+    set_min_force(other.get_min_force());
+    set_cutoff_falloff(other.cutoffFalloff);
+    broadphase.set_cell_size(other.broadphase.get_cell_size());
+    if (octree.get_opening_angle() != other.octree.get_opening_angle()) {
+        octree.set_opening_angle(other.octree.get_opening_angle());
+        invalidate();
+    }
+}
+
+void MagnetSolver::invalidate() {
+    previousValid = false;
+    broadphaseCurrent = false;
+    broadphase.invalidate();
+    lodCache.clear();
+}
+
+
+// --- Core methods ---
+
+MagnetSnapshot& MagnetSolver::get_snapshot() {
+    return snapshot;
+}
+
+const MagnetSnapshot& MagnetSolver::get_snapshot() const {
+    return snapshot;
+}
+
+void MagnetSolver::solve(const MagnetTaskRunner& runner) {
+    taskCount = 0;
+
+    // Count the tasks of every runner call, so the stats reflect the whole solve.
+    const MagnetTaskRunner countingRunner = [this, &runner](uint32_t count, const MagnetTaskFunction& task) {
+        taskCount += count;
+        runner(count, task);
+    };
+
+    // Results of the previous solve can be reused only if every index still refers to the same magnet.
+    const size_t count = snapshot.size();
+    const bool reuse = incremental && previousValid && previousState.size() == count;
+
+    // Find the magnets whose gathered state changed since the previous solve.
+    size_t changedCount = count;
+    changed.assign(count, 1);
+    if (reuse) {
+        changedCount = 0;
+        for (size_t i = 0; i < count; i++) {
+            changed[i] = snapshot.same_state(previousState, i) ? 0 : 1;
+            changedCount += changed[i];
+        }
+    }
+    if (incremental) {
+        previousState.copy_state(snapshot);
+        previousValid = true;
+    }
+
+    // Nothing changed, so every result of the previous solve still holds.
+    if (reuse && changedCount == 0) {
+        std::fill(snapshot.updated.begin(), snapshot.updated.end(), 0);
+        updatedMagnets = 0;
+        evaluatedPairs = 0;
+        substeppedPairs = 0;
+        cachedPairs.clear();
+        deferredPairs = 0;
+        return;
+    }
+
+    if (mode == MAGNET_SOLVER_OCTREE) {
+        // The tree's aggregates depend on every magnet, so any change rebuilds it.
+        broadphaseCurrent = false;
+        snapshot.clear_results();
+        solve_octree(countingRunner);
+        std::fill(snapshot.updated.begin(), snapshot.updated.end(), 1);
+        updatedMagnets = count;
+        evaluatedPairs = octree.get_exact_evaluations() + octree.get_far_field_evaluations();
+        substeppedPairs = 0;
+        cachedPairs.clear();
+        deferredPairs = 0;
+    } else {
+        solve_pairs(countingRunner, reuse);
+    }
+
+    // The static field depends only on each magnet's own state, so it is added to the updated magnets only.
+    if (staticField != nullptr) {
+        staticField->apply(snapshot, staticFieldLayers);
+    }
+}
+
+
+void MagnetSolver::solve_subset(const MagnetSnapshot& source, const std::vector<uint32_t>& selected, const MagnetTaskRunner& runner) {
+    // Hash the whole source once, then add every magnet whose sphere of influence contains a selected magnet, and
+    // whose layer and type let it influence that magnet.
+    subsetIndices.assign(selected.begin(), selected.end());
+    subsetIncluded.assign(source.size(), 0);
+    for (uint32_t i : selected) {
+        subsetIncluded[i] = 1;
+    }
+    broadphase.build(source);
+    for (uint32_t i : selected) {
+        broadphase.find_sources(source, source.position(i), subsetSources);
+        for (uint32_t j : subsetSources) {
+            if (subsetIncluded[j] || !source.can_be_influenced_by(i, j)) continue;
+            subsetIncluded[j] = 1;
+            subsetIndices.push_back(j);
+        }
+    }
+
+    // Snapshot indices refer to different magnets from one call to the next, so nothing is reused.
+    snapshot.resize(subsetIndices.size());
+    for (size_t k = 0; k < subsetIndices.size(); k++) {
+        snapshot.copy_magnet(source, subsetIndices[k], k);
+    }
+    invalidate();
+    solve(runner);
+}
+
+const std::vector<uint32_t>& MagnetSolver::get_subset_indices() const {
+    return subsetIndices;
+}
+
+
+void MagnetSolver::sample_field(const MagnetVector* points, size_t count, const MagnetVector* axis, MagnetVector* out, const MagnetTaskRunner& runner) {
+    // Octree solves do not hash the magnets, so the grid is built on demand.
+    if (!broadphaseCurrent) {
+        broadphase.build(snapshot);
+        broadphaseCurrent = true;
+    }
+
+    const uint32_t taskCount = static_cast<uint32_t>((count + POINTS_PER_TASK - 1) / POINTS_PER_TASK);
+    runner(taskCount, [&](uint32_t taskIndex) {
+        std::vector<uint32_t> sources;
+        MagnetBatchResult results;
+        const size_t end = std::min<size_t>(count, (size_t(taskIndex) + 1) * POINTS_PER_TASK);
+        for (size_t p = size_t(taskIndex) * POINTS_PER_TASK; p < end; p++) {
+            broadphase.find_sources(snapshot, points[p], sources);
+
+            // The torque on a probe with pole direction a is a x field, so probing along X and Y recovers the field:
+            // X x field = (0, -field.z, field.y) and Y x field = (field.z, 0, -field.x).
+            const MagnetVector probeX{ 1.0, 0.0, 0.0 };
+            const MagnetVector probeY{ 0.0, 1.0, 0.0 };
+            MagnetVector force, torqueX, torqueY;
+            for (size_t start = 0; start < sources.size(); start += MAGNET_BATCH_SIZE) {
+                const size_t batchCount = std::min<size_t>(MAGNET_BATCH_SIZE, sources.size() - start);
+                if (axis != nullptr) {
+                    magnet_probe_kernel(snapshot, points[p], *axis, 1.0, sources.data() + start, batchCount, results);
+                    for (size_t k = 0; k < batchCount; k++) {
+                        force.x += results.forceX[k];
+                        force.y += results.forceY[k];
+                        force.z += results.forceZ[k];
+                    }
+                } else {
+                    magnet_probe_kernel(snapshot, points[p], probeX, 1.0, sources.data() + start, batchCount, results);
+                    for (size_t k = 0; k < batchCount; k++) {
+                        torqueX.y += results.torqueY[k];
+                        torqueX.z += results.torqueZ[k];
+                    }
+                    magnet_probe_kernel(snapshot, points[p], probeY, 1.0, sources.data() + start, batchCount, results);
+                    for (size_t k = 0; k < batchCount; k++) {
+                        torqueY.z += results.torqueZ[k];
+                    }
+                }
+            }
+
+            MagnetVector staticForce, staticTorque;
+            if (staticField != nullptr) {
+                if (axis != nullptr) {
+                    if (staticField->sample(points[p], *axis, 1.0, staticForce, staticTorque)) {
+                        force.x += staticForce.x;
+                        force.y += staticForce.y;
+                        force.z += staticForce.z;
+                    }
+                } else if (staticField->sample(points[p], probeX, 1.0, staticForce, staticTorque)) {
+                    torqueX.y += staticTorque.y;
+                    torqueX.z += staticTorque.z;
+                    staticField->sample(points[p], probeY, 1.0, staticForce, staticTorque);
+                    torqueY.z += staticTorque.z;
+                }
+            }
+
+            out[p] = axis != nullptr ? force : MagnetVector{ -torqueY.z, torqueX.z, -torqueX.y };
+        }
+    });
+}
+
+
+// --- Solver phases ---
+
+void MagnetSolver::solve_pairs(const MagnetTaskRunner& runner, bool reuse) {
+    // Only pairs where at least one magnet lies inside the other's sphere of influence reach the kernels.
+    broadphase.find_pairs(snapshot, pairs);
+    broadphaseCurrent = true;
+
+    // A pair's result depends only on its two magnets, so only magnets that changed, or that share a pair with one
+    // this tick or the previous one, need new results. Every other magnet keeps its previous results.
+    const std::vector<MagnetPair>* evaluated = &pairs;
+    uint8_t* updated = snapshot.updated.data();
+    if (reuse) {
+        std::copy(changed.begin(), changed.end(), snapshot.updated.begin());
+        for (const std::vector<MagnetPair>* list : { &pairs, &previousPairs }) {
+            for (const MagnetPair& pair : *list) {
+                if (changed[pair.first]) updated[pair.second] = 1;
+                if (changed[pair.second]) updated[pair.first] = 1;
+            }
+        }
+
+        // A sub-stepped pair also depends on every other force on both of its magnets, so if either magnet is
+        // recomputed, both are; this spreads along chains of stiff pairs.
+        if (substepDistance > 0.0) {
+            const double substepDistanceSqr = substepDistance * substepDistance;
+            stiffPairs.clear();
+            for (const MagnetPair& pair : pairs) {
+                const double dx = snapshot.posX[pair.second] - snapshot.posX[pair.first];
+                const double dy = snapshot.posY[pair.second] - snapshot.posY[pair.first];
+                const double dz = snapshot.posZ[pair.second] - snapshot.posZ[pair.first];
+                if (dx * dx + dy * dy + dz * dz < substepDistanceSqr) stiffPairs.push_back(pair);
+            }
+            for (bool spread = true; spread;) {
+                spread = false;
+                for (const MagnetPair& pair : stiffPairs) {
+                    if (updated[pair.first] != updated[pair.second]) {
+                        updated[pair.first] = updated[pair.second] = 1;
+                        spread = true;
+                    }
+                }
+            }
+        }
+
+        activePairs.clear();
+        for (const MagnetPair& pair : pairs) {
+            if (updated[pair.first] || updated[pair.second]) activePairs.push_back(pair);
+        }
+        evaluated = &activePairs;
+
+        updatedMagnets = 0;
+        for (size_t i = 0; i < snapshot.size(); i++) {
+            if (!updated[i]) continue;
+            snapshot.clear_result(i);
+            updatedMagnets++;
+        }
+    } else {
+        snapshot.clear_results();
+        std::fill(snapshot.updated.begin(), snapshot.updated.end(), 1);
+        updatedMagnets = snapshot.size();
+    }
+
+    // Weak pairs are only evaluated once every few solves, and reuse their last results in between.
+    if (!lodTiers.empty()) {
+        schedule_lod(*evaluated);
+        evaluated = &lodPairs;
+    } else {
+        cachedPairs.clear();
+        deferredPairs = 0;
+    }
+    evaluatedPairs = evaluated->size();
+
+    // Group the pairs by type combination, so the kernels dispatch once per run of pairs instead of once per pair.
+    bucket_pairs(*evaluated);
+    if (precision == MAGNET_PRECISION_FLOAT) {
+        floatState.gather(snapshot);
+        accumulate_pairs(runner, pairResultsFloat);
+    } else {
+        accumulate_pairs(runner, pairResults);
+    }
+
+    // Keep this tick's pairs, so the next solve can find the neighbours a changed magnet leaves behind.
+    previousPairs.swap(pairs);
+}
+
+void MagnetSolver::bucket_pairs(const std::vector<MagnetPair>& source) {
+    constexpr size_t BUCKET_COUNT = size_t(MAGNET_TYPE_COUNT) * MAGNET_TYPE_COUNT;
+    size_t offsets[BUCKET_COUNT + 1] = {};
+    for (const MagnetPair& pair : source) {
+        offsets[snapshot.type[pair.first] * MAGNET_TYPE_COUNT + snapshot.type[pair.second] + 1]++;
+    }
+    for (size_t b = 0; b < BUCKET_COUNT; b++) {
+        offsets[b + 1] += offsets[b];
+    }
+
+    // Level-of-detail results are written back through each pair's position in the source.
+    const bool trackSource = !lodTiers.empty();
+    bucketedPairs.resize(source.size());
+    bucketedSource.resize(trackSource ? source.size() : 0);
+    for (size_t k = 0; k < source.size(); k++) {
+        const MagnetPair& pair = source[k];
+        const size_t slot = offsets[snapshot.type[pair.first] * MAGNET_TYPE_COUNT + snapshot.type[pair.second]]++;
+        bucketedPairs[slot] = pair;
+        if (trackSource) bucketedSource[slot] = static_cast<uint32_t>(k);
+    }
+}
+
+void MagnetSolver::schedule_lod(const std::vector<MagnetPair>& source) {
+    // Cached results are keyed by magnet index, so they only hold while indices keep referring to the same magnets.
+    if (snapshot.size() != lodMagnetCount) {
+        lodCache.clear();
+        lodMagnetCount = snapshot.size();
+    }
+    lodTick++;
+    lodPairs.clear();
+    lodPairEntries.clear();
+    cachedPairs.clear();
+    lodCandidates.clear();
+    deferredPairs = 0;
+
+    const double substepDistanceSqr = substepDistance * substepDistance;
+    size_t tierPairs = 0;
+    for (const MagnetPair& pair : source) {
+        const uint32_t i = pair.first;
+        const uint32_t j = pair.second;
+
+        // Stiff pairs change too fast within a tick to reuse; every other pair takes the weakest tier it fits in.
+        const double dx = snapshot.posX[j] - snapshot.posX[i];
+        const double dy = snapshot.posY[j] - snapshot.posY[i];
+        const double dz = snapshot.posZ[j] - snapshot.posZ[i];
+        const double distanceSqr = dx * dx + dy * dy + dz * dz;
+        const MagnetLodTier* tier = nullptr;
+        if (distanceSqr >= substepDistanceSqr) {
+            for (const MagnetLodTier& candidate : lodTiers) {
+                if (distanceSqr > magnet_cutoff_radius_sqr(snapshot.strength[i], snapshot.strength[j], candidate.maxForce)) {
+                    tier = &candidate;
+                    break;
+                }
+            }
+        }
+        if (tier == nullptr) {
+            lodPairs.push_back(pair);
+            lodPairEntries.push_back(nullptr);
+            continue;
+        }
+        tierPairs++;
+
+        // Each pair is refreshed on its own phase of the interval, so the tier's evaluations are spread evenly over
+        // the solves. A pair never evaluated yet, or overdue after changing tier or being deferred, is due at once.
+        LodEntry& entry = lodCache[(uint64_t(i) << 32) | j];
+        entry.seenTick = lodTick;
+        const uint64_t age = entry.evaluatedTick == 0 ? UINT64_MAX : lodTick - entry.evaluatedTick;
+        const uint32_t phase = ((i * 2654435761u ^ j * 2246822519u) >> 16) % tier->interval;
+        if (age < tier->interval && (lodTick + phase) % tier->interval != 0) {
+            cachedPairs.emplace_back(pair, &entry);
+        } else if (lodBudget > 0) {
+            lodCandidates.push_back({ pair, &entry, age });
+        } else {
+            lodPairs.push_back(pair);
+            lodPairEntries.push_back(&entry);
+        }
+    }
+
+    // Under a budget, the due pairs share what the full-rate pairs leave, the longest unrefreshed first. The rest keep
+    // their last results and stay due, so they come first on the next solve.
+    if (lodBudget > 0) {
+        const size_t remaining = lodPairs.size() < lodBudget ? lodBudget - lodPairs.size() : 0;
+        const size_t admitted = std::min(remaining, lodCandidates.size());
+        if (admitted < lodCandidates.size()) {
+            std::nth_element(lodCandidates.begin(), lodCandidates.begin() + admitted, lodCandidates.end(),
+                [](const LodCandidate& a, const LodCandidate& b) { return a.age > b.age; });
+        }
+        for (size_t k = 0; k < lodCandidates.size(); k++) {
+            const LodCandidate& candidate = lodCandidates[k];
+            if (k < admitted) {
+                lodPairs.push_back(candidate.pair);
+                lodPairEntries.push_back(candidate.entry);
+                continue;
+            }
+            deferredPairs++;
+            if (candidate.entry->evaluatedTick != 0) cachedPairs.emplace_back(candidate.pair, candidate.entry);
+        }
+    }
+
+    // Drop the entries of pairs that left every tier, once they outnumber the live ones.
+    if (lodCache.size() > 2 * tierPairs + LOD_CACHE_SLACK) {
+        for (auto it = lodCache.begin(); it != lodCache.end();) {
+            it = it->second.seenTick != lodTick ? lodCache.erase(it) : std::next(it);
+        }
+    }
+}
+
+template <typename Scalar>
+void MagnetSolver::accumulate_pairs(const MagnetTaskRunner& runner, MagnetPairResultsT<Scalar>& results) {
+    // Evaluate fixed-size ranges of pairs in parallel. Each task writes only its own range of pair results.
+    results.resize(bucketedPairs.size());
+    const double minForce = broadphase.get_min_force();
+    const uint32_t pairTaskCount = static_cast<uint32_t>((bucketedPairs.size() + PAIRS_PER_TASK - 1) / PAIRS_PER_TASK);
+    runner(pairTaskCount, [&](uint32_t taskIndex) {
+        const size_t start = size_t(taskIndex) * PAIRS_PER_TASK;
+        const size_t count = std::min<size_t>(PAIRS_PER_TASK, bucketedPairs.size() - start);
+        evaluate_range(snapshot, floatState, bucketedPairs.data() + start, count, results, start);
+        if (minForce > 0.0) {
+            apply_cutoff(snapshot, bucketedPairs.data() + start, count, results, start, minForce, 1.0 - cutoffFalloff);
+        }
+        // Tier pairs keep their results for the solves that skip them; each pair owns its cache entry.
+        if (!bucketedSource.empty()) {
+            for (size_t p = start; p < start + count; p++) {
+                LodEntry* entry = lodPairEntries[bucketedSource[p]];
+                if (entry == nullptr) continue;
+                entry->force = MagnetVector{ double(results.forceX[p]), double(results.forceY[p]), double(results.forceZ[p]) };
+                entry->torque = MagnetVector{ double(results.torqueX[p]), double(results.torqueY[p]), double(results.torqueZ[p]) };
+                entry->influence = results.influence[p];
+                entry->evaluatedTick = lodTick;
+            }
+        }
+    });
+
+    // Reduce in pair order, so the accumulated results are identical for any thread count.
+    // Force and torque are antisymmetric (swapping the magnets flips the separation vector and the cross product),
+    // so a single evaluation serves both sides of the pair. Magnets keeping their previous results are skipped;
+    // each updated magnet sees its pairs in the same order as in a full solve, so its sums are identical.
+    // The kernels already tested both spheres of influence and the type rules, so only the flags are read here.
+    const uint8_t* updated = snapshot.updated.data();
+#ifdef MAGNET_PROFILING
+    appliedPairs = 0;
+#endif
+    for (size_t p = 0; p < bucketedPairs.size(); p++) {
+        const uint32_t i = bucketedPairs[p].first;
+        const uint32_t j = bucketedPairs[p].second;
+        const bool iInfluencedByJ = updated[i] && (results.influence[p] & MAGNET_PAIR_FIRST_INFLUENCED);
+        const bool jInfluencedByI = updated[j] && (results.influence[p] & MAGNET_PAIR_SECOND_INFLUENCED);
+
+        if (iInfluencedByJ) {
+            snapshot.forceX[i] += results.forceX[p];
+            snapshot.forceY[i] += results.forceY[p];
+            snapshot.forceZ[i] += results.forceZ[p];
+            snapshot.torqueX[i] += results.torqueX[p];
+            snapshot.torqueY[i] += results.torqueY[p];
+            snapshot.torqueZ[i] += results.torqueZ[p];
+            snapshot.influenced[i] = 1;
+        }
+        if (jInfluencedByI) {
+            snapshot.forceX[j] -= results.forceX[p];
+            snapshot.forceY[j] -= results.forceY[p];
+            snapshot.forceZ[j] -= results.forceZ[p];
+            snapshot.torqueX[j] -= results.torqueX[p];
+            snapshot.torqueY[j] -= results.torqueY[p];
+            snapshot.torqueZ[j] -= results.torqueZ[p];
+            snapshot.influenced[j] = 1;
+        }
+#ifdef MAGNET_PROFILING
+        appliedPairs += uint64_t(iInfluencedByJ) + uint64_t(jInfluencedByI);
+#endif
+    }
+
+    // Tier pairs skipped this solve apply their cached results the same way.
+    for (const auto& cached : cachedPairs) {
+        const uint32_t i = cached.first.first;
+        const uint32_t j = cached.first.second;
+        const LodEntry& entry = *cached.second;
+        const bool iInfluencedByJ = updated[i] && (entry.influence & MAGNET_PAIR_FIRST_INFLUENCED);
+        const bool jInfluencedByI = updated[j] && (entry.influence & MAGNET_PAIR_SECOND_INFLUENCED);
+
+        if (iInfluencedByJ) {
+            snapshot.forceX[i] += entry.force.x;
+            snapshot.forceY[i] += entry.force.y;
+            snapshot.forceZ[i] += entry.force.z;
+            snapshot.torqueX[i] += entry.torque.x;
+            snapshot.torqueY[i] += entry.torque.y;
+            snapshot.torqueZ[i] += entry.torque.z;
+            snapshot.influenced[i] = 1;
+        }
+        if (jInfluencedByI) {
+            snapshot.forceX[j] -= entry.force.x;
+            snapshot.forceY[j] -= entry.force.y;
+            snapshot.forceZ[j] -= entry.force.z;
+            snapshot.torqueX[j] -= entry.torque.x;
+            snapshot.torqueY[j] -= entry.torque.y;
+            snapshot.torqueZ[j] -= entry.torque.z;
+            snapshot.influenced[j] = 1;
+        }
+#ifdef MAGNET_PROFILING
+        appliedPairs += uint64_t(iInfluencedByJ) + uint64_t(jInfluencedByI);
+#endif
+    }
+
+    if (substepDistance > 0.0 && timestep > 0.0) {
+        substep_stiff_pairs(results);
+    } else {
+        substeppedPairs = 0;
+    }
+}
+
+template <typename Scalar>
+void MagnetSolver::substep_stiff_pairs(const MagnetPairResultsT<Scalar>& results) {
+    // A single evaluation at the start of the tick is applied for the whole tick. For close pairs the force changes
+    // a lot within the tick (and its inverse-square growth overshoots), so instead the pair's relative motion is
+    // integrated over smaller sub-steps and the force averaged along the way. The impulse applied over the tick then
+    // matches the sub-stepped trajectory, without raising the tick rate of the rest of the world.
+    // Every other force on the two magnets is held constant over the tick, and poles keep their orientation.
+    const double substepDistanceSqr = substepDistance * substepDistance;
+    substeppedPairs = 0;
+    corrections.clear();
+
+    for (size_t p = 0; p < bucketedPairs.size(); p++) {
+        const uint32_t i = bucketedPairs[p].first;
+        const uint32_t j = bucketedPairs[p].second;
+
+        // Stiffness is tested on the double-precision positions, the same test incremental solves spread along.
+        const double sx = snapshot.posX[j] - snapshot.posX[i];
+        const double sy = snapshot.posY[j] - snapshot.posY[i];
+        const double sz = snapshot.posZ[j] - snapshot.posZ[i];
+        const double distanceSqr = sx * sx + sy * sy + sz * sz;
+        if (distanceSqr >= substepDistanceSqr) continue;
+
+        const bool iInfluencedByJ = results.influence[p] & MAGNET_PAIR_FIRST_INFLUENCED;
+        const bool jInfluencedByI = results.influence[p] & MAGNET_PAIR_SECOND_INFLUENCED;
+        if (!iInfluencedByJ && !jInfluencedByI) continue;
+
+        // Force of the single evaluation on i (its opposite acts on j), and every other force on each magnet.
+        const MagnetVector force{ results.forceX[p], results.forceY[p], results.forceZ[p] };
+        const double signI = iInfluencedByJ ? 1.0 : 0.0;
+        const double signJ = jInfluencedByI ? -1.0 : 0.0;
+        const MagnetVector restI{ snapshot.forceX[i] - signI * force.x, snapshot.forceY[i] - signI * force.y, snapshot.forceZ[i] - signI * force.z };
+        const MagnetVector restJ{ snapshot.forceX[j] - signJ * force.x, snapshot.forceY[j] - signJ * force.y, snapshot.forceZ[j] - signJ * force.z };
+
+        // Choose the sub-step count from how far the magnets may move relative to each other during the tick.
+        const double inverseMassI = snapshot.inverseMass[i];
+        const double inverseMassJ = snapshot.inverseMass[j];
+        const double dvx = snapshot.velX[j] - snapshot.velX[i];
+        const double dvy = snapshot.velY[j] - snapshot.velY[i];
+        const double dvz = snapshot.velZ[j] - snapshot.velZ[i];
+        const double forceLength = std::sqrt(force.x * force.x + force.y * force.y + force.z * force.z);
+        const double travel = std::sqrt(dvx * dvx + dvy * dvy + dvz * dvz) * timestep
+            + 0.5 * forceLength * (inverseMassI + inverseMassJ) * timestep * timestep;
+        const double distance = std::max(std::sqrt(distanceSqr), MAGNET_FORCE_MIN_DISTANCE);
+        const double needed = std::ceil(travel / (SUBSTEP_MAX_TRAVEL * distance));
+        if (needed <= 1.0) continue;
+
+        // Integrate both magnets with semi-implicit Euler and average the pair's force and torque on i over the tick.
+        // Each sub-step is sized so the magnets travel at most a fraction of their current separation, from their
+        // relative speed and from the pair's acceleration alike (a pair starting at rest only has the latter), but
+        // no smaller than the timestep divided by the maximum sub-step count.
+        const double minStep = timestep / maxSubsteps;
+        const MagnetVector axisI = snapshot.axis(i);
+        const MagnetVector axisJ = snapshot.axis(j);
+        const double minForce = broadphase.get_min_force();
+        const double cutoffSqr = minForce > 0.0 ? magnet_cutoff_radius_sqr(snapshot.strength[i], snapshot.strength[j], minForce) : 0.0;
+        const double innerSqr = cutoffSqr * (1.0 - cutoffFalloff) * (1.0 - cutoffFalloff);
+        MagnetVector posI = snapshot.position(i);
+        MagnetVector posJ = snapshot.position(j);
+        MagnetVector velI{ snapshot.velX[i], snapshot.velY[i], snapshot.velZ[i] };
+        MagnetVector velJ{ snapshot.velX[j], snapshot.velY[j], snapshot.velZ[j] };
+        MagnetVector forceSum, torqueSum;
+        double elapsed = 0.0;
+        uint32_t steps = 0;
+        while (elapsed < timestep) {
+            const MagnetVector separation{ posJ.x - posI.x, posJ.y - posI.y, posJ.z - posI.z };
+            // The pair is already known to interact; only the force, torque and separation length are used.
+            const MagnetInteraction interaction = magnet_calculate_interaction(separation, axisI, snapshot.strength[i], axisJ, snapshot.strength[j], true, 0.0);
+            MagnetVector f = interaction.force;
+            MagnetVector t = interaction.torque;
+            const double separationLength = interaction.distance;
+            if (minForce > 0.0) {
+                const double separationSqr = separation.x * separation.x + separation.y * separation.y + separation.z * separation.z;
+                const double weight = magnet_cutoff_weight(separationSqr, cutoffSqr, innerSqr);
+                f.x *= weight; f.y *= weight; f.z *= weight;
+                t.x *= weight; t.y *= weight; t.z *= weight;
+            }
+
+            const double rvx = velJ.x - velI.x;
+            const double rvy = velJ.y - velI.y;
+            const double rvz = velJ.z - velI.z;
+            const double speed = std::sqrt(rvx * rvx + rvy * rvy + rvz * rvz);
+            const double maxTravel = SUBSTEP_MAX_TRAVEL * std::max(separationLength, MAGNET_FORCE_MIN_DISTANCE);
+            const double acceleration = std::sqrt(f.x * f.x + f.y * f.y + f.z * f.z) * (inverseMassI + inverseMassJ);
+            double h = timestep - elapsed;
+            if (speed > 0.0) {
+                h = std::min(h, std::max(minStep, maxTravel / speed));
+            }
+            if (acceleration > 0.0) {
+                h = std::min(h, std::max(minStep, std::sqrt(2.0 * maxTravel / acceleration)));
+            }
+            // Absorb a rounding remainder into this sub-step rather than taking a vanishing one.
+            if (timestep - elapsed - h < minStep * 1e-6) h = timestep - elapsed;
+
+            forceSum.x += f.x * h; forceSum.y += f.y * h; forceSum.z += f.z * h;
+            torqueSum.x += t.x * h; torqueSum.y += t.y * h; torqueSum.z += t.z * h;
+
+            velI.x += h * inverseMassI * (restI.x + signI * f.x);
+            velI.y += h * inverseMassI * (restI.y + signI * f.y);
+            velI.z += h * inverseMassI * (restI.z + signI * f.z);
+            velJ.x += h * inverseMassJ * (restJ.x + signJ * f.x);
+            velJ.y += h * inverseMassJ * (restJ.y + signJ * f.y);
+            velJ.z += h * inverseMassJ * (restJ.z + signJ * f.z);
+            posI.x += h * velI.x; posI.y += h * velI.y; posI.z += h * velI.z;
+            posJ.x += h * velJ.x; posJ.y += h * velJ.y; posJ.z += h * velJ.z;
+            elapsed += h;
+            steps++;
+        }
+        if (steps <= 1) continue;
+
+        // Replace the single evaluation by the average. Corrections are applied after every stiff pair is
+        // processed, so each pair sees the same unsubstepped forces regardless of pair order.
+        const double scale = 1.0 / timestep;
+        const double deltaForce[3] = { forceSum.x * scale - force.x, forceSum.y * scale - force.y, forceSum.z * scale - force.z };
+        const double deltaTorque[3] = {
+            torqueSum.x * scale - results.torqueX[p],
+            torqueSum.y * scale - results.torqueY[p],
+            torqueSum.z * scale - results.torqueZ[p]
+        };
+        if (iInfluencedByJ && snapshot.updated[i]) {
+            corrections.push_back({ i, { deltaForce[0], deltaForce[1], deltaForce[2] }, { deltaTorque[0], deltaTorque[1], deltaTorque[2] } });
+        }
+        if (jInfluencedByI && snapshot.updated[j]) {
+            corrections.push_back({ j, { -deltaForce[0], -deltaForce[1], -deltaForce[2] }, { -deltaTorque[0], -deltaTorque[1], -deltaTorque[2] } });
+        }
+        substeppedPairs++;
+    }
+
+    for (const Correction& correction : corrections) {
+        snapshot.forceX[correction.magnet] += correction.force.x;
+        snapshot.forceY[correction.magnet] += correction.force.y;
+        snapshot.forceZ[correction.magnet] += correction.force.z;
+        snapshot.torqueX[correction.magnet] += correction.torque.x;
+        snapshot.torqueY[correction.magnet] += correction.torque.y;
+        snapshot.torqueZ[correction.magnet] += correction.torque.z;
+    }
+}
+
+void MagnetSolver::solve_octree(const MagnetTaskRunner& runner) {
+    octree.build(snapshot);
+    octree.solve(snapshot, runner);
+}
+
+
+// --- Components and stats ---
+
+MagnetBroadphase& MagnetSolver::get_broadphase() {
+    return broadphase;
+}
+
+const MagnetBroadphase& MagnetSolver::get_broadphase() const {
+    return broadphase;
+}
+
+MagnetOctree& MagnetSolver::get_octree() {
+    return octree;
+}
+
+const MagnetOctree& MagnetSolver::get_octree() const {
+    return octree;
+}
+
+uint32_t MagnetSolver::get_task_count() const {
+    return taskCount;
+}
+
+size_t MagnetSolver::get_updated_magnets() const {
+    return updatedMagnets;
+}
+
+size_t MagnetSolver::get_evaluated_pairs() const {
+    return evaluatedPairs;
+}
+
+size_t MagnetSolver::get_substepped_pairs() const {
+    return substeppedPairs;
+}
+
+size_t MagnetSolver::get_cached_pairs() const {
+    return cachedPairs.size();
+}
+
+size_t MagnetSolver::get_deferred_pairs() const {
+    return deferredPairs;
+}
+
+#ifdef MAGNET_PROFILING
+void MagnetSolver::fill_profile(MagnetProfile& profile) const {
+    if (mode == MAGNET_SOLVER_OCTREE) {
+        // Far-field evaluations always apply; leaf kernels also evaluate sources that turn out to be out of range.
+        profile.consideredPairs = octree.get_kernel_evaluations() + octree.get_far_field_evaluations();
+        profile.culledPairs = octree.get_culled_nodes();
+        profile.appliedPairs = octree.get_exact_evaluations() + octree.get_far_field_evaluations();
+        profile.neighborListRebuilds = 0;
+        profile.neighborListAge = 0;
+    } else {
+        profile.consideredPairs = evaluatedPairs;
+        profile.culledPairs = broadphase.get_culled_pairs();
+        profile.appliedPairs = appliedPairs;
+        profile.neighborListRebuilds = broadphase.get_rebuild_count();
+        profile.neighborListAge = broadphase.get_list_age();
+    }
+    profile.lodCachedPairs = cachedPairs.size();
+}
+#endif
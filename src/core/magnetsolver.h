@@ -0,0 +1,533 @@
+#ifndef MAGNET_SOLVER_H
+#define MAGNET_SOLVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "magnetbroadphase.h"
+#include "magnetfieldgrid.h"
+#include "magnetkernel.h"
+#include "magnetoctree.h"
+#include "magnetprofiling.h"
+#include "magnetsnapshot.h"
+#include "magnettasks.h"
+
+/**
+ * Solver algorithms supported by MagnetSolver. These mirror MagneticWorld::SolverModes.
+ * Pairwise: exact reference; every broadphase candidate pair is evaluated.
+ * Octree: Barnes-Hut approximation; distant clusters of magnets are evaluated as single aggregate dipoles.
+ */
+enum MagnetSolverMode : uint8_t {
+    MAGNET_SOLVER_PAIRWISE = 0,
+    MAGNET_SOLVER_OCTREE = 1
+};
+
+/**
+ * Level-of-detail tier of the Pairwise solver. A pair belongs to a tier while the strongest force or torque it could
+ * exert at its current separation stays below the tier's force (that is, while it is farther apart than its cutoff
+ * radius for that force; see magnet_cutoff_radius_sqr). Such a pair is only evaluated once every interval solves, and
+ * its last results are reused in between.
+ */
+struct MagnetLodTier {
+    /** Force bound below which a pair belongs to the tier. */
+    double maxForce = 0.0;
+
+    /** Number of solves between two evaluations of a pair in the tier. */
+    uint32_t interval = 1;
+};
+
+/**
+ * Engine-independent magnetism solver.
+ * The caller fills the snapshot with the state of every magnet, calls solve(), and reads the per-magnet results
+ * back from the snapshot. MagneticWorld drives it from Godot; the native benchmark drives it directly.
+ */
+class MagnetSolver {
+public:
+
+    // --- Constructor ---
+
+    /** Default constructor */
+    MagnetSolver() = default;
+
+
+    // --- Settings ---
+
+    /**
+     * Gets the solver algorithm.
+     *
+     * @return The solver mode.
+     */
+    MagnetSolverMode get_mode() const;
+
+    /**
+     * Sets the solver algorithm.
+     *
+     * @param newMode The new solver mode.
+     */
+    void set_mode(MagnetSolverMode newMode);
+
+    /**
+     * Gets the separation below which a pair is sub-stepped.
+     *
+     * @return The sub-step distance; 0 disables sub-stepping.
+     */
+    double get_substep_distance() const;
+
+    /**
+     * Sets the separation below which a pair is sub-stepped.
+     * Such stiff pairs have their relative motion integrated over several sub-steps within the tick, and apply the
+     * average force and torque along the way instead of a single start-of-tick evaluation. Only used in Pairwise mode,
+     * and only if a timestep is set.
+     *
+     * @param distance The new sub-step distance; 0 disables sub-stepping.
+     */
+    void set_substep_distance(double distance);
+
+    /**
+     * Gets the maximum number of sub-steps per stiff pair and tick.
+     */
+    uint32_t get_max_substeps() const;
+
+    /**
+     * Sets the maximum number of sub-steps per stiff pair and tick.
+     * Sub-steps are sized so the magnets move at most a tenth of their separation in each, but are never shorter than
+     * the timestep divided by this count.
+     *
+     * @param count The new maximum; at least 1.
+     */
+    void set_max_substeps(uint32_t count);
+
+    /**
+     * Gets the physics timestep the forces will be applied for.
+     */
+    double get_timestep() const;
+
+    /**
+     * Sets the physics timestep the forces will be applied for. Only used by sub-stepping.
+     *
+     * @param delta The timestep in seconds.
+     */
+    void set_timestep(double delta);
+
+    /**
+     * Gets the baked field of static magnets added to every magnet's results.
+     *
+     * @return The field, or nullptr if none is used.
+     */
+    const MagnetFieldGrid* get_static_field() const;
+
+    /**
+     * Sets the baked field of static magnets added to every magnet's results.
+     * The static magnets themselves must not be in the snapshot. Call invalidate() after re-baking the field.
+     *
+     * @param field The field, or nullptr for none. Must outlive its use by the solver.
+     * @param layers Magnetic layer of the static magnets; only magnets masking it receive the field. The field should
+     *        be baked from magnets on a single layer, since a union of layers would reach magnets masking only one.
+     */
+    void set_static_field(const MagnetFieldGrid* field, uint32_t layers = MAGNET_ALL_LAYERS);
+
+    /**
+     * Gets the floating-point precision of the pair kernels.
+     *
+     * @return The kernel precision.
+     */
+    MagnetPrecision get_precision() const;
+
+    /**
+     * Sets the floating-point precision of the pair kernels.
+     * In float mode the kernel inputs are converted once per solve, and pairs are evaluated in single precision;
+     * the per-magnet sums are still accumulated in double precision. Only used in Pairwise mode.
+     *
+     * @param newPrecision The new kernel precision.
+     */
+    void set_precision(MagnetPrecision newPrecision);
+
+    /**
+     * Gets the minimum force below which pairs are cut off.
+     *
+     * @return The minimum force; 0 disables the cutoff.
+     */
+    double get_min_force() const;
+
+    /**
+     * Sets the minimum force below which pairs are cut off. Only used in Pairwise mode.
+     * Each pair then only interacts within its cutoff radius, derived from both magnets' strengths (see
+     * magnet_cutoff_radius_sqr), as well as within the sphere of influence. Pairs beyond it never reach the kernels,
+     * and the force and torque of pairs near it fade out (see set_cutoff_falloff).
+     *
+     * @param minForce The new minimum force; 0 disables the cutoff.
+     */
+    void set_min_force(double minForce);
+
+    /**
+     * Gets the width of the cutoff falloff, as a fraction of each pair's cutoff radius.
+     */
+    double get_cutoff_falloff() const;
+
+    /**
+     * Sets the width of the cutoff falloff, as a fraction of each pair's cutoff radius. Pairs closer than
+     * (1 - fraction) times their cutoff radius are unaffected; beyond that, their force and torque ease to 0 at the
+     * cutoff, so pairs crossing it do not pop.
+     *
+     * @param fraction The new falloff width, clamped to [0, 1]; 0 cuts pairs off sharply.
+     */
+    void set_cutoff_falloff(double fraction);
+
+    /**
+     * Gets whether results of magnets whose neighbourhood did not change are reused between solve calls.
+     *
+     * @return True if incremental solving is enabled.
+     */
+    bool get_incremental() const;
+
+    /**
+     * Sets whether results of magnets whose neighbourhood did not change are reused between solve calls.
+     * Reused results are identical to those a full solve would produce.
+     *
+     * @param enabled True to enable incremental solving.
+     */
+    void set_incremental(bool enabled);
+
+    /**
+     * Gets the level-of-detail tiers of the Pairwise solver, by ascending force.
+     *
+     * @return The tiers; empty if every pair is evaluated on every solve.
+     */
+    const std::vector<MagnetLodTier>& get_lod_tiers() const;
+
+    /**
+     * Sets the level-of-detail tiers of the Pairwise solver (see MagnetLodTier).
+     * A pair takes the tier with the smallest force it stays below, so the weakest pairs are refreshed least often.
+     * Pairs of a tier are spread round-robin over its interval, so each solve refreshes about the same share of them.
+     * Pairs closer than the sub-step distance, and pairs above every tier's force, are evaluated on every solve.
+     *
+     * @param tiers The new tiers, in any order; tiers with a non-positive force or an interval below 2 are ignored.
+     */
+    void set_lod_tiers(const std::vector<MagnetLodTier>& tiers);
+
+    /**
+     * Gets the maximum number of pair evaluations per solve.
+     *
+     * @return The budget; 0 means unlimited.
+     */
+    uint32_t get_lod_budget() const;
+
+    /**
+     * Sets the maximum number of pair evaluations per solve, while level-of-detail tiers are set.
+     * Pairs at full rate are always evaluated. The tier pairs that are due share the rest of the budget, the longest
+     * unrefreshed first; the others keep their last results, or contribute nothing until evaluated if they are new.
+     *
+     * @param maxEvaluations The new budget; 0 means unlimited.
+     */
+    void set_lod_budget(uint32_t maxEvaluations);
+
+    /**
+     * Copies the settings of another solver: mode, precision, sub-stepping, timestep, static field, pair cutoff,
+     * broadphase cell size and octree opening angle. The incremental mode, the neighbor list skin and the
+     * level-of-detail settings are kept.
+     *
+     * @param other The solver to copy from.
+     */
+    void copy_settings(const MagnetSolver& other);
+
+    /**
+     * Discards the state kept from the previous solve, so the next solve recomputes every magnet.
+     * Must be called whenever a snapshot index may refer to a different magnet than in the previous solve.
+     */
+    void invalidate();
+
+
+    // --- Core methods ---
+
+    /**
+     * Gets the snapshot the solver reads magnet state from and writes results to.
+     *
+     * @return The snapshot.
+     */
+    MagnetSnapshot& get_snapshot();
+    const MagnetSnapshot& get_snapshot() const;
+
+    /**
+     * Accumulates the force, torque and influence flag of every magnet in the snapshot.
+     * Results are identical for any task runner. In incremental mode, magnets whose state and neighbours' states
+     * are unchanged since the previous solve keep their results, and are flagged as not updated in the snapshot.
+     *
+     * @param runner Runs the solver's tasks, possibly in parallel.
+     */
+    void solve(const MagnetTaskRunner& runner = magnet_run_tasks_serial);
+
+    /**
+     * Solves a subset of another snapshot's magnets within the current tick, e.g. for the few magnets that cannot
+     * wait for a pipelined solve of the whole scene.
+     * Fills this solver's snapshot with the selected magnets, in order, followed by every magnet that can influence
+     * one of them, and solves it. The selected magnets' results match a solve of the whole source snapshot up to
+     * rounding, except that sub-stepped pairs only see the other forces on their partners from within the subset.
+     * The results of the partners are incomplete and should be ignored. Meant for a solver that is not incremental.
+     *
+     * @param source The snapshot to select from.
+     * @param selected Indices of the selected magnets in source, without duplicates.
+     * @param runner Runs the solver's tasks, possibly in parallel.
+     */
+    void solve_subset(const MagnetSnapshot& source, const std::vector<uint32_t>& selected,
+        const MagnetTaskRunner& runner = magnet_run_tasks_serial);
+
+    /**
+     * Gets the index in the source snapshot of each magnet of the last solve_subset call, in snapshot order.
+     *
+     * @return The source indices; the selected magnets come first.
+     */
+    const std::vector<uint32_t>& get_subset_indices() const;
+
+    /**
+     * Samples the magnetic influence of the snapshot's magnets, and of the static field, at many points.
+     * The points are probed with the broadphase grid of the last solve and the batch kernel, as a magnet of unit
+     * strength that is not part of the snapshot. Like a permanent magnet, the probe is influenced by every magnet
+     * that is on and whose sphere of influence contains the point.
+     * With an axis, each result is the force such a probe with that pole direction receives; it scales linearly with
+     * the probe's strength. Without one, each result is the field the probe's pole aligns with: a probe with pole
+     * direction a receives the torque a x field.
+     *
+     * @param points The sample points.
+     * @param count The number of points.
+     * @param axis The normalized pole direction of the probe, or nullptr to sample the field.
+     * @param out Receives one result per point.
+     * @param runner Runs the sampling tasks, possibly in parallel.
+     */
+    void sample_field(const MagnetVector* points, size_t count, const MagnetVector* axis, MagnetVector* out,
+        const MagnetTaskRunner& runner = magnet_run_tasks_serial);
+
+
+    // --- Components and stats for the last solve call ---
+
+    /** Gets the broadphase used in Pairwise mode. */
+    MagnetBroadphase& get_broadphase();
+    const MagnetBroadphase& get_broadphase() const;
+
+    /** Gets the octree used in Octree mode. */
+    MagnetOctree& get_octree();
+    const MagnetOctree& get_octree() const;
+
+    /**
+     * Gets the number of tasks run during the last solve call.
+     */
+    uint32_t get_task_count() const;
+
+    /**
+     * Gets the number of magnets whose results were recomputed during the last solve call.
+     */
+    size_t get_updated_magnets() const;
+
+    /**
+     * Gets the number of pairs (or octree interactions) evaluated during the last solve call. Tier pairs reusing
+     * their cached results are not counted.
+     */
+    size_t get_evaluated_pairs() const;
+
+    /**
+     * Gets the number of stiff pairs sub-stepped during the last solve call.
+     */
+    size_t get_substepped_pairs() const;
+
+    /**
+     * Gets the number of tier pairs that reused their last results during the last solve call.
+     */
+    size_t get_cached_pairs() const;
+
+    /**
+     * Gets the number of tier pairs that were due but left for later solves by the budget during the last solve call.
+     */
+    size_t get_deferred_pairs() const;
+
+#ifdef MAGNET_PROFILING
+    /**
+     * Fills the pair counters of a profile from the last solve call.
+     *
+     * @param profile The profile to fill; its timings are left untouched.
+     */
+    void fill_profile(MagnetProfile& profile) const;
+#endif
+
+private:
+
+    // --- Private fields ---
+
+    /** The solver algorithm. */
+    MagnetSolverMode mode = MAGNET_SOLVER_PAIRWISE;
+
+    /** The floating-point precision of the pair kernels. */
+    MagnetPrecision precision = MAGNET_PRECISION_DOUBLE;
+
+    /** Whether results are reused between solve calls. */
+    bool incremental = true;
+
+    /** Sub-stepping settings; a distance of 0 disables sub-stepping. */
+    double substepDistance = 0.0;
+    uint32_t maxSubsteps = 16;
+    double timestep = 0.0;
+
+    /** Width of the cutoff falloff, as a fraction of the cutoff radius. The minimum force lives in the broadphase. */
+    double cutoffFalloff = 0.25;
+
+    /** Baked field of static magnets, or nullptr. */
+    const MagnetFieldGrid* staticField = nullptr;
+    uint32_t staticFieldLayers = MAGNET_ALL_LAYERS;
+
+    /** Whether previousState and previousPairs describe the previous solve. */
+    bool previousValid = false;
+
+    /** Whether the broadphase grid was built from the current snapshot, so sample_field can query it. */
+    bool broadphaseCurrent = false;
+
+    /** Stats for the last solve call. */
+    uint32_t taskCount = 0;
+    size_t updatedMagnets = 0;
+    size_t evaluatedPairs = 0;
+    size_t substeppedPairs = 0;
+    size_t deferredPairs = 0;
+
+#ifdef MAGNET_PROFILING
+    /** Pair influences accumulated during the last Pairwise solve. */
+    uint64_t appliedPairs = 0;
+#endif
+
+    /** Structure-of-arrays state and results of all magnets. */
+    MagnetSnapshot snapshot;
+
+    /** Spatial hash broadphase that culls pairs outside each other's spheres of influence. */
+    MagnetBroadphase broadphase;
+
+    /** Candidate pairs found by the broadphase for the current solve. */
+    std::vector<MagnetPair> pairs;
+
+    /** Gathered state and candidate pairs of the previous solve. */
+    MagnetSnapshot previousState;
+    std::vector<MagnetPair> previousPairs;
+
+    /** Whether each magnet's state changed since the previous solve. */
+    std::vector<uint8_t> changed;
+
+    /** Candidate pairs touching a magnet whose results are recomputed. */
+    std::vector<MagnetPair> activePairs;
+
+    /** Candidate pairs closer than the sub-step distance. */
+    std::vector<MagnetPair> stiffPairs;
+
+    /**
+     * Change to one magnet's results from replacing a single pair evaluation by its sub-stepped average.
+     */
+    struct Correction {
+        uint32_t magnet;
+        MagnetVector force;
+        MagnetVector torque;
+    };
+
+    /** Sub-stepping corrections of the current solve. */
+    std::vector<Correction> corrections;
+
+    /** Evaluated pairs, bucketed by the types of their magnets (see bucket_pairs). */
+    std::vector<MagnetPair> bucketedPairs;
+
+    /** Kernel results for each bucketed pair, in bucketed order; one buffer per precision. */
+    MagnetPairResults pairResults;
+    MagnetPairResultsT<float> pairResultsFloat;
+
+    /** Single-precision kernel inputs, converted once per solve in float mode. */
+    MagnetKernelStateF floatState;
+
+    /** Barnes-Hut octree used in Octree mode. */
+    MagnetOctree octree;
+
+    /** Level-of-detail settings, and the number of Pairwise solves, which schedules the tiers. */
+    std::vector<MagnetLodTier> lodTiers;
+    uint32_t lodBudget = 0;
+    uint64_t lodTick = 0;
+
+    /** Number of magnets the cache was filled with; the cache is dropped when it changes. */
+    size_t lodMagnetCount = 0;
+
+    /**
+     * Last results of a pair in a level-of-detail tier, oriented like the pair.
+     */
+    struct LodEntry {
+        MagnetVector force;
+        MagnetVector torque;
+        uint8_t influence = 0;
+
+        /** Solves at which the pair was last evaluated, and last found in a tier. */
+        uint64_t evaluatedTick = 0;
+        uint64_t seenTick = 0;
+    };
+
+    /** Results of the tier pairs, keyed by their two magnets. */
+    std::unordered_map<uint64_t, LodEntry> lodCache;
+
+    /** Pairs to evaluate this solve, and the cache entry of each (nullptr for pairs at full rate). */
+    std::vector<MagnetPair> lodPairs;
+    std::vector<LodEntry*> lodPairEntries;
+
+    /** Tier pairs reusing their cached results this solve. */
+    std::vector<std::pair<MagnetPair, const LodEntry*>> cachedPairs;
+
+    /** Tier pairs that are due this solve, with the number of solves since their last evaluation. */
+    struct LodCandidate {
+        MagnetPair pair;
+        LodEntry* entry;
+        uint64_t age;
+    };
+    std::vector<LodCandidate> lodCandidates;
+
+    /** Index into the pairs passed to bucket_pairs of each bucketed pair; only filled while tiers are set. */
+    std::vector<uint32_t> bucketedSource;
+
+    /** Source index of each magnet of the last solve_subset call, whether each source magnet is part of it, and the
+     *  sources found around one selected magnet. */
+    std::vector<uint32_t> subsetIndices;
+    std::vector<uint8_t> subsetIncluded;
+    std::vector<uint32_t> subsetSources;
+
+
+    // --- Solver phases ---
+
+    /**
+     * Evaluates every broadphase candidate pair once and accumulates the per-magnet results.
+     * If reuse is set, only pairs touching a magnet that changed or neighbours one are evaluated.
+     */
+    void solve_pairs(const MagnetTaskRunner& runner, bool reuse);
+
+    /**
+     * Stably sorts pairs into bucketedPairs by the types of their first and second magnets, so each kernel call
+     * covers a long run of pairs with one type combination. Within a bucket pairs keep their order, so an
+     * incremental solve still reduces each updated magnet's pairs in the same order as a full solve.
+     */
+    void bucket_pairs(const std::vector<MagnetPair>& source);
+
+    /**
+     * Splits the pairs about to be evaluated by level-of-detail tier into lodPairs, evaluated this solve, and
+     * cachedPairs, which reuse their last results.
+     */
+    void schedule_lod(const std::vector<MagnetPair>& source);
+
+    /**
+     * Evaluates the bucketed pairs in parallel at one precision, then accumulates the per-magnet results.
+     */
+    template <typename Scalar>
+    void accumulate_pairs(const MagnetTaskRunner& runner, MagnetPairResultsT<Scalar>& results);
+
+    /**
+     * Replaces the single evaluation of every evaluated pair closer than the sub-step distance by the average force
+     * and torque along its sub-stepped trajectory over the tick.
+     */
+    template <typename Scalar>
+    void substep_stiff_pairs(const MagnetPairResultsT<Scalar>& results);
+
+    /**
+     * Approximates the per-magnet results with the Barnes-Hut octree.
+     */
+    void solve_octree(const MagnetTaskRunner& runner);
+};
+
+
+#endif // MAGNET_SOLVER_H
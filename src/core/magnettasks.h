@@ -0,0 +1,33 @@
+#ifndef MAGNET_TASKS_H
+#define MAGNET_TASKS_H
+
+#include <cstdint>
+#include <functional>
+
+/**
+ * A unit of solver work, identified by its task index.
+ * Tasks must be independent of each other: each writes only to data owned by its own index.
+ */
+using MagnetTaskFunction = std::function<void(uint32_t taskIndex)>;
+
+/**
+ * Runs taskCount tasks, possibly in parallel, and returns once all of them have finished.
+ * The solver splits its work into a number of tasks that depends only on the amount of work (never on the number
+ * of threads), and reduces task results in task order, so results are identical for any runner.
+ */
+using MagnetTaskRunner = std::function<void(uint32_t taskCount, const MagnetTaskFunction& task)>;
+
+/**
+ * Runs every task in order on the calling thread.
+ *
+ * @param taskCount The number of tasks.
+ * @param task The task function.
+ */
+inline void magnet_run_tasks_serial(uint32_t taskCount, const MagnetTaskFunction& task) {
+    for (uint32_t taskIndex = 0; taskIndex < taskCount; taskIndex++) {
+        task(taskIndex);
+    }
+}
+
+
+#endif // MAGNET_TASKS_H
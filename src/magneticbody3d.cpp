@@ -1,16 +1,18 @@
 #include "magneticbody3d.h"
+#include "magneticworld.h"
+#include "core/magnetmodel.h"
 #include <godot_cpp/classes/engine.hpp>
 #include <godot_cpp/variant/utility_functions.hpp>
 #include <godot_cpp/classes/scene_tree.hpp>
 #include <godot_cpp/classes/viewport.hpp>
-#include <cmath>
+#include <godot_cpp/classes/window.hpp>
 
 using namespace godot;
 
 // --- Class initialization and destruction ---
 
 // Initialize static registry
-std::vector<MagneticBody3D*> MagneticBody3D::sceneMagnetsRegistry;
+MagnetRegistry<MagneticBody3D> MagneticBody3D::sceneMagnetsRegistry;
 
 MagneticBody3D::~MagneticBody3D() {
     // Remove magnet from the static registry
@@ -36,27 +38,47 @@ void MagneticBody3D::_bind_methods() {
     ClassDB::bind_method(D_METHOD("set_on", "on"), &MagneticBody3D::set_on);
     ClassDB::bind_method(D_METHOD("get_on"), &MagneticBody3D::get_on);
 
-    // Expose magnet type and strength to the editor
+    ClassDB::bind_method(D_METHOD("reset_magnet_state"), &MagneticBody3D::reset_magnet_state);
+
+    ClassDB::bind_method(D_METHOD("set_magnetic_layer", "layer"), &MagneticBody3D::set_magnetic_layer);
+    ClassDB::bind_method(D_METHOD("get_magnetic_layer"), &MagneticBody3D::get_magnetic_layer);
+
+    ClassDB::bind_method(D_METHOD("set_magnetic_mask", "mask"), &MagneticBody3D::set_magnetic_mask);
+    ClassDB::bind_method(D_METHOD("get_magnetic_mask"), &MagneticBody3D::get_magnetic_mask);
+
+    ClassDB::bind_method(D_METHOD("set_baked_static", "enabled"), &MagneticBody3D::set_baked_static);
+    ClassDB::bind_method(D_METHOD("get_baked_static"), &MagneticBody3D::get_baked_static);
+
+    ClassDB::bind_method(D_METHOD("set_synchronous_solve", "enabled"), &MagneticBody3D::set_synchronous_solve);
+    ClassDB::bind_method(D_METHOD("get_synchronous_solve"), &MagneticBody3D::get_synchronous_solve);
+
+    // Magnetic physics
+    ClassDB::bind_method(D_METHOD("calculate_interaction", "other"), &MagneticBody3D::_calculate_interaction_bind);
+
+    // Expose magnet type, strength and magnetic layers to the editor; layers use the 3D physics layer editor
     ADD_PROPERTY(PropertyInfo(Variant::INT, "magnet_type", PROPERTY_HINT_ENUM, "Permanent,Temporary,Electromagnet"), "set_magnet_type", "get_magnet_type");
     ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "strength"), "set_strength", "get_strength");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "magnetic_layer", PROPERTY_HINT_LAYERS_3D_PHYSICS), "set_magnetic_layer", "get_magnetic_layer");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "magnetic_mask", PROPERTY_HINT_LAYERS_3D_PHYSICS), "set_magnetic_mask", "get_magnetic_mask");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "baked_static"), "set_baked_static", "get_baked_static");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "synchronous_solve"), "set_synchronous_solve", "get_synchronous_solve");
 }
 
 
 // --- Core methods / magnetic physics calculations ---
 
+// The calculations below are wrappers around the engine-independent model in core/magnetmodel.h,
+// which every solver path shares.
+
+// Converts a Godot vector to the core's vector type.
+static MagnetVector to_magnet_vector(const Vector3& v) {
+    return MagnetVector{ v.x, v.y, v.z };
+}
+
 bool MagneticBody3D::will_be_influenced_by(const MagneticBody3D& other) {
-    // If the other magnet is off, it exerts no influence.
-    if (!other.on) {
+    if (!magnet_layers_allow(magneticMask, other.magneticLayer) || !magnet_can_be_influenced_by(magnetType, other.magnetType, other.on, other.magnetized)) {
         return false;
     }
-
-    // If this is a temporary magnet and the other is also a temporary magnet,
-    // the other should only potentially exert a force if it has become magnetized.
-    if (magnetType == Temporary && other.magnetType == Temporary) {
-        if (other.magnetized == false) {
-            return false;
-        }
-    }
     
     // Get the vector from this magnet to the other.
     Vector3 distance = other.get_global_position() - get_global_position();
@@ -65,71 +87,41 @@ bool MagneticBody3D::will_be_influenced_by(const MagneticBody3D& other) {
     return distance.length_squared() <= other.maxInfluenceRadiusSqr;
 }
 
-Vector3 MagneticBody3D::calculate_force_from_magnet(const MagneticBody3D& other) const {
-    // The calculation below is roughly based on real magnetism formulas.
-    // Essentially, the inverse square law is used to calculate force magnitude based on proximity.
-    // This is then scaled based on the magnets' strengths, their relative alignments, and a custom scaling factor.
-    // Force direction is determined by the distance vector between the two magnets.
+MagnetInteraction MagneticBody3D::calculate_interaction(const MagneticBody3D& other) const {
+    const Transform3D transform = get_global_transform();
+    const Transform3D otherTransform = other.get_global_transform();
 
-    // Define scaling factor to make forces visible in-game.
-    const double FORCE_SCALING = 100.0;
+    const bool canBeInfluenced = magnet_layers_allow(magneticMask, other.magneticLayer)
+        && magnet_can_be_influenced_by(magnetType, other.magnetType, other.on, other.magnetized);
+    return magnet_calculate_interaction(
+        to_magnet_vector(otherTransform.origin - transform.origin),
+        to_magnet_vector(transform.basis.get_column(2).normalized()), strength,
+        to_magnet_vector(otherTransform.basis.get_column(2).normalized()), other.strength,
+        canBeInfluenced, other.maxInfluenceRadiusSqr);
+}
 
-    // Get the length of the distance between the two magnets.
-    Vector3 r = other.get_global_position() - get_global_position();
-    double r_len = r.length();
-    
-    // Establish a minimum distance length to prevent division by zero and too large forces at very small distances.
-    if (r_len < 0.01) r_len = 0.01;
-    
-    // Get the unit vector of the distance between the magnets.
-    // This will determine the axis of the final force vector.
-    Vector3 r_hat = r / r_len;
-    
-    // Get the forward (local Z) directions of both magnets.
-    Vector3 m1_dir = get_global_transform().basis.get_column(2).normalized();
-    Vector3 m2_dir = other.get_global_transform().basis.get_column(2).normalized();
-    
-    // Calculate alignment factor (-1 to 1) to determine whether attraction or repulsion will occur, and at what strength.
-    double alignment = m1_dir.dot(m2_dir);
-    
-    // Determine the final magnitude of the force experienced by this magnet.
-    double force_magnitude = FORCE_SCALING * strength * other.strength * alignment / (r_len * r_len);
-    
-    // Put together and return the final, scaled force vector.
-    return r_hat * force_magnitude;
+Vector3 MagneticBody3D::calculate_force_from_magnet(const MagneticBody3D& other) const {
+    const MagnetVector force = calculate_interaction(other).force;
+    return Vector3(force.x, force.y, force.z);
 }
 
 Vector3 MagneticBody3D::calculate_torque_from_magnet(const MagneticBody3D& other) const {
-    // The calculation below is roughly based on real magnetism formulas.
-    // Essentially, the inverse square law is used to calculate torque magnitude based on proximity.
-    // This is then scaled based on the magnets' strengths and a custom scaling factor.
-    // Torque direction is determined by the relative pole orientations of the magnets.
+    const MagnetVector torque = calculate_interaction(other).torque;
+    return Vector3(torque.x, torque.y, torque.z);
+}
 
-    // Define scaling factor to make torque visible in-game.
-    const double TORQUE_SCALING = 10.0;
-    
-    // Get the length of the distance between the two magnets.
-    Vector3 r = other.get_global_position() - get_global_position();
-    double r_len = r.length();
-    
-    // Establish a minimum distance length to prevent division by zero and too large torques at very small distances.
-    if (r_len < 0.1) r_len = 0.1;
-    
-    // Get the forward (local Z) directions of both magnets.
-    Vector3 m1_dir = get_global_transform().basis.get_column(2).normalized();
-    Vector3 m2_dir = other.get_global_transform().basis.get_column(2).normalized();
-    
-    // Calculate torque direction.
-    Vector3 torque = m1_dir.cross(m2_dir);
-    
-    // Determine the final magnitude of the torque experienced by this magnet.
-    double torque_magnitude = TORQUE_SCALING * strength * other.strength / (r_len * r_len);
-    
-    // Put together and return the final, scaled torque vector.
-    return torque * torque_magnitude;
+Dictionary MagneticBody3D::_calculate_interaction_bind(const MagneticBody3D* other) const {
+    Dictionary result;
+    ERR_FAIL_NULL_V(other, result);
+
+    const MagnetInteraction interaction = calculate_interaction(*other);
+    result["force"] = Vector3(interaction.force.x, interaction.force.y, interaction.force.z);
+    result["torque"] = Vector3(interaction.torque.x, interaction.torque.y, interaction.torque.z);
+    result["influenced"] = interaction.influenced;
+    return result;
 }
 
-void MagneticBody3D::_ready() {
+void MagneticBody3D::reset_magnet_state() {
     // At the start of the scene, establish the following environment:
     // - Permanent magnets are on
     // - Temporary magnets are on, but start off not magnetized
@@ -139,35 +131,23 @@ void MagneticBody3D::_ready() {
     if (magnetType == Electromagnet) {
         on = false;
     }
+}
+
+void MagneticBody3D::_ready() {
+    reset_magnet_state();
 
     // Define influence radius according to the magnet's strength.
-    maxInfluenceRadiusSqr = strength * strength * 500.0;
+    maxInfluenceRadiusSqr = magnet_influence_radius_sqr(strength);
 
     // Register this magnet with the static collection of all magnets in the scene.
     register_magnet(this);
-}
 
-void MagneticBody3D::_physics_process(double delta) {
-    // If this magnet is currently off, it should be excluded from magnetism calculations.
-    if (!on) return;
-
-    // It is assumed that temporary magnets are currently not magnetized, until influenced by another magnet in the code below.
-    magnetized = false;
-
-    // Apply forces to this magnet.
-    for (const auto& otherMagnet : sceneMagnetsRegistry) {
-        if (otherMagnet != this) {
-            if (will_be_influenced_by(*otherMagnet)) {
-                if (magnetType == Temporary) {
-                    magnetized = true;
-                }
-                Vector3 force = calculate_force_from_magnet(*otherMagnet);
-                Vector3 torque = calculate_torque_from_magnet(*otherMagnet);
-
-                apply_central_force(force);
-                apply_torque(torque);
-            }
-        }
+    // Make sure a solver exists to process this magnet. Scenes may place a MagneticWorld explicitly;
+    // otherwise one is added to the scene root.
+    if (MagneticWorld::get_singleton() == nullptr && !Engine::get_singleton()->is_editor_hint()) {
+        MagneticWorld* world = memnew(MagneticWorld);
+        world->set_name("MagneticWorld");
+        get_tree()->get_root()->call_deferred("add_child", world);
     }
 }
 
@@ -175,23 +155,27 @@ void MagneticBody3D::_physics_process(double delta) {
 // --- Magnet registry management ---
 
 void MagneticBody3D::register_magnet(MagneticBody3D* magnet) {
-    if (std::find(sceneMagnetsRegistry.begin(), sceneMagnetsRegistry.end(), magnet) == sceneMagnetsRegistry.end()) {
-        sceneMagnetsRegistry.push_back(magnet);
+    if (!sceneMagnetsRegistry.contains(magnet->registryHandle)) {
+        magnet->registryHandle = sceneMagnetsRegistry.insert(magnet);
     }
 }
 
 void MagneticBody3D::unregister_magnet(MagneticBody3D* magnet) {
-    auto registryElement = std::find(sceneMagnetsRegistry.begin(), sceneMagnetsRegistry.end(), magnet);
-    if (registryElement != sceneMagnetsRegistry.end()) {
-        sceneMagnetsRegistry.erase(registryElement);
-    }
+    sceneMagnetsRegistry.remove(magnet->registryHandle);
+    magnet->registryHandle = MagnetHandle();
 }
 
 
 // --- Getters and setters ---
 // Magnet registry
-std::vector<MagneticBody3D*>& MagneticBody3D::get_magnets_registry() {
-    return sceneMagnetsRegistry;
+const std::vector<MagneticBody3D*>& MagneticBody3D::get_magnets_registry() {
+    return sceneMagnetsRegistry.get_dense();
+}
+MagnetHandle MagneticBody3D::get_registry_handle() const {
+    return registryHandle;
+}
+bool MagneticBody3D::is_registered(const MagnetHandle& handle) {
+    return sceneMagnetsRegistry.contains(handle);
 }
 
 // Magnet type
@@ -221,4 +205,37 @@ bool MagneticBody3D::get_on() {
 }
 void MagneticBody3D::set_on(bool newState) {
     on = newState;
-}
\ No newline at end of file
+}
+
+// Magnetic layers
+uint32_t MagneticBody3D::get_magnetic_layer() const {
+    return magneticLayer;
+}
+void MagneticBody3D::set_magnetic_layer(uint32_t layer) {
+    magneticLayer = layer;
+}
+uint32_t MagneticBody3D::get_magnetic_mask() const {
+    return magneticMask;
+}
+void MagneticBody3D::set_magnetic_mask(uint32_t mask) {
+    magneticMask = mask;
+}
+
+// Static field baking
+bool MagneticBody3D::get_baked_static() const {
+    return bakedStatic;
+}
+bool MagneticBody3D::is_baked_source() const {
+    return bakedStatic && magnetType == Permanent;
+}
+void MagneticBody3D::set_baked_static(bool enabled) {
+    bakedStatic = enabled;
+}
+
+// Synchronous solving
+bool MagneticBody3D::get_synchronous_solve() const {
+    return synchronousSolve;
+}
+void MagneticBody3D::set_synchronous_solve(bool enabled) {
+    synchronousSolve = enabled;
+}
@@ -7,6 +7,10 @@
 #include <godot_cpp/classes/engine.hpp>
 #include <godot_cpp/classes/physics_body3d.hpp>
 #include <godot_cpp/classes/rigid_body3d.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+
+#include "core/magnetmodel.h"
+#include "core/magnetregistry.h"
 
 using namespace godot;
 
@@ -49,11 +53,27 @@ public:
     // --- Public getters and setters ---
 
     /**
-     * Gets the registry containing references to all the magnets in the scene.
+     * Gets a dense view of all the magnets in the scene, in no particular order.
+     * The view is invalidated when magnets are registered or unregistered.
+     * 
+     * @return A reference to the dense array of the static magnets registry.
+     */
+    static const std::vector<MagneticBody3D*>& get_magnets_registry();
+
+    /**
+     * Gets this magnet's handle in the magnets registry.
      * 
-     * @return A reference to the static magnets registry.
+     * @return The registry handle; unset if the magnet has not been registered.
      */
-    static std::vector<MagneticBody3D*>& get_magnets_registry();
+    MagnetHandle get_registry_handle() const;
+
+    /**
+     * Checks whether a registry handle still refers to a registered magnet.
+     * 
+     * @param handle The handle to check.
+     * @return True if the magnet it was issued for is still registered, false if not.
+     */
+    static bool is_registered(const MagnetHandle& handle);
 
     /**
      * Gets the magnet type for this magnet.
@@ -90,21 +110,110 @@ public:
      */
     void set_on(bool newState);
 
+    /**
+     * Restores the on-state and magnetization this magnet has at the start of the scene:
+     * permanent and temporary magnets are on, electromagnets are off, and temporary magnets are not magnetized.
+     * Lets pooled magnets be reused as if they were newly spawned.
+     */
+    void reset_magnet_state();
+
+    /**
+     * Gets the magnetic layers this magnet is on.
+     * 
+     * @return The layer bitmask.
+     */
+    uint32_t get_magnetic_layer() const;
+
+    /**
+     * Sets the magnetic layers this magnet is on. Only magnets masking one of these layers are influenced by it.
+     * 
+     * @param layer The new layer bitmask.
+     */
+    void set_magnetic_layer(uint32_t layer);
+
+    /**
+     * Gets the magnetic layers this magnet is influenced by.
+     * 
+     * @return The mask bitmask.
+     */
+    uint32_t get_magnetic_mask() const;
+
+    /**
+     * Sets the magnetic layers this magnet is influenced by. Magnets on none of these layers are ignored by this one,
+     * and such pairs are rejected by the solver before any distance or force computation.
+     * 
+     * @param mask The new mask bitmask.
+     */
+    void set_magnetic_mask(uint32_t mask);
+
+    /**
+     * Gets whether this magnet is baked into the MagneticWorld's static field grid.
+     * 
+     * @return True if the magnet is baked static, false if not.
+     */
+    bool get_baked_static() const;
+
+    /**
+     * Sets whether this magnet is baked into the MagneticWorld's static field grid.
+     * Baked static magnets must be frozen permanent magnets. Once the world's static field is baked, they are left out
+     * of the solve and the other magnets sample their combined field from the grid instead. Magnets of other types
+     * are not baked, and keep being solved.
+     * 
+     * @param enabled True to bake this magnet into the static field.
+     */
+    void set_baked_static(bool enabled);
+
+    /**
+     * Gets whether this magnet is represented by the static field once it is baked: it is flagged baked static and is
+     * a permanent magnet.
+     * 
+     * @return True if the magnet is a static field source, false if not.
+     */
+    bool is_baked_source() const;
+
+    /**
+     * Gets whether this magnet is always solved within the current physics tick.
+     * 
+     * @return True if the magnet is solved synchronously, false if not.
+     */
+    bool get_synchronous_solve() const;
+
+    /**
+     * Sets whether this magnet is always solved within the current physics tick.
+     * While the MagneticWorld pipelines its solve, forces lag one tick behind the magnets' state; synchronous magnets
+     * are solved again within the tick against their current neighbours, so precision-critical bodies such as
+     * projectiles keep reacting without latency. Only worth enabling for a few magnets.
+     * 
+     * @param enabled True to solve this magnet synchronously.
+     */
+    void set_synchronous_solve(bool enabled);
+
 
     // --- Core magnetism methods ---
 
     /**
      * Determines if this magnet will be influenced by another magnet.
-     * The other magnet will only exert an influence on this one if this one lies within the other's sphere of influence,
-     * as defined by its maxInfluenceRadiusSqr.
+     * The other magnet will only exert an influence on this one if the other is on a layer in this one's magnetic mask,
+     * and this one lies within the other's sphere of influence, as defined by its maxInfluenceRadiusSqr.
      * 
      * @param other The other magnet which may or may not exert an influence on this object.
      * @return True if the other magnet will exert an influence on this one, false if not.
      */
     bool will_be_influenced_by(const MagneticBody3D& other);
 
+    /**
+     * Calculates the force and torque exerted on this magnet by another magnet, and whether the other magnet will
+     * influence this one, from one read of both transforms and one separation length.
+     * 
+     * @param other The other magnet.
+     * @return The force, the torque and the influence flag, with the same semantics as calculate_force_from_magnet,
+     *         calculate_torque_from_magnet and will_be_influenced_by.
+     */
+    MagnetInteraction calculate_interaction(const MagneticBody3D& other) const;
+
     /**
      * Calculates the magnetic force exerted on this magnet by another magnet.
+     * Wrapper around calculate_interaction.
      * 
      * @param other The other magnet.
      * @return The vector indicating the central force this magnet will experience.
@@ -113,6 +222,7 @@ public:
 
     /**
      * Calculates the torque exerted on this magnet by another magnet due to their dipoles seeking to align.
+     * Wrapper around calculate_interaction.
      * 
      * @param other The other magnet.
      * @return The vector indicating the torque this magnet will experience.
@@ -121,23 +231,31 @@ public:
 
     /**
      * Called when the node enters the scene tree for the first time.
-     * Initializes this magnetic object's properties.
+     * Initializes this magnetic object's properties and ensures a MagneticWorld exists to solve it.
+     * Forces are accumulated and applied by the MagneticWorld solver once per physics frame.
      */
     virtual void _ready() override;
 
-    /**
-     * Accumulates and applies to this magnet the forces exerted by all other magnets in the scene for the current physics frame.
-     */
-    virtual void _physics_process(double delta) override;
-
 protected:
     /**
      * Binds methods and registers properties for the editor.
      */
     static void _bind_methods();
+
+    /**
+     * Script binding of calculate_interaction.
+     * 
+     * @param other The other magnet.
+     * @return A dictionary with the "force" and "torque" vectors and the "influenced" flag, or an empty dictionary
+     *         if other is null.
+     */
+    Dictionary _calculate_interaction_bind(const MagneticBody3D* other) const;
     
 private:
 
+    // The solver reads and updates magnet state directly.
+    friend class MagneticWorld;
+
     // --- Private fields ---
 
     /**
@@ -169,10 +287,33 @@ private:
      */
     double maxInfluenceRadiusSqr;
 
+    /**
+     * Defines the magnetic layers this magnet is on, and the magnetic layers it is influenced by.
+     * Both default to the first layer, so every magnet influences every other until configured otherwise.
+     */
+    uint32_t magneticLayer = MAGNET_DEFAULT_LAYERS;
+    uint32_t magneticMask = MAGNET_DEFAULT_LAYERS;
+
+    /**
+     * Defines whether this magnet is baked into the MagneticWorld's static field grid.
+     */
+    bool bakedStatic = false;
+
+    /**
+     * Defines whether this magnet is solved within the current tick while the MagneticWorld pipelines its solve.
+     */
+    bool synchronousSolve = false;
+
     /**
      * Collection containing references to all the magnets in the scene.
+     * Registration and unregistration are O(1); see MagnetRegistry.
+     */
+    static MagnetRegistry<MagneticBody3D> sceneMagnetsRegistry;
+
+    /**
+     * This magnet's handle in sceneMagnetsRegistry; unset while the magnet is not registered.
      */
-    static std::vector<MagneticBody3D*> sceneMagnetsRegistry;
+    MagnetHandle registryHandle;
 
 
     // --- Private setters ---
@@ -194,7 +335,7 @@ private:
     // --- Magnet registry methods ---
 
     /**
-     * Adds the specified magnet to the scene registry (sceneMagnetsRegistry).
+     * Adds the specified magnet to the scene registry (sceneMagnetsRegistry), unless it is already registered.
      * 
      * @param magnet The magnet to add to the registry.
      */
@@ -0,0 +1,119 @@
+#include "magneticbodypool.h"
+
+using namespace godot;
+
+// --- Pool management ---
+
+void MagneticBodyPool::fill(Node* parent, const Ref<PackedScene>& scene, int count) {
+    ERR_FAIL_NULL(parent);
+    ERR_FAIL_COND_MSG(scene.is_null(), "No projectile scene set.");
+
+    slots.reserve(slots.size() + count);
+    for (int i = 0; i < count; i++) {
+        Node* instance = scene->instantiate();
+        MagneticBody3D* body = Object::cast_to<MagneticBody3D>(instance);
+        if (body == nullptr) {
+            if (instance != nullptr) {
+                memdelete(instance);
+            }
+            ERR_FAIL_MSG("Failed to instantiate projectile or invalid type.");
+        }
+
+        // Adding the projectile readies and registers it, once for the lifetime of the pool.
+        body->set_as_top_level(true);
+        parent->add_child(body);
+        park(body);
+
+        Slot slot;
+        slot.body = ObjectID(body->get_instance_id());
+        slots.push_back(slot);
+    }
+}
+
+MagneticBody3D* MagneticBodyPool::acquire(const Transform3D& transform, double lifetime) {
+    // Take a free projectile, or recycle the oldest one in use.
+    Slot* chosen = nullptr;
+    for (Slot& slot : slots) {
+        if (get_body(slot) == nullptr) continue;
+        if (!slot.active) {
+            chosen = &slot;
+            break;
+        }
+        if (chosen == nullptr || slot.acquiredAt < chosen->acquiredAt) {
+            chosen = &slot;
+        }
+    }
+    if (chosen == nullptr) return nullptr;
+
+    MagneticBody3D* body = get_body(*chosen);
+    chosen->active = true;
+    chosen->lifetimeRemaining = lifetime;
+    chosen->acquiredAt = acquireCount++;
+
+    // The projectile starts frozen, so it can settle before it is fired.
+    body->set_process_mode(Node::PROCESS_MODE_INHERIT);
+    body->set_freeze_enabled(true);
+    body->set_global_transform(transform);
+    body->set_linear_velocity(Vector3());
+    body->set_angular_velocity(Vector3());
+    body->reset_magnet_state();
+    body->set_visible(true);
+    return body;
+}
+
+void MagneticBodyPool::release(MagneticBody3D* body) {
+    if (body == nullptr) return;
+
+    const ObjectID id(body->get_instance_id());
+    for (Slot& slot : slots) {
+        if (slot.body == id && slot.active) {
+            slot.active = false;
+            park(body);
+            return;
+        }
+    }
+}
+
+void MagneticBodyPool::update(double delta) {
+    for (Slot& slot : slots) {
+        if (!slot.active || slot.lifetimeRemaining <= 0.0) continue;
+
+        slot.lifetimeRemaining -= delta;
+        if (slot.lifetimeRemaining <= 0.0) {
+            slot.active = false;
+            MagneticBody3D* body = get_body(slot);
+            if (body != nullptr) {
+                park(body);
+            }
+        }
+    }
+}
+
+int MagneticBodyPool::get_size() const {
+    return (int)slots.size();
+}
+
+int MagneticBodyPool::get_available() const {
+    int available = 0;
+    for (const Slot& slot : slots) {
+        available += !slot.active && get_body(slot) != nullptr ? 1 : 0;
+    }
+    return available;
+}
+
+
+// --- Private helpers ---
+
+MagneticBody3D* MagneticBodyPool::get_body(const Slot& slot) {
+    return Object::cast_to<MagneticBody3D>(ObjectDB::get_instance(slot.body));
+}
+
+void MagneticBodyPool::park(MagneticBody3D* body) {
+    // Magnets that are off are skipped by the solver; the body keeps its registry slot and physics body.
+    body->set_on(false);
+    body->set_freeze_enabled(true);
+    body->set_linear_velocity(Vector3());
+    body->set_angular_velocity(Vector3());
+    body->set_visible(false);
+    body->set_process_mode(Node::PROCESS_MODE_DISABLED);
+}
@@ -0,0 +1,123 @@
+#ifndef MAGNETIC_BODY_POOL_H
+#define MAGNETIC_BODY_POOL_H
+
+#include <godot_cpp/classes/node.hpp>
+#include <godot_cpp/classes/packed_scene.hpp>
+#include <godot_cpp/core/object_id.hpp>
+#include <godot_cpp/variant/transform3d.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "magneticbody3d.h"
+
+using namespace godot;
+
+/**
+ * Fixed-size pool of pre-instantiated MagneticBody3D projectiles.
+ * Every projectile is instanced, added to the tree and registered once, when the pool is filled. Afterwards, acquiring
+ * and releasing a projectile only resets its transform, velocities, on-state and magnetization and parks or unparks
+ * it, so sustained fire allocates no nodes, creates no physics bodies, and never changes the magnets registry.
+ * Parked projectiles are off, so the solver skips them, and disabled, so they take no part in the physics simulation.
+ */
+class MagneticBodyPool {
+public:
+
+    // --- Constructor ---
+
+    /** Default constructor */
+    MagneticBodyPool() = default;
+
+
+    // --- Pool management ---
+
+    /**
+     * Instances the projectiles and adds them under a parent node, parked.
+     * The projectiles are top-level, so they move independently of the parent.
+     *
+     * @param parent The node the projectiles are added under; must be inside the scene tree.
+     * @param scene The projectile scene. Its root must be a MagneticBody3D.
+     * @param count The number of projectiles.
+     */
+    void fill(Node* parent, const Ref<PackedScene>& scene, int count);
+
+    /**
+     * Takes a projectile out of the pool and places it, frozen and with its magnetism reset.
+     * When every projectile is in use, the one acquired longest ago is recycled.
+     *
+     * @param transform The global transform of the projectile.
+     * @param lifetime Time in seconds after which the projectile is released automatically; 0 keeps it until recycled.
+     * @return The projectile, or nullptr if the pool is empty.
+     */
+    MagneticBody3D* acquire(const Transform3D& transform, double lifetime);
+
+    /**
+     * Returns a projectile to the pool and parks it. Does nothing if it is not an active projectile of this pool.
+     *
+     * @param body The projectile.
+     */
+    void release(MagneticBody3D* body);
+
+    /**
+     * Advances the lifetimes of the active projectiles and releases the expired ones.
+     *
+     * @param delta Time elapsed since the last update, in seconds.
+     */
+    void update(double delta);
+
+    /**
+     * Gets the number of projectiles in the pool.
+     */
+    int get_size() const;
+
+    /**
+     * Gets the number of projectiles not currently in use.
+     */
+    int get_available() const;
+
+private:
+
+    /**
+     * A pooled projectile.
+     */
+    struct Slot {
+        /** The projectile; held by ID, so a projectile freed by other code is detected instead of dereferenced. */
+        ObjectID body;
+
+        /** Whether the projectile is in use. */
+        bool active = false;
+
+        /** Time left before the projectile is released automatically; 0 means never. */
+        double lifetimeRemaining = 0.0;
+
+        /** Value of acquireCount when the projectile was acquired, to find the oldest one. */
+        uint64_t acquiredAt = 0;
+    };
+
+
+    // --- Private fields ---
+
+    std::vector<Slot> slots;
+
+    /**
+     * Number of acquisitions so far.
+     */
+    uint64_t acquireCount = 0;
+
+
+    // --- Private helpers ---
+
+    /**
+     * Gets the projectile of a slot.
+     *
+     * @return The projectile, or nullptr if it was freed.
+     */
+    static MagneticBody3D* get_body(const Slot& slot);
+
+    /**
+     * Switches a projectile off, freezes and hides it, and takes it out of the physics simulation.
+     */
+    static void park(MagneticBody3D* body);
+};
+
+
+#endif // MAGNETIC_BODY_POOL_H
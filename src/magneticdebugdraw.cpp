@@ -1,6 +1,9 @@
 #include "magneticdebugdraw.h"
+#include "magneticworld.h"
 #include <godot_cpp/variant/utility_functions.hpp>
 #include <godot_cpp/variant/color.hpp>
+#include <godot_cpp/variant/vector2.hpp>
+#include <array>
 
 MagneticDebugDraw::MagneticDebugDraw() {
     // Initialize meshes and materials
@@ -14,7 +17,30 @@ MagneticDebugDraw::MagneticDebugDraw() {
 }
 
 void MagneticDebugDraw::_bind_methods() {
-    // No properties to bind for now
+    ClassDB::bind_method(D_METHOD("set_visible_layers", "layers"), &MagneticDebugDraw::set_visible_layers);
+    ClassDB::bind_method(D_METHOD("get_visible_layers"), &MagneticDebugDraw::get_visible_layers);
+
+    ClassDB::bind_method(D_METHOD("set_color_by_layer", "enabled"), &MagneticDebugDraw::set_color_by_layer);
+    ClassDB::bind_method(D_METHOD("get_color_by_layer"), &MagneticDebugDraw::get_color_by_layer);
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "visible_layers", PROPERTY_HINT_LAYERS_3D_PHYSICS), "set_visible_layers", "get_visible_layers");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "color_by_layer"), "set_color_by_layer", "get_color_by_layer");
+}
+
+uint32_t MagneticDebugDraw::get_visible_layers() const {
+    return visibleLayers;
+}
+
+void MagneticDebugDraw::set_visible_layers(uint32_t layers) {
+    visibleLayers = layers;
+}
+
+bool MagneticDebugDraw::get_color_by_layer() const {
+    return colorByLayer;
+}
+
+void MagneticDebugDraw::set_color_by_layer(bool enabled) {
+    colorByLayer = enabled;
 }
 
 void MagneticDebugDraw::_ready() {
@@ -39,7 +65,6 @@ void MagneticDebugDraw::draw_force_vector(const Vector3& start, const Vector3& f
     Vector3 end = start + force * scale;
     
     // Draw line for force vector
-    forceMesh->surface_begin(Mesh::PRIMITIVE_LINES);
     forceMesh->surface_set_color(color);
     forceMesh->surface_add_vertex(start);
     forceMesh->surface_add_vertex(end);
@@ -68,94 +93,133 @@ void MagneticDebugDraw::draw_force_vector(const Vector3& start, const Vector3& f
     forceMesh->surface_add_vertex(arrow_point3);
     forceMesh->surface_add_vertex(end);
     forceMesh->surface_add_vertex(arrow_point4);
-    
-    forceMesh->surface_end();
 }
 
 void MagneticDebugDraw::draw_influence_sphere(const Vector3& center, float radius, const Color& color) {
-    const int segments = 32;
-    const float step = Math_PI * 2.0f / segments;
-    
-    // Draw three circles for XY, XZ, and YZ planes
-    influenceMesh->surface_begin(Mesh::PRIMITIVE_LINE_STRIP);
-    influenceMesh->surface_set_color(color);
-    
-    // XY plane circle
-    for (int i = 0; i <= segments; i++) {
-        float angle = i * step;
-        Vector3 point(
-            radius * Math::cos(angle) + center.x,
-            radius * Math::sin(angle) + center.y,
-            center.z
-        );
-        influenceMesh->surface_add_vertex(point);
-    }
+    static constexpr int segments = 32;
     
-    // XZ plane circle
-    for (int i = 0; i <= segments; i++) {
-        float angle = i * step;
-        Vector3 point(
-            radius * Math::cos(angle) + center.x,
-            center.y,
-            radius * Math::sin(angle) + center.z
-        );
-        influenceMesh->surface_add_vertex(point);
-    }
+    // Unit circle, computed once and shared by every sphere.
+    static const std::array<Vector2, segments + 1> circle = []() {
+        std::array<Vector2, segments + 1> points;
+        const float step = Math_PI * 2.0f / segments;
+        for (int i = 0; i <= segments; i++) {
+            points[i] = Vector2(Math::cos(i * step), Math::sin(i * step));
+        }
+        return points;
+    }();
     
-    // YZ plane circle
-    for (int i = 0; i <= segments; i++) {
-        float angle = i * step;
-        Vector3 point(
-            center.x,
-            radius * Math::cos(angle) + center.y,
-            radius * Math::sin(angle) + center.z
-        );
-        influenceMesh->surface_add_vertex(point);
+    // Draw three circles for XY, XZ, and YZ planes, as separate line segments so they share one surface.
+    influenceMesh->surface_set_color(color);
+    for (int i = 0; i < segments; i++) {
+        const Vector2 a = circle[i] * radius;
+        const Vector2 b = circle[i + 1] * radius;
+        
+        // XY plane circle
+        influenceMesh->surface_add_vertex(center + Vector3(a.x, a.y, 0));
+        influenceMesh->surface_add_vertex(center + Vector3(b.x, b.y, 0));
+        
+        // XZ plane circle
+        influenceMesh->surface_add_vertex(center + Vector3(a.x, 0, a.y));
+        influenceMesh->surface_add_vertex(center + Vector3(b.x, 0, b.y));
+        
+        // YZ plane circle
+        influenceMesh->surface_add_vertex(center + Vector3(0, a.x, a.y));
+        influenceMesh->surface_add_vertex(center + Vector3(0, b.x, b.y));
     }
-    
-    influenceMesh->surface_end();
+}
+
+Color MagneticDebugDraw::layer_color(uint32_t layer) {
+    // Only called for magnets on at least one visible layer, so a bit is always set.
+    // Step the hue by the golden ratio per layer index, so neighbouring layers get clearly different colors.
+    int index = 0;
+    while (!(layer & (1u << index))) index++;
+    return Color::from_hsv(Math::fmod(index * 0.618034f, 1.0f), 0.8f, 1.0f, 0.2f);
 }
 
 void MagneticDebugDraw::update_debug_visuals() {
+#ifdef MAGNET_PROFILING
+    MagnetProfileTimer rebuildTimer;
+#endif
+
     // Clear previous frame's debug drawings
     forceMesh->clear_surfaces();
     influenceMesh->clear_surfaces();
     
-    // Get all magnetic bodies in the scene
-    const std::vector<MagneticBody3D*>& magnets = MagneticBody3D::get_magnets_registry();
+    // Draw the state and results cached by the last physics step, rather than re-evaluating every pair here.
+    // Only the snapshot is read, so magnets freed since that step are never touched. While the world is pipelined it
+    // is a copy of the last applied results, so drawing never waits for the solve in flight.
+    const MagneticWorld* world = MagneticWorld::get_singleton();
+    if (world == nullptr) return;
+    const MagnetSnapshot& snapshot = world->get_snapshot();
     
-    for (const auto& magnet : magnets) {
-        if (!magnet->get_on()) continue;
-        
-        Vector3 magnet_pos = magnet->get_global_position();
-        float influence_radius = Math::sqrt(magnet->get_max_influence_radius_sqr());
-        
-        // Draw influence sphere
-        Color sphere_color;
-        switch (magnet->get_magnet_type()) {
-            case MagneticBody3D::Permanent:
-                sphere_color = Color(0, 0, 1, 0.2f); // Blue
-                break;
-            case MagneticBody3D::Temporary:
-                sphere_color = Color(0, 1, 0, 0.2f); // Green
-                break;
-            case MagneticBody3D::Electromagnet:
-                sphere_color = Color(1, 0, 0, 0.2f); // Red
-                break;
+    // Magnets represented by the baked static field are not in the snapshot, so their spheres are drawn from the
+    // registry instead. They are not solved, so they have no force vector.
+    bakedMagnets.clear();
+    if (world->is_static_field_active()) {
+        for (const MagneticBody3D* magnet : MagneticBody3D::get_magnets_registry()) {
+            if (magnet->is_baked_source() && (magnet->get_magnetic_layer() & visibleLayers)) bakedMagnets.push_back(magnet);
         }
-        draw_influence_sphere(magnet_pos, influence_radius, sphere_color);
-        
-        // Draw force vectors between this magnet and others
-        for (const auto& other : magnets) {
-            if (other == magnet) continue;
-            if (!other->get_on()) continue;
+    }
+    
+    size_t onCount = bakedMagnets.size();
+    size_t influencedCount = 0;
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        if (!snapshot.on[i] || !(snapshot.layer[i] & visibleLayers)) continue;
+        onCount++;
+        influencedCount += snapshot.influenced[i] ? 1 : 0;
+    }
+    
+    // All spheres share one surface, and all force vectors share another.
+    if (onCount > 0) {
+        influenceMesh->surface_begin(Mesh::PRIMITIVE_LINES);
+        for (size_t i = 0; i < snapshot.size(); i++) {
+            if (!snapshot.on[i] || !(snapshot.layer[i] & visibleLayers)) continue;
             
-            if (magnet->will_be_influenced_by(*other)) {
-                Vector3 force = magnet->calculate_force_from_magnet(*other);
-                draw_force_vector(magnet_pos, force, Color(1, 1, 0, 0.8f)); // Yellow
+            // Draw influence sphere
+            Color sphere_color;
+            if (colorByLayer) {
+                sphere_color = layer_color(snapshot.layer[i]);
+            } else {
+                switch (snapshot.type[i]) {
+                    case MAGNET_PERMANENT:
+                        sphere_color = Color(0, 0, 1, 0.2f); // Blue
+                        break;
+                    case MAGNET_TEMPORARY:
+                        sphere_color = Color(0, 1, 0, 0.2f); // Green
+                        break;
+                    case MAGNET_ELECTROMAGNET:
+                        sphere_color = Color(1, 0, 0, 0.2f); // Red
+                        break;
+                }
             }
+            const Vector3 magnet_pos(snapshot.posX[i], snapshot.posY[i], snapshot.posZ[i]);
+            draw_influence_sphere(magnet_pos, Math::sqrt(world->get_reach_sqr(i)), sphere_color);
         }
+        for (const MagneticBody3D* magnet : bakedMagnets) {
+            const Color sphere_color = colorByLayer ? layer_color(magnet->get_magnetic_layer()) : Color(0, 0, 1, 0.2f); // Blue
+            const double radius = Math::sqrt(magnet_influence_radius_sqr(magnet->get_strength()));
+            draw_influence_sphere(magnet->get_global_transform().origin, radius, sphere_color);
+        }
+        influenceMesh->surface_end();
     }
+    
+    if (influencedCount > 0) {
+        forceMesh->surface_begin(Mesh::PRIMITIVE_LINES);
+        for (size_t i = 0; i < snapshot.size(); i++) {
+            if (!snapshot.on[i] || !snapshot.influenced[i] || !(snapshot.layer[i] & visibleLayers)) continue;
+            
+            // Draw the net force the solver applied to this magnet
+            const Vector3 magnet_pos(snapshot.posX[i], snapshot.posY[i], snapshot.posZ[i]);
+            const Vector3 force(snapshot.forceX[i], snapshot.forceY[i], snapshot.forceZ[i]);
+            draw_force_vector(magnet_pos, force, Color(1, 1, 0, 0.8f)); // Yellow
+        }
+        forceMesh->surface_end();
+    }
+
+#ifdef MAGNET_PROFILING
+    // Report the rebuild time alongside the solver's profile.
+    MagneticWorld::get_singleton()->get_profile().debugDrawMsec = rebuildTimer.elapsed_msec();
+#endif
 }
 
 void MagneticDebugDraw::_process(double delta) {
@@ -5,6 +5,7 @@
 #include <godot_cpp/classes/immediate_mesh.hpp>
 #include <godot_cpp/classes/mesh_instance3d.hpp>
 #include <godot_cpp/classes/standard_material3d.hpp>
+#include <vector>
 #include "magneticbody3d.h"
 
 class MagneticDebugDraw : public Node3D {
@@ -17,10 +18,24 @@ public:
     void _ready() override;
     void _process(double delta) override;
 
+    // Only magnets on one of these magnetic layers are drawn
+    uint32_t get_visible_layers() const;
+    void set_visible_layers(uint32_t layers);
+
+    // Colors influence spheres by magnetic layer instead of by magnet type
+    bool get_color_by_layer() const;
+    void set_color_by_layer(bool enabled);
+
 protected:
     static void _bind_methods();
 
 private:
+    uint32_t visibleLayers = MAGNET_ALL_LAYERS;
+    bool colorByLayer = false;
+
+    // Scratch list of the visible magnets represented by the baked static field
+    std::vector<const MagneticBody3D*> bakedMagnets;
+
     // Drawing helpers
     ImmediateMesh* forceMesh;
     MeshInstance3D* forceMeshInstance;
@@ -30,8 +45,14 @@ private:
     MeshInstance3D* influenceMeshInstance;
     StandardMaterial3D* influenceMaterial;
 
+    // Append to the surface currently open on forceMesh / influenceMesh
     void draw_force_vector(const Vector3& start, const Vector3& force, const Color& color);
     void draw_influence_sphere(const Vector3& center, float radius, const Color& color);
+
+    // Distinct color per lowest magnetic layer of a layer bitmask
+    static Color layer_color(uint32_t layer);
+
+    // Rebuilds both meshes from the results cached by the last MagneticWorld step
     void update_debug_visuals();
 };
 
@@ -0,0 +1,94 @@
+#include "magneticfieldgrid.h"
+
+using namespace godot;
+
+// --- Class initialization ---
+
+MagneticFieldGrid::MagneticFieldGrid() {
+    configure(AABB(Vector3(-10, -10, -10), Vector3(20, 20, 20)), Vector3i(32, 32, 32));
+}
+
+
+// --- Godot bindings ---
+
+void MagneticFieldGrid::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("set_bounds", "bounds"), &MagneticFieldGrid::set_bounds);
+    ClassDB::bind_method(D_METHOD("get_bounds"), &MagneticFieldGrid::get_bounds);
+
+    ClassDB::bind_method(D_METHOD("set_resolution", "resolution"), &MagneticFieldGrid::set_resolution);
+    ClassDB::bind_method(D_METHOD("get_resolution"), &MagneticFieldGrid::get_resolution);
+
+    ClassDB::bind_method(D_METHOD("set_data", "data"), &MagneticFieldGrid::set_data);
+    ClassDB::bind_method(D_METHOD("get_data"), &MagneticFieldGrid::get_data);
+
+    ClassDB::bind_method(D_METHOD("is_baked"), &MagneticFieldGrid::is_baked);
+
+    // Bounds and resolution come first, so loading restores the layout before the data it must match.
+    ADD_PROPERTY(PropertyInfo(Variant::AABB, "bounds"), "set_bounds", "get_bounds");
+    ADD_PROPERTY(PropertyInfo(Variant::VECTOR3I, "resolution"), "set_resolution", "get_resolution");
+    ADD_PROPERTY(PropertyInfo(Variant::PACKED_FLOAT32_ARRAY, "data", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_STORAGE), "set_data", "get_data");
+}
+
+
+// --- Getters and setters ---
+
+// Bounds
+AABB MagneticFieldGrid::get_bounds() const {
+    const MagnetVector& boundsMin = grid.get_bounds_min();
+    const MagnetVector& boundsMax = grid.get_bounds_max();
+    return AABB(Vector3(boundsMin.x, boundsMin.y, boundsMin.z), Vector3(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z));
+}
+void MagneticFieldGrid::set_bounds(const AABB& newBounds) {
+    ERR_FAIL_COND_MSG(newBounds.size.x <= 0.0 || newBounds.size.y <= 0.0 || newBounds.size.z <= 0.0, "Field grid bounds must have a positive size on every axis.");
+    configure(newBounds, get_resolution());
+}
+
+// Resolution
+Vector3i MagneticFieldGrid::get_resolution() const {
+    return Vector3i(grid.get_nodes_x(), grid.get_nodes_y(), grid.get_nodes_z());
+}
+void MagneticFieldGrid::set_resolution(const Vector3i& newResolution) {
+    ERR_FAIL_COND_MSG(newResolution.x < 2 || newResolution.y < 2 || newResolution.z < 2, "Field grid resolution must be at least 2 on every axis.");
+    configure(get_bounds(), newResolution);
+}
+
+// Data
+PackedFloat32Array MagneticFieldGrid::get_data() const {
+    const std::vector<float>& values = grid.get_data();
+    PackedFloat32Array data;
+    data.resize(values.size());
+    if (!values.empty()) {
+        memcpy(data.ptrw(), values.data(), values.size() * sizeof(float));
+    }
+    return data;
+}
+void MagneticFieldGrid::set_data(const PackedFloat32Array& newData) {
+    const std::vector<float> values(newData.ptr(), newData.ptr() + newData.size());
+    ERR_FAIL_COND_MSG(!values.empty() && !grid.set_data(values), "Field grid data does not match its resolution; re-bake the static field.");
+    if (values.empty()) {
+        grid.set_data(values);
+    }
+    emit_changed();
+}
+
+bool MagneticFieldGrid::is_baked() const {
+    return grid.is_baked();
+}
+
+MagnetFieldGrid& MagneticFieldGrid::get_grid() {
+    return grid;
+}
+
+const MagnetFieldGrid& MagneticFieldGrid::get_grid() const {
+    return grid;
+}
+
+
+// --- Private helpers ---
+
+void MagneticFieldGrid::configure(const AABB& bounds, const Vector3i& resolution) {
+    const Vector3 end = bounds.position + bounds.size;
+    grid.configure(MagnetVector{ bounds.position.x, bounds.position.y, bounds.position.z }, MagnetVector{ end.x, end.y, end.z },
+        (uint32_t)resolution.x, (uint32_t)resolution.y, (uint32_t)resolution.z);
+    emit_changed();
+}
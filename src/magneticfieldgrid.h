@@ -0,0 +1,114 @@
+#ifndef MAGNETIC_FIELD_GRID_H
+#define MAGNETIC_FIELD_GRID_H
+
+#include <godot_cpp/classes/resource.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/aabb.hpp>
+#include <godot_cpp/variant/packed_float32_array.hpp>
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include "core/magnetfieldgrid.h"
+
+using namespace godot;
+
+/**
+ * Resource holding the baked field of the static magnets of a scene.
+ * Magnets flagged as baked_static are sampled into a regular 3D grid by MagneticWorld::bake_static_field.
+ * At runtime, every other magnet inside the grid gets one trilinear lookup instead of one pair evaluation per static
+ * magnet. The baked data is saved with the resource, so it can live alongside the scene.
+ */
+class MagneticFieldGrid : public Resource {
+    GDCLASS(MagneticFieldGrid, Resource)
+
+public:
+
+    // --- Constructor ---
+
+    /** Default constructor; covers a 20 unit cube around the origin with 32 nodes per axis. */
+    MagneticFieldGrid();
+
+
+    // --- Public getters and setters ---
+
+    /**
+     * Gets the region covered by the grid.
+     *
+     * @return The grid bounds.
+     */
+    AABB get_bounds() const;
+
+    /**
+     * Sets the region covered by the grid. Discards the baked data.
+     * Dynamic magnets outside the bounds receive no force from the static magnets.
+     *
+     * @param newBounds The new grid bounds. Must have a positive size on every axis.
+     */
+    void set_bounds(const AABB& newBounds);
+
+    /**
+     * Gets the number of grid nodes along each axis.
+     *
+     * @return The grid resolution.
+     */
+    Vector3i get_resolution() const;
+
+    /**
+     * Sets the number of grid nodes along each axis. Discards the baked data.
+     * Finer grids are more accurate close to the static magnets, at the cost of memory and baking time.
+     *
+     * @param newResolution The new grid resolution. Every component must be at least 2.
+     */
+    void set_resolution(const Vector3i& newResolution);
+
+    /**
+     * Gets the baked node values, for saving.
+     *
+     * @return The node values.
+     */
+    PackedFloat32Array get_data() const;
+
+    /**
+     * Sets the baked node values, when loading.
+     *
+     * @param newData The node values. Ignored if they do not match the resolution.
+     */
+    void set_data(const PackedFloat32Array& newData);
+
+    /**
+     * Determines if the grid holds baked data.
+     *
+     * @return True if the grid is baked, false if not.
+     */
+    bool is_baked() const;
+
+    /**
+     * Gets the engine-independent grid, for baking and sampling.
+     *
+     * @return The grid.
+     */
+    MagnetFieldGrid& get_grid();
+    const MagnetFieldGrid& get_grid() const;
+
+protected:
+    /**
+     * Binds methods and registers properties for the editor.
+     */
+    static void _bind_methods();
+
+private:
+
+    // --- Private fields ---
+
+    /**
+     * The grid layout and baked data.
+     */
+    MagnetFieldGrid grid;
+
+    /**
+     * Re-applies the bounds and resolution to the grid.
+     */
+    void configure(const AABB& bounds, const Vector3i& resolution);
+};
+
+
+#endif // MAGNETIC_FIELD_GRID_H
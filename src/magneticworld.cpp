@@ -0,0 +1,847 @@
+#include "magneticworld.h"
+#include <godot_cpp/classes/engine.hpp>
+#include <godot_cpp/classes/physics_server3d.hpp>
+#include <godot_cpp/classes/project_settings.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
+#ifdef MAGNET_PROFILING
+#include <godot_cpp/classes/performance.hpp>
+#endif
+
+using namespace godot;
+
+// --- Class initialization and destruction ---
+
+// Initialize static singleton
+MagneticWorld* MagneticWorld::singleton = nullptr;
+
+MagneticWorld::MagneticWorld() {
+    if (singleton == nullptr) {
+        singleton = this;
+    }
+
+    // The synchronous magnets and their neighbours change every tick, so nothing could be reused.
+    synchronousSolver.set_incremental(false);
+}
+
+MagneticWorld::~MagneticWorld() {
+    wait_for_solve();
+    recorder.close();
+    if (singleton == this) {
+        singleton = nullptr;
+    }
+}
+
+
+// --- Godot bindings ---
+
+void MagneticWorld::_bind_methods() {
+    // Solver mode enum
+    BIND_ENUM_CONSTANT(Pairwise);
+    BIND_ENUM_CONSTANT(Octree);
+
+    // Kernel precision enum
+    BIND_ENUM_CONSTANT(Double);
+    BIND_ENUM_CONSTANT(Float);
+
+    ClassDB::bind_method(D_METHOD("step", "delta"), &MagneticWorld::step);
+    ClassDB::bind_method(D_METHOD("get_stats"), &MagneticWorld::get_stats);
+
+    ClassDB::bind_method(D_METHOD("set_broadphase_cell_size", "cell_size"), &MagneticWorld::set_broadphase_cell_size);
+    ClassDB::bind_method(D_METHOD("get_broadphase_cell_size"), &MagneticWorld::get_broadphase_cell_size);
+
+    ClassDB::bind_method(D_METHOD("set_neighbor_skin", "skin"), &MagneticWorld::set_neighbor_skin);
+    ClassDB::bind_method(D_METHOD("get_neighbor_skin"), &MagneticWorld::get_neighbor_skin);
+
+    ClassDB::bind_method(D_METHOD("set_min_pair_force", "force"), &MagneticWorld::set_min_pair_force);
+    ClassDB::bind_method(D_METHOD("get_min_pair_force"), &MagneticWorld::get_min_pair_force);
+
+    ClassDB::bind_method(D_METHOD("set_cutoff_falloff", "falloff"), &MagneticWorld::set_cutoff_falloff);
+    ClassDB::bind_method(D_METHOD("get_cutoff_falloff"), &MagneticWorld::get_cutoff_falloff);
+
+    ClassDB::bind_method(D_METHOD("set_lod_tiers", "tiers"), &MagneticWorld::set_lod_tiers);
+    ClassDB::bind_method(D_METHOD("get_lod_tiers"), &MagneticWorld::get_lod_tiers);
+
+    ClassDB::bind_method(D_METHOD("set_lod_budget", "budget"), &MagneticWorld::set_lod_budget);
+    ClassDB::bind_method(D_METHOD("get_lod_budget"), &MagneticWorld::get_lod_budget);
+
+    ClassDB::bind_method(D_METHOD("set_solver_mode", "mode"), &MagneticWorld::set_solver_mode);
+    ClassDB::bind_method(D_METHOD("get_solver_mode"), &MagneticWorld::get_solver_mode);
+
+    ClassDB::bind_method(D_METHOD("set_kernel_precision", "precision"), &MagneticWorld::set_kernel_precision);
+    ClassDB::bind_method(D_METHOD("get_kernel_precision"), &MagneticWorld::get_kernel_precision);
+
+    ClassDB::bind_method(D_METHOD("set_octree_opening_angle", "angle"), &MagneticWorld::set_octree_opening_angle);
+    ClassDB::bind_method(D_METHOD("get_octree_opening_angle"), &MagneticWorld::get_octree_opening_angle);
+
+    ClassDB::bind_method(D_METHOD("set_thread_count", "count"), &MagneticWorld::set_thread_count);
+    ClassDB::bind_method(D_METHOD("get_thread_count"), &MagneticWorld::get_thread_count);
+
+    ClassDB::bind_method(D_METHOD("set_substep_distance", "distance"), &MagneticWorld::set_substep_distance);
+    ClassDB::bind_method(D_METHOD("get_substep_distance"), &MagneticWorld::get_substep_distance);
+
+    ClassDB::bind_method(D_METHOD("set_max_substeps", "count"), &MagneticWorld::set_max_substeps);
+    ClassDB::bind_method(D_METHOD("get_max_substeps"), &MagneticWorld::get_max_substeps);
+
+    ClassDB::bind_method(D_METHOD("set_incremental", "enabled"), &MagneticWorld::set_incremental);
+    ClassDB::bind_method(D_METHOD("get_incremental"), &MagneticWorld::get_incremental);
+
+    ClassDB::bind_method(D_METHOD("set_pipelined", "enabled"), &MagneticWorld::set_pipelined);
+    ClassDB::bind_method(D_METHOD("get_pipelined"), &MagneticWorld::get_pipelined);
+
+    ClassDB::bind_method(D_METHOD("set_static_field", "field"), &MagneticWorld::set_static_field);
+    ClassDB::bind_method(D_METHOD("get_static_field"), &MagneticWorld::get_static_field);
+    ClassDB::bind_method(D_METHOD("bake_static_field"), &MagneticWorld::bake_static_field);
+
+    ClassDB::bind_method(D_METHOD("sample_field", "points", "axis"), &MagneticWorld::sample_field, DEFVAL(Vector3()));
+
+    ClassDB::bind_method(D_METHOD("start_recording", "path"), &MagneticWorld::start_recording);
+    ClassDB::bind_method(D_METHOD("stop_recording"), &MagneticWorld::stop_recording);
+    ClassDB::bind_method(D_METHOD("is_recording"), &MagneticWorld::is_recording);
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "solver_mode", PROPERTY_HINT_ENUM, "Pairwise,Octree"), "set_solver_mode", "get_solver_mode");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "kernel_precision", PROPERTY_HINT_ENUM, "Double,Float"), "set_kernel_precision", "get_kernel_precision");
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "octree_opening_angle", PROPERTY_HINT_RANGE, "0,2,0.01"), "set_octree_opening_angle", "get_octree_opening_angle");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "thread_count", PROPERTY_HINT_RANGE, "0,64,1"), "set_thread_count", "get_thread_count");
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "substep_distance", PROPERTY_HINT_RANGE, "0,10,0.01,or_greater"), "set_substep_distance", "get_substep_distance");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "max_substeps", PROPERTY_HINT_RANGE, "1,256,1"), "set_max_substeps", "get_max_substeps");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "incremental"), "set_incremental", "get_incremental");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "pipelined"), "set_pipelined", "get_pipelined");
+    ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "static_field", PROPERTY_HINT_RESOURCE_TYPE, "MagneticFieldGrid"), "set_static_field", "get_static_field");
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "broadphase_cell_size", PROPERTY_HINT_RANGE, "0.1,1000,0.1,or_greater"), "set_broadphase_cell_size", "get_broadphase_cell_size");
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "neighbor_skin", PROPERTY_HINT_RANGE, "0,10,0.01,or_greater"), "set_neighbor_skin", "get_neighbor_skin");
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "min_pair_force", PROPERTY_HINT_RANGE, "0,10,0.001,or_greater"), "set_min_pair_force", "get_min_pair_force");
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "cutoff_falloff", PROPERTY_HINT_RANGE, "0,1,0.01"), "set_cutoff_falloff", "get_cutoff_falloff");
+    ADD_PROPERTY(PropertyInfo(Variant::PACKED_VECTOR2_ARRAY, "lod_tiers"), "set_lod_tiers", "get_lod_tiers");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "lod_budget", PROPERTY_HINT_RANGE, "0,100000,1,or_greater"), "set_lod_budget", "get_lod_budget");
+}
+
+
+// --- Core solver methods ---
+
+void MagneticWorld::step(double delta) {
+    if (pipelined) {
+        step_pipelined(delta);
+        return;
+    }
+
+#ifdef MAGNET_PROFILING
+    MagnetProfileTimer gatherTimer;
+#endif
+    gather_snapshot();
+#ifdef MAGNET_PROFILING
+    profile.gatherMsec = gatherTimer.elapsed_msec();
+    MagnetProfileTimer solveTimer;
+#endif
+    solver.set_timestep(delta);
+    solver.solve([this](uint32_t taskCount, const MagnetTaskFunction& task) {
+        run_tasks(taskCount, task);
+    });
+#ifdef MAGNET_PROFILING
+    profile.solveMsec = solveTimer.elapsed_msec();
+#endif
+    if (recorder.is_open()) {
+        record_frame();
+    }
+#ifdef MAGNET_PROFILING
+    MagnetProfileTimer applyTimer;
+#endif
+    apply_results();
+#ifdef MAGNET_PROFILING
+    profile.applyMsec = applyTimer.elapsed_msec();
+    solver.fill_profile(profile);
+#endif
+}
+
+void MagneticWorld::step_pipelined(double delta) {
+    // Collect the solve started during the previous tick. Its results were solved from the state gathered then, so
+    // they reach the physics server one tick late.
+#ifdef MAGNET_PROFILING
+    MagnetProfileTimer waitTimer;
+#endif
+    wait_for_solve();
+#ifdef MAGNET_PROFILING
+    profile.waitMsec = waitTimer.elapsed_msec();
+    profile.solveMsec = pipelineSolveMsec;
+    MagnetProfileTimer applyTimer;
+#endif
+    if (pipelineResultsPending && recorder.is_open()) {
+        record_frame();
+    }
+    apply_results();
+    if (pipelineResultsPending) {
+        copy_applied_results();
+    }
+    pipelineResultsPending = false;
+#ifdef MAGNET_PROFILING
+    profile.applyMsec = applyTimer.elapsed_msec();
+    solver.fill_profile(profile);
+    MagnetProfileTimer gatherTimer;
+#endif
+    gather_snapshot();
+    solver.set_timestep(delta);
+#ifdef MAGNET_PROFILING
+    profile.gatherMsec = gatherTimer.elapsed_msec();
+    MagnetProfileTimer synchronousTimer;
+#endif
+    solve_synchronous_magnets();
+#ifdef MAGNET_PROFILING
+    profile.synchronousSolveMsec = synchronousTimer.elapsed_msec();
+#endif
+    start_pipelined_solve();
+}
+
+void MagneticWorld::start_pipelined_solve() {
+    pipelineTask = WorkerThreadPool::get_singleton()->add_native_task(&MagneticWorld::run_pipelined_solve, this, true, "Magnetism pipelined solve");
+    pipelineResultsPending = true;
+}
+
+void MagneticWorld::run_pipelined_solve(void* userdata) {
+    MagneticWorld* world = static_cast<MagneticWorld*>(userdata);
+#ifdef MAGNET_PROFILING
+    MagnetProfileTimer solveTimer;
+#endif
+    // Until wait_for_solve returns, the solver belongs to this task; every accessor touching it waits first.
+    world->solver.solve([world](uint32_t taskCount, const MagnetTaskFunction& task) {
+        world->run_tasks(taskCount, task);
+    });
+#ifdef MAGNET_PROFILING
+    world->pipelineSolveMsec = solveTimer.elapsed_msec();
+#endif
+}
+
+void MagneticWorld::wait_for_solve() const {
+    if (pipelineTask < 0) return;
+    WorkerThreadPool::get_singleton()->wait_for_task_completion(pipelineTask);
+    pipelineTask = -1;
+}
+
+void MagneticWorld::copy_applied_results() {
+    const MagnetSnapshot& snapshot = solver.get_snapshot();
+    appliedSnapshot = snapshot;
+    appliedReachSqr.resize(snapshot.size());
+    const bool octree = solver.get_mode() == MAGNET_SOLVER_OCTREE;
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        appliedReachSqr[i] = octree ? snapshot.radiusSqr[i] : solver.get_broadphase().reach_sqr(snapshot, i);
+    }
+}
+
+void MagneticWorld::solve_synchronous_magnets() {
+    if (synchronousMagnets.empty()) return;
+
+    synchronousSolver.copy_settings(solver);
+    synchronousSolver.solve_subset(solver.get_snapshot(), synchronousMagnets, [this](uint32_t taskCount, const MagnetTaskFunction& task) {
+        run_tasks(taskCount, task);
+    });
+
+    // The synchronous magnets come first in the subset; the results of their neighbours are incomplete.
+    const MagnetSnapshot& results = synchronousSolver.get_snapshot();
+    PhysicsServer3D* physics = PhysicsServer3D::get_singleton();
+    for (size_t k = 0; k < synchronousMagnets.size(); k++) {
+        apply_result(synchronousMagnets[k], results, k, physics);
+    }
+}
+
+void MagneticWorld::_enter_tree() {
+#ifdef MAGNET_PROFILING
+    // Only the active world reports, in case a scene contains more than one.
+    if (singleton == this && !Engine::get_singleton()->is_editor_hint()) {
+        add_monitors();
+    }
+#endif
+}
+
+void MagneticWorld::_exit_tree() {
+    wait_for_solve();
+    pipelineResultsPending = false;
+    stop_recording();
+#ifdef MAGNET_PROFILING
+    remove_monitors();
+#endif
+}
+
+void MagneticWorld::_physics_process(double delta) {
+    // Magnets are not simulated in the editor.
+    if (Engine::get_singleton()->is_editor_hint()) return;
+
+    // Only the active world solves, in case a scene contains more than one.
+    if (singleton != this) return;
+
+    step(delta);
+}
+
+
+// --- Solver phases ---
+
+void MagneticWorld::gather_snapshot() {
+    MagnetSnapshot& snapshot = solver.get_snapshot();
+
+    // While the static field is baked, it stands in for the baked static magnets, so they are left out.
+    // The field is baked from magnets sharing one layer (see bake_static_field), and reaches the magnets masking it.
+    // If their layers no longer match, one grid cannot honour every magnet's mask, so the field is not used.
+    bool useStaticField = staticField.is_valid() && staticField->is_baked();
+    const std::vector<MagneticBody3D*>* magnets = &MagneticBody3D::get_magnets_registry();
+    uint32_t staticLayer = 0;
+    if (useStaticField) {
+        bool layerFound = false;
+        for (const MagneticBody3D* magnet : *magnets) {
+            if (!magnet->is_baked_source()) continue;
+            if (layerFound && magnet->magneticLayer != staticLayer) {
+                WARN_PRINT_ONCE("Baked static magnets are on different magnetic layers; the static field is ignored and they are solved instead.");
+                useStaticField = false;
+                break;
+            }
+            staticLayer = magnet->magneticLayer;
+            layerFound = true;
+        }
+    }
+    if (useStaticField) {
+        dynamicBodies.clear();
+        for (MagneticBody3D* magnet : *magnets) {
+            if (!magnet->is_baked_source()) dynamicBodies.push_back(magnet);
+        }
+        magnets = &dynamicBodies;
+    }
+    solver.set_static_field(useStaticField ? &staticField->get_grid() : nullptr, staticLayer);
+    staticFieldActive = useStaticField;
+
+    // Results can only be carried over while every snapshot index refers to the same magnet as last tick. Registry
+    // handles are compared rather than pointers, since a magnet freed and another allocated at its address would
+    // otherwise look unchanged.
+    bool sameBodies = magnets->size() == bodies.size();
+    for (size_t i = 0; sameBodies && i < bodies.size(); i++) {
+        sameBodies = (*magnets)[i]->get_registry_handle() == bodyHandles[i];
+    }
+    if (!sameBodies) {
+        bodies = *magnets;
+        bodyRids.resize(bodies.size());
+        bodyHandles.resize(bodies.size());
+        for (size_t i = 0; i < bodies.size(); i++) {
+            bodyRids[i] = bodies[i]->get_rid();
+            bodyHandles[i] = bodies[i]->get_registry_handle();
+        }
+        solver.invalidate();
+    }
+    const size_t count = bodies.size();
+    snapshot.resize(count);
+
+    // Velocities and masses are only needed by stiff pair sub-stepping, so they are not read otherwise.
+    const bool substepping = solver.get_substep_distance() > 0.0;
+    synchronousMagnets.clear();
+
+    for (size_t i = 0; i < count; i++) {
+        const MagneticBody3D* magnet = bodies[i];
+        const Transform3D transform = magnet->get_global_transform();
+        const Vector3 axis = transform.basis.get_column(2).normalized();
+
+        snapshot.posX[i] = transform.origin.x;
+        snapshot.posY[i] = transform.origin.y;
+        snapshot.posZ[i] = transform.origin.z;
+        snapshot.axisX[i] = axis.x;
+        snapshot.axisY[i] = axis.y;
+        snapshot.axisZ[i] = axis.z;
+        snapshot.strength[i] = magnet->strength;
+        snapshot.radiusSqr[i] = magnet->maxInfluenceRadiusSqr;
+        snapshot.type[i] = static_cast<uint8_t>(magnet->magnetType);
+        snapshot.on[i] = magnet->on ? 1 : 0;
+        snapshot.magnetized[i] = magnet->magnetized ? 1 : 0;
+        snapshot.layer[i] = magnet->magneticLayer;
+        snapshot.mask[i] = magnet->magneticMask;
+        if (pipelined && magnet->synchronousSolve && magnet->on) {
+            synchronousMagnets.push_back((uint32_t)i);
+        }
+
+        if (substepping) {
+            const Vector3 velocity = magnet->get_linear_velocity();
+            snapshot.velX[i] = velocity.x;
+            snapshot.velY[i] = velocity.y;
+            snapshot.velZ[i] = velocity.z;
+            snapshot.inverseMass[i] = magnet->is_freeze_enabled() ? 0.0 : 1.0 / magnet->get_mass();
+        } else {
+            snapshot.velX[i] = snapshot.velY[i] = snapshot.velZ[i] = 0.0;
+            snapshot.inverseMass[i] = 0.0;
+        }
+    }
+}
+
+void MagneticWorld::record_frame() {
+    // Magnets are identified by instance ID, so recorded sessions can be diffed magnet by magnet.
+    // Pipelined frames are recorded a tick after being gathered, when some magnets may have been freed; those get 0.
+    recordIds.resize(bodies.size());
+    for (size_t i = 0; i < bodies.size(); i++) {
+        recordIds[i] = MagneticBody3D::is_registered(bodyHandles[i]) ? (uint64_t)bodies[i]->get_instance_id() : 0;
+    }
+    const bool useStaticField = solver.get_static_field() != nullptr;
+    recorder.write_frame(solver.get_snapshot(), recordIds.data(), solver, useStaticField ? MAGNET_RECORD_STATIC_FIELD : 0);
+}
+
+PackedVector3Array MagneticWorld::sample_field(const PackedVector3Array& points, const Vector3& axis) {
+    wait_for_solve();
+    const size_t count = points.size();
+    samplePoints.resize(count);
+    sampleResults.resize(count);
+
+    // Read and write the packed arrays through their raw pointers, so no per-point Variant is created.
+    const Vector3* source = points.ptr();
+    for (size_t p = 0; p < count; p++) {
+        samplePoints[p] = MagnetVector{ source[p].x, source[p].y, source[p].z };
+    }
+
+    const bool hasAxis = !axis.is_zero_approx();
+    const Vector3 direction = hasAxis ? axis.normalized() : Vector3();
+    const MagnetVector probeAxis{ direction.x, direction.y, direction.z };
+    solver.sample_field(samplePoints.data(), count, hasAxis ? &probeAxis : nullptr, sampleResults.data(),
+        [this](uint32_t taskCount, const MagnetTaskFunction& task) {
+            run_tasks(taskCount, task);
+        });
+
+    PackedVector3Array results;
+    results.resize(count);
+    Vector3* destination = results.ptrw();
+    for (size_t p = 0; p < count; p++) {
+        destination[p] = Vector3(sampleResults[p].x, sampleResults[p].y, sampleResults[p].z);
+    }
+    return results;
+}
+
+void MagneticWorld::bake_static_field() {
+    ERR_FAIL_COND_MSG(staticField.is_null(), "Assign a MagneticFieldGrid to static_field before baking.");
+    wait_for_solve();
+
+    // One grid applies to every magnet masking its layer, so the baked magnets must share a single layer.
+    MagnetSnapshot sources;
+    uint32_t bakedLayer = 0;
+    for (const MagneticBody3D* magnet : MagneticBody3D::get_magnets_registry()) {
+        if (!magnet->bakedStatic) continue;
+        if (!magnet->is_baked_source()) {
+            WARN_PRINT("Magnet '" + String(magnet->get_name()) + "' is flagged as baked_static but is not a permanent magnet; it was not baked and is still solved.");
+            continue;
+        }
+        ERR_FAIL_COND_MSG(sources.size() > 0 && magnet->magneticLayer != bakedLayer,
+            "Baked static magnets must all be on the same magnetic layer; magnet '" + String(magnet->get_name()) + "' is not. Nothing was baked.");
+        bakedLayer = magnet->magneticLayer;
+
+        const size_t i = sources.size();
+        sources.resize(i + 1);
+        const Transform3D transform = magnet->get_global_transform();
+        const Vector3 axis = transform.basis.get_column(2).normalized();
+        sources.posX[i] = transform.origin.x;
+        sources.posY[i] = transform.origin.y;
+        sources.posZ[i] = transform.origin.z;
+        sources.axisX[i] = axis.x;
+        sources.axisY[i] = axis.y;
+        sources.axisZ[i] = axis.z;
+        sources.strength[i] = magnet->strength;
+        sources.radiusSqr[i] = magnet_influence_radius_sqr(magnet->strength);
+        sources.type[i] = MAGNET_PERMANENT;
+        sources.on[i] = 1;
+        sources.magnetized[i] = 0;
+    }
+
+    staticField->get_grid().bake(sources, [this](uint32_t taskCount, const MagnetTaskFunction& task) {
+        run_tasks(taskCount, task);
+    });
+    staticField->emit_changed();
+    solver.invalidate();
+}
+
+void MagneticWorld::run_tasks(uint32_t taskCount, const MagnetTaskFunction& task) {
+    if (threadCount == 1 || taskCount <= 1) {
+        magnet_run_tasks_serial(taskCount, task);
+        return;
+    }
+
+    // A thread count of 0 lets the pool use all of its worker threads.
+    WorkerThreadPool* pool = WorkerThreadPool::get_singleton();
+    const int64_t group = pool->add_native_group_task(&MagneticWorld::run_task, const_cast<MagnetTaskFunction*>(&task), (int)taskCount, threadCount > 0 ? threadCount : -1, true, "Magnetism solve");
+    pool->wait_for_group_task_completion(group);
+}
+
+void MagneticWorld::run_task(void* userdata, uint32_t taskIndex) {
+    (*static_cast<const MagnetTaskFunction*>(userdata))(taskIndex);
+}
+
+void MagneticWorld::apply_results() {
+    // Magnetization is committed only after all pairs are evaluated, so every pair sees the same
+    // start-of-tick state regardless of registry order.
+    const MagnetSnapshot& snapshot = solver.get_snapshot();
+    PhysicsServer3D* physics = PhysicsServer3D::get_singleton();
+    sleepingSkipped = 0;
+#ifdef MAGNET_PROFILING
+    profile.magnetizedTemporaries = 0;
+    profile.forcedBodies = 0;
+    profile.physicsCalls = 0;
+#endif
+    // A pipelined world only has results once the solve started during the previous tick was collected.
+    const size_t count = pipelined && !pipelineResultsPending ? 0 : bodies.size();
+    for (size_t i = 0; i < count; i++) {
+        if (pipelined) {
+            // Pipelined results were gathered a tick ago: magnets freed since are skipped, and synchronous magnets
+            // receive results of the current tick from solve_synchronous_magnets instead.
+            if (!MagneticBody3D::is_registered(bodyHandles[i]) || bodies[i]->synchronousSolve) continue;
+        }
+        apply_result(i, snapshot, i, physics);
+    }
+}
+
+void MagneticWorld::apply_result(size_t body, const MagnetSnapshot& snapshot, size_t i, PhysicsServer3D* physics) {
+    if (!snapshot.on[i]) return;
+    MagneticBody3D* magnet = bodies[body];
+
+    if (magnet->magnetType == MagneticBody3D::Temporary) {
+        magnet->magnetized = snapshot.influenced[i] != 0;
+#ifdef MAGNET_PROFILING
+        profile.magnetizedTemporaries += magnet->magnetized ? 1 : 0;
+#endif
+    }
+    if (!snapshot.influenced[i]) return;
+
+    // A sleeping magnet whose neighbourhood did not change is resting under the same forces as when it fell
+    // asleep. Applying them again would wake it, so settled piles stay asleep until something nearby changes.
+    if (!snapshot.updated[i] && magnet->is_sleeping()) {
+        sleepingSkipped++;
+        return;
+    }
+
+    // The solver already summed every pair into one net force and torque per magnet. They go straight to the
+    // physics server through the cached RID, skipping the node layer, and zero vectors are not sent at all.
+    const Vector3 force(snapshot.forceX[i], snapshot.forceY[i], snapshot.forceZ[i]);
+    const Vector3 torque(snapshot.torqueX[i], snapshot.torqueY[i], snapshot.torqueZ[i]);
+    if (force != Vector3()) {
+        physics->body_apply_central_force(bodyRids[body], force);
+    }
+    if (torque != Vector3()) {
+        physics->body_apply_torque(bodyRids[body], torque);
+    }
+#ifdef MAGNET_PROFILING
+    profile.forcedBodies++;
+    profile.physicsCalls += (force != Vector3() ? 1 : 0) + (torque != Vector3() ? 1 : 0);
+#endif
+}
+
+
+// --- Getters and setters ---
+
+MagneticWorld* MagneticWorld::get_singleton() {
+    return singleton;
+}
+
+// Broadphase cell size
+double MagneticWorld::get_broadphase_cell_size() const {
+    return solver.get_broadphase().get_cell_size();
+}
+void MagneticWorld::set_broadphase_cell_size(const double newCellSize) {
+    ERR_FAIL_COND_MSG(newCellSize <= 0.0, "Broadphase cell size must be positive.");
+    wait_for_solve();
+    solver.get_broadphase().set_cell_size(newCellSize);
+}
+
+// Broadphase neighbor lists
+double MagneticWorld::get_neighbor_skin() const {
+    return solver.get_broadphase().get_skin();
+}
+void MagneticWorld::set_neighbor_skin(const double newSkin) {
+    ERR_FAIL_COND_MSG(newSkin < 0.0, "Neighbor skin must not be negative.");
+    wait_for_solve();
+    solver.get_broadphase().set_skin(newSkin);
+}
+
+// Pair cutoff
+double MagneticWorld::get_min_pair_force() const {
+    return solver.get_min_force();
+}
+void MagneticWorld::set_min_pair_force(const double newMinForce) {
+    ERR_FAIL_COND_MSG(newMinForce < 0.0, "Minimum pair force must not be negative.");
+    wait_for_solve();
+    solver.set_min_force(newMinForce);
+}
+double MagneticWorld::get_cutoff_falloff() const {
+    return solver.get_cutoff_falloff();
+}
+void MagneticWorld::set_cutoff_falloff(const double newFalloff) {
+    ERR_FAIL_COND_MSG(newFalloff < 0.0 || newFalloff > 1.0, "Cutoff falloff must be between 0 and 1.");
+    wait_for_solve();
+    solver.set_cutoff_falloff(newFalloff);
+}
+
+// Level of detail
+PackedVector2Array MagneticWorld::get_lod_tiers() const {
+    PackedVector2Array tiers;
+    for (const MagnetLodTier& tier : solver.get_lod_tiers()) {
+        tiers.push_back(Vector2(tier.maxForce, tier.interval));
+    }
+    return tiers;
+}
+void MagneticWorld::set_lod_tiers(const PackedVector2Array& newTiers) {
+    std::vector<MagnetLodTier> tiers;
+    for (int64_t k = 0; k < newTiers.size(); k++) {
+        const Vector2 tier = newTiers[k];
+        ERR_FAIL_COND_MSG(tier.x <= 0.0 || tier.y < 2.0, "Each LOD tier needs a positive force and an interval of at least 2 ticks.");
+        tiers.push_back(MagnetLodTier{ tier.x, static_cast<uint32_t>(tier.y) });
+    }
+    wait_for_solve();
+    solver.set_lod_tiers(tiers);
+}
+int MagneticWorld::get_lod_budget() const {
+    return static_cast<int>(solver.get_lod_budget());
+}
+void MagneticWorld::set_lod_budget(const int newBudget) {
+    ERR_FAIL_COND_MSG(newBudget < 0, "LOD budget must not be negative.");
+    wait_for_solve();
+    solver.set_lod_budget(static_cast<uint32_t>(newBudget));
+}
+
+// Solver mode
+MagneticWorld::SolverModes MagneticWorld::get_solver_mode() const {
+    return solver.get_mode() == MAGNET_SOLVER_OCTREE ? Octree : Pairwise;
+}
+void MagneticWorld::set_solver_mode(const SolverModes mode) {
+    wait_for_solve();
+    solver.set_mode(mode == Octree ? MAGNET_SOLVER_OCTREE : MAGNET_SOLVER_PAIRWISE);
+}
+
+// Kernel precision
+MagneticWorld::KernelPrecisions MagneticWorld::get_kernel_precision() const {
+    return solver.get_precision() == MAGNET_PRECISION_FLOAT ? Float : Double;
+}
+void MagneticWorld::set_kernel_precision(const KernelPrecisions precision) {
+    wait_for_solve();
+    solver.set_precision(precision == Float ? MAGNET_PRECISION_FLOAT : MAGNET_PRECISION_DOUBLE);
+}
+
+// Octree opening angle
+double MagneticWorld::get_octree_opening_angle() const {
+    return solver.get_octree().get_opening_angle();
+}
+void MagneticWorld::set_octree_opening_angle(const double newAngle) {
+    ERR_FAIL_COND_MSG(newAngle < 0.0, "Octree opening angle must not be negative.");
+    wait_for_solve();
+    solver.get_octree().set_opening_angle(newAngle);
+    solver.invalidate();
+}
+
+// Thread count
+int MagneticWorld::get_thread_count() const {
+    return threadCount;
+}
+void MagneticWorld::set_thread_count(const int newCount) {
+    ERR_FAIL_COND_MSG(newCount < 0, "Thread count must not be negative.");
+    wait_for_solve();
+    threadCount = newCount;
+}
+
+// Stiff pair sub-stepping
+double MagneticWorld::get_substep_distance() const {
+    return solver.get_substep_distance();
+}
+void MagneticWorld::set_substep_distance(const double newDistance) {
+    ERR_FAIL_COND_MSG(newDistance < 0.0, "Sub-step distance must not be negative.");
+    wait_for_solve();
+    solver.set_substep_distance(newDistance);
+}
+
+int MagneticWorld::get_max_substeps() const {
+    return (int)solver.get_max_substeps();
+}
+void MagneticWorld::set_max_substeps(const int newCount) {
+    ERR_FAIL_COND_MSG(newCount < 1, "Max sub-steps must be at least 1.");
+    wait_for_solve();
+    solver.set_max_substeps((uint32_t)newCount);
+}
+
+// Incremental solving
+bool MagneticWorld::get_incremental() const {
+    return solver.get_incremental();
+}
+void MagneticWorld::set_incremental(const bool enabled) {
+    wait_for_solve();
+    solver.set_incremental(enabled);
+}
+
+// Pipelined solving
+bool MagneticWorld::get_pipelined() const {
+    return pipelined;
+}
+void MagneticWorld::set_pipelined(const bool enabled) {
+    // Results of a solve still in flight are dropped; the next tick solves the current state again.
+    wait_for_solve();
+    pipelineResultsPending = false;
+    pipelined = enabled;
+    if (!pipelined) {
+        appliedSnapshot.resize(0);
+        appliedReachSqr.clear();
+    }
+}
+
+// Static field
+Ref<MagneticFieldGrid> MagneticWorld::get_static_field() const {
+    return staticField;
+}
+void MagneticWorld::set_static_field(const Ref<MagneticFieldGrid>& newField) {
+    wait_for_solve();
+    staticField = newField;
+    solver.invalidate();
+}
+
+// Recording
+bool MagneticWorld::start_recording(const String& path) {
+    const String globalPath = ProjectSettings::get_singleton()->globalize_path(path);
+    const bool opened = recorder.open(globalPath.utf8().get_data());
+    ERR_FAIL_COND_V_MSG(!opened, false, "Could not create the magnet recording \"" + globalPath + "\".");
+    return true;
+}
+void MagneticWorld::stop_recording() {
+    if (!recorder.is_open()) return;
+    const bool written = recorder.close();
+    ERR_FAIL_COND_MSG(!written, "Writing the magnet recording failed; it may be incomplete.");
+}
+bool MagneticWorld::is_recording() const {
+    return recorder.is_open();
+}
+
+// Snapshot
+// Without pipelining no solve is ever in flight here, so the solver is read directly; with it, the copy of the last
+// applied results is, so readers never wait for the background solve.
+const MagnetSnapshot& MagneticWorld::get_snapshot() const {
+    return pipelined ? appliedSnapshot : solver.get_snapshot();
+}
+
+double MagneticWorld::get_reach_sqr(size_t i) const {
+    if (pipelined) return appliedReachSqr[i];
+    const MagnetSnapshot& snapshot = solver.get_snapshot();
+    if (solver.get_mode() == MAGNET_SOLVER_OCTREE) return snapshot.radiusSqr[i];
+    return solver.get_broadphase().reach_sqr(snapshot, i);
+}
+
+bool MagneticWorld::is_static_field_active() const {
+    return staticFieldActive;
+}
+
+// Stats
+Dictionary MagneticWorld::get_stats() const {
+    wait_for_solve();
+    const MagnetBroadphase& broadphase = solver.get_broadphase();
+    const MagnetOctree& octree = solver.get_octree();
+
+    Dictionary stats;
+    stats["magnets"] = (int64_t)solver.get_snapshot().size();
+    stats["tasks"] = (int64_t)solver.get_task_count();
+    stats["updated_magnets"] = (int64_t)solver.get_updated_magnets();
+    stats["evaluated_pairs"] = (int64_t)solver.get_evaluated_pairs();
+    stats["sleeping_skipped"] = (int64_t)sleepingSkipped;
+    stats["substepped_pairs"] = (int64_t)solver.get_substepped_pairs();
+    stats["static_field"] = staticField.is_valid() && staticField->is_baked();
+    stats["pipelined"] = pipelined;
+    if (pipelined) {
+        stats["synchronous_magnets"] = (int64_t)synchronousMagnets.size();
+    }
+    if (recorder.is_open()) {
+        stats["recorded_frames"] = (int64_t)recorder.get_frame_count();
+        stats["recorded_bytes"] = (int64_t)recorder.get_byte_count();
+    }
+    if (solver.get_mode() == MAGNET_SOLVER_OCTREE) {
+        stats["octree_nodes"] = (int64_t)octree.get_node_count();
+        stats["exact_evaluations"] = (int64_t)octree.get_exact_evaluations();
+        stats["far_field_evaluations"] = (int64_t)octree.get_far_field_evaluations();
+        stats["culled_nodes"] = (int64_t)octree.get_culled_nodes();
+    } else {
+        stats["kernel_precision"] = solver.get_precision() == MAGNET_PRECISION_FLOAT ? "float" : "double";
+        stats["total_pairs"] = (int64_t)broadphase.get_total_pairs();
+        stats["candidate_pairs"] = (int64_t)broadphase.get_candidate_pairs();
+        stats["culled_pairs"] = (int64_t)broadphase.get_culled_pairs();
+        stats["occupied_cells"] = (int64_t)broadphase.get_occupied_cells();
+        if (broadphase.get_min_force() > 0.0) {
+            stats["min_pair_force"] = broadphase.get_min_force();
+        }
+        if (!solver.get_lod_tiers().empty()) {
+            stats["lod_cached_pairs"] = (int64_t)solver.get_cached_pairs();
+            stats["lod_deferred_pairs"] = (int64_t)solver.get_deferred_pairs();
+        }
+        if (broadphase.get_skin() > 0.0) {
+            stats["neighbor_list_rebuilt"] = broadphase.was_rebuilt();
+            stats["neighbor_list_rebuilds"] = (int64_t)broadphase.get_rebuild_count();
+            stats["neighbor_list_age"] = (int64_t)broadphase.get_list_age();
+            stats["neighbor_pairs"] = (int64_t)broadphase.get_neighbor_pairs();
+        }
+    }
+#ifdef MAGNET_PROFILING
+    stats["considered_pairs"] = (int64_t)profile.consideredPairs;
+    stats["applied_pairs"] = (int64_t)profile.appliedPairs;
+    stats["magnetized_temporaries"] = (int64_t)profile.magnetizedTemporaries;
+    stats["forced_bodies"] = (int64_t)profile.forcedBodies;
+    stats["physics_calls"] = (int64_t)profile.physicsCalls;
+    stats["gather_msec"] = profile.gatherMsec;
+    stats["solve_msec"] = profile.solveMsec;
+    stats["apply_msec"] = profile.applyMsec;
+    stats["wait_msec"] = profile.waitMsec;
+    stats["synchronous_solve_msec"] = profile.synchronousSolveMsec;
+    stats["debug_draw_msec"] = profile.debugDrawMsec;
+#endif
+    return stats;
+}
+
+
+// --- Profiling ---
+
+#ifdef MAGNET_PROFILING
+
+// Performance monitor IDs and the profile field each one reports: a counter or a timing.
+struct MagnetMonitor {
+    const char* name;
+    uint64_t MagnetProfile::*counter;
+    double MagnetProfile::*msec;
+};
+static const MagnetMonitor MONITORS[] = {
+    { "Magnetism/Pairs considered", &MagnetProfile::consideredPairs, nullptr },
+    { "Magnetism/Pairs culled", &MagnetProfile::culledPairs, nullptr },
+    { "Magnetism/Pairs applied", &MagnetProfile::appliedPairs, nullptr },
+    { "Magnetism/Magnetized temporaries", &MagnetProfile::magnetizedTemporaries, nullptr },
+    { "Magnetism/Bodies forced", &MagnetProfile::forcedBodies, nullptr },
+    { "Magnetism/Physics server calls", &MagnetProfile::physicsCalls, nullptr },
+    { "Magnetism/Neighbor list rebuilds", &MagnetProfile::neighborListRebuilds, nullptr },
+    { "Magnetism/Neighbor list age", &MagnetProfile::neighborListAge, nullptr },
+    { "Magnetism/LOD cached pairs", &MagnetProfile::lodCachedPairs, nullptr },
+    { "Magnetism/Gather (ms)", nullptr, &MagnetProfile::gatherMsec },
+    { "Magnetism/Solve (ms)", nullptr, &MagnetProfile::solveMsec },
+    { "Magnetism/Apply (ms)", nullptr, &MagnetProfile::applyMsec },
+    { "Magnetism/Pipeline wait (ms)", nullptr, &MagnetProfile::waitMsec },
+    { "Magnetism/Synchronous solve (ms)", nullptr, &MagnetProfile::synchronousSolveMsec },
+    { "Magnetism/Debug draw (ms)", nullptr, &MagnetProfile::debugDrawMsec },
+};
+
+MagnetProfile& MagneticWorld::get_profile() {
+    return profile;
+}
+
+void MagneticWorld::add_monitors() {
+    Performance* performance = Performance::get_singleton();
+    for (int index = 0; index < int(sizeof(MONITORS) / sizeof(MONITORS[0])); index++) {
+        if (performance->has_custom_monitor(MONITORS[index].name)) continue;
+
+        Array arguments;
+        arguments.push_back(index);
+        performance->add_custom_monitor(MONITORS[index].name, callable_mp(this, &MagneticWorld::get_monitor_value), arguments);
+    }
+    monitorsAdded = true;
+}
+
+void MagneticWorld::remove_monitors() {
+    if (!monitorsAdded) return;
+
+    Performance* performance = Performance::get_singleton();
+    for (const MagnetMonitor& monitor : MONITORS) {
+        if (performance->has_custom_monitor(monitor.name)) {
+            performance->remove_custom_monitor(monitor.name);
+        }
+    }
+    monitorsAdded = false;
+}
+
+Variant MagneticWorld::get_monitor_value(int index) const {
+    // The profile is only written on the physics thread, after any pipelined solve was collected, so it is read
+    // without waiting for the solve in flight.
+    const MagnetMonitor& monitor = MONITORS[index];
+    if (monitor.counter != nullptr) return (int64_t)(profile.*monitor.counter);
+    return profile.*monitor.msec;
+}
+
+#endif // MAGNET_PROFILING
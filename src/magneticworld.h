@@ -0,0 +1,671 @@
+#ifndef MAGNETIC_WORLD_H
+#define MAGNETIC_WORLD_H
+
+#include <godot_cpp/classes/node.hpp>
+#include <godot_cpp/classes/physics_server3d.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/packed_vector2_array.hpp>
+#include <godot_cpp/variant/packed_vector3_array.hpp>
+#include <godot_cpp/variant/rid.hpp>
+#include <godot_cpp/variant/vector2.hpp>
+#include <godot_cpp/variant/vector3.hpp>
+#include <vector>
+
+#include "magneticbody3d.h"
+#include "magneticfieldgrid.h"
+#include "core/magnetprofiling.h"
+#include "core/magnetrecording.h"
+#include "core/magnetsolver.h"
+#include "core/magnettasks.h"
+
+using namespace godot;
+
+/**
+ * Centralized magnetism solver for the scene.
+ * Adapts the engine-independent MagnetSolver to Godot: gathers magnet state, runs the solver on the
+ * WorkerThreadPool, and applies the results to the magnets.
+ * Runs once per physics tick and evaluates every pair of registered magnets exactly once,
+ * applying equal and opposite forces/torques to both magnets of an influencing pair.
+ * This replaces the per-magnet loop formerly run in MagneticBody3D::_physics_process.
+ *
+ * Only one MagneticWorld is active at a time. If a scene does not contain one, the first
+ * MagneticBody3D to become ready will create one under the scene root.
+ */
+class MagneticWorld : public Node {
+    GDCLASS(MagneticWorld, Node)
+
+public:
+
+    // --- Public fields ---
+
+    /**
+     * The solver algorithms supported.
+     * Pairwise: exact reference; every broadphase candidate pair is evaluated.
+     * Octree: Barnes-Hut approximation; distant clusters of magnets are evaluated as single aggregate dipoles.
+     */
+    enum SolverModes {
+        Pairwise,
+        Octree
+    };
+
+    /**
+     * The floating-point precisions of the pair kernels.
+     * Double: reference precision.
+     * Float: single-precision pair evaluation; faster on large scenes, with about 1e-5 relative error per magnet.
+     */
+    enum KernelPrecisions {
+        Double,
+        Float
+    };
+
+
+    // --- Constructor/destructor ---
+
+    /**
+     * Default constructor; registers this world as the active solver if there is none yet.
+     */
+    MagneticWorld();
+
+    /**
+     * Destructor; clears the active solver if this world is it.
+     */
+    ~MagneticWorld();
+
+
+    // --- Public getters ---
+
+    /**
+     * Gets the active magnetism solver.
+     *
+     * @return The active MagneticWorld, or nullptr if none exists.
+     */
+    static MagneticWorld* get_singleton();
+
+    /**
+     * Gets the edge length of a broadphase grid cell.
+     *
+     * @return The cell size.
+     */
+    double get_broadphase_cell_size() const;
+
+    /**
+     * Sets the edge length of a broadphase grid cell.
+     * Cells around the typical sphere of influence radius work best.
+     *
+     * @param newCellSize The new cell size. Must be positive.
+     */
+    void set_broadphase_cell_size(const double newCellSize);
+
+    /**
+     * Gets the skin distance of the broadphase neighbor lists.
+     *
+     * @return The skin distance; 0 means neighbor lists are disabled.
+     */
+    double get_neighbor_skin() const;
+
+    /**
+     * Sets the skin distance of the broadphase neighbor lists (Pairwise mode only).
+     * Each magnet's neighbors within its sphere of influence plus the skin are cached, and the cached lists replace
+     * the grid query until some magnet has moved more than half the skin. A skin around the distance magnets travel
+     * in a few ticks works best.
+     *
+     * @param newSkin The new skin distance; 0 disables neighbor lists.
+     */
+    void set_neighbor_skin(const double newSkin);
+
+    /**
+     * Gets the minimum force of the pair cutoff.
+     *
+     * @return The minimum force; 0 disables the cutoff.
+     */
+    double get_min_pair_force() const;
+
+    /**
+     * Sets the minimum force of the pair cutoff (Pairwise mode only).
+     * Each pair then only interacts within the distance where the strongest force it could exert falls below this
+     * value, derived from both magnets' strengths, so a weak magnet next to a strong one no longer finds every pair
+     * inside the strong magnet's sphere of influence.
+     *
+     * @param newMinForce The new minimum force; 0 disables the cutoff.
+     */
+    void set_min_pair_force(const double newMinForce);
+
+    /**
+     * Gets the width of the cutoff falloff, as a fraction of each pair's cutoff radius.
+     *
+     * @return The falloff width.
+     */
+    double get_cutoff_falloff() const;
+
+    /**
+     * Sets the width of the cutoff falloff, as a fraction of each pair's cutoff radius.
+     * Forces fade out smoothly over this band, so pairs crossing their cutoff do not pop.
+     *
+     * @param newFalloff The new falloff width, between 0 and 1.
+     */
+    void set_cutoff_falloff(const double newFalloff);
+
+    /**
+     * Gets the level-of-detail tiers, by ascending force.
+     *
+     * @return One entry per tier: x is the tier's force, y its refresh interval in ticks.
+     */
+    PackedVector2Array get_lod_tiers() const;
+
+    /**
+     * Sets the level-of-detail tiers (Pairwise mode only).
+     * A pair whose strongest possible force at its current distance stays below a tier's force is only evaluated
+     * once every interval ticks, taking the tier with the smallest such force; in between, its last force and torque
+     * are applied again. Pairs are spread round-robin over the interval, and close (sub-stepped) pairs always stay at
+     * full rate.
+     *
+     * @param newTiers One entry per tier: x is the tier's force, y its refresh interval in ticks (at least 2).
+     */
+    void set_lod_tiers(const PackedVector2Array& newTiers);
+
+    /**
+     * Gets the maximum number of pair evaluations per tick while level-of-detail tiers are set.
+     *
+     * @return The budget; 0 means unlimited.
+     */
+    int get_lod_budget() const;
+
+    /**
+     * Sets the maximum number of pair evaluations per tick while level-of-detail tiers are set.
+     * Full-rate pairs are always evaluated; due tier pairs past the budget keep their last results until a later
+     * tick, the longest unrefreshed first.
+     *
+     * @param newBudget The new budget; 0 means unlimited.
+     */
+    void set_lod_budget(const int newBudget);
+
+    /**
+     * Gets the solver algorithm.
+     *
+     * @return The solver mode.
+     */
+    SolverModes get_solver_mode() const;
+
+    /**
+     * Sets the solver algorithm.
+     *
+     * @param mode The new solver mode.
+     */
+    void set_solver_mode(const SolverModes mode);
+
+    /**
+     * Gets the floating-point precision of the pair kernels.
+     *
+     * @return The kernel precision.
+     */
+    KernelPrecisions get_kernel_precision() const;
+
+    /**
+     * Sets the floating-point precision of the pair kernels (Pairwise mode only).
+     * Per-magnet results are accumulated in double precision either way.
+     *
+     * @param precision The new kernel precision.
+     */
+    void set_kernel_precision(const KernelPrecisions precision);
+
+    /**
+     * Gets the Barnes-Hut opening angle used in Octree mode.
+     *
+     * @return The opening angle.
+     */
+    double get_octree_opening_angle() const;
+
+    /**
+     * Sets the Barnes-Hut opening angle used in Octree mode.
+     * A cluster is approximated when its size divided by its distance is below this angle.
+     * Lower values are more accurate, higher values are faster.
+     *
+     * @param newAngle The new opening angle. Must not be negative.
+     */
+    void set_octree_opening_angle(const double newAngle);
+
+    /**
+     * Gets the number of threads the solver may use.
+     *
+     * @return The thread count; 0 means all available worker threads.
+     */
+    int get_thread_count() const;
+
+    /**
+     * Sets the number of threads the solver may use.
+     * Results are bit-identical for every thread count.
+     *
+     * @param newCount The new thread count; 0 uses all available worker threads, 1 solves on the physics thread only.
+     */
+    void set_thread_count(const int newCount);
+
+    /**
+     * Gets the separation below which magnet pairs are sub-stepped.
+     *
+     * @return The sub-step distance; 0 means sub-stepping is disabled.
+     */
+    double get_substep_distance() const;
+
+    /**
+     * Sets the separation below which magnet pairs are sub-stepped (Pairwise mode only).
+     * The forces between such close, stiff pairs (e.g. a projectile passing through an active coil) change a lot
+     * within one tick. Their motion is integrated over smaller internal sub-steps and the average force over the tick
+     * is applied, while the rest of the world keeps the normal tick rate.
+     *
+     * @param newDistance The new sub-step distance; 0 disables sub-stepping.
+     */
+    void set_substep_distance(const double newDistance);
+
+    /**
+     * Gets the maximum number of sub-steps per stiff pair and tick.
+     *
+     * @return The maximum sub-step count.
+     */
+    int get_max_substeps() const;
+
+    /**
+     * Sets the maximum number of sub-steps per stiff pair and tick.
+     *
+     * @param newCount The new maximum; at least 1.
+     */
+    void set_max_substeps(const int newCount);
+
+    /**
+     * Gets whether results are reused for magnets whose neighbourhood did not change since the last tick.
+     *
+     * @return True if incremental solving is enabled.
+     */
+    bool get_incremental() const;
+
+    /**
+     * Sets whether results are reused for magnets whose neighbourhood did not change since the last tick.
+     * Only magnets that moved, rotated, or changed on-state or magnetization, and the magnets sharing a pair with
+     * them, are recomputed; idle scenes skip the solve entirely. Results are identical either way.
+     * Sleeping magnets whose results were reused are not sent their forces again, so they stay asleep.
+     *
+     * @param enabled True to enable incremental solving.
+     */
+    void set_incremental(const bool enabled);
+
+    /**
+     * Gets whether the solve is pipelined.
+     *
+     * @return True if forces are solved on a background thread, one tick ahead of being applied.
+     */
+    bool get_pipelined() const;
+
+    /**
+     * Sets whether the solve is pipelined.
+     * A pipelined world gathers the magnets' state at the start of each tick and solves it on a background thread,
+     * overlapping the physics server's step and later _physics_process callbacks; the results are applied at the
+     * start of the next tick. Forces therefore lag one tick behind the magnets' state, except for magnets with
+     * synchronous_solve enabled, which are solved again within the tick. The snapshot and reach accessors return the
+     * results applied during the last tick without waiting; get_stats, sample_field, bake_static_field and changing
+     * solver settings wait for the background solve.
+     *
+     * @param enabled True to pipeline the solve.
+     */
+    void set_pipelined(const bool enabled);
+
+    /**
+     * Gets the baked field of the static magnets.
+     *
+     * @return The static field grid; may be null.
+     */
+    Ref<MagneticFieldGrid> get_static_field() const;
+
+    /**
+     * Sets the baked field of the static magnets.
+     * While the grid is baked, magnets flagged as baked_static are left out of the solve, and every other magnet
+     * inside the grid receives their combined force and torque from one trilinear lookup.
+     *
+     * @param newField The new static field grid; null disables the static field.
+     */
+    void set_static_field(const Ref<MagneticFieldGrid>& newField);
+
+    /**
+     * Bakes the field of every registered magnet flagged as baked_static into the static field grid.
+     * Meant to be run from an EditorScript with the scene open, after which the grid resource is saved.
+     * Only permanent magnets can be baked, since they are always on and their field never changes.
+     * The baked magnets must all be on the same magnetic layer, since the grid reaches every magnet whose mask
+     * allows that layer; nothing is baked if they are not.
+     */
+    void bake_static_field();
+
+    /**
+     * Samples the magnetic influence of the magnets at many points in one native pass, e.g. for compasses, particle
+     * effects or AI avoiding magnetic zones. Uses the magnet state of the last physics tick, the solver's broadphase
+     * and kernel, and the baked static field; the points are split across the worker threads like the solve.
+     * Each point is probed as a permanent magnet of unit strength that does not influence the scene.
+     *
+     * @param points The sample points, in global coordinates.
+     * @param axis The pole direction of the probe. If set, each result is the force on the probe, to be scaled by the
+     * probe's strength. If zero (the default), each result is the field the probe's pole aligns with, pointing from
+     * its negative to its positive pole like a compass needle, with a length proportional to the aligning torque.
+     * @return One result per point, in global coordinates.
+     */
+    PackedVector3Array sample_field(const PackedVector3Array& points, const Vector3& axis = Vector3());
+
+    /**
+     * Starts recording every solved tick to a binary file: the gathered state and the results of every magnet in
+     * the solve, along with the solver settings. Replaces any recording in progress.
+     * Recordings are replayed headlessly by the native benchmark (magnetism_benchmark --replay FILE), which solves
+     * every frame again and diffs the results against the recorded ones.
+     *
+     * @param path The file to create, e.g. "user://session.magrec".
+     * @return True if the file was created.
+     */
+    bool start_recording(const String& path);
+
+    /**
+     * Stops recording and writes the remaining buffered frames.
+     */
+    void stop_recording();
+
+    /**
+     * Gets whether ticks are being recorded.
+     *
+     * @return True while recording.
+     */
+    bool is_recording() const;
+
+    /**
+     * Gets statistics about the last solver step.
+     * In debug builds, this also includes the profiling counters and phase timings also reported as
+     * Performance custom monitors under "Magnetism/".
+     *
+     * @return A dictionary with the number of magnets and the counters of the active solver mode.
+     */
+    Dictionary get_stats() const;
+
+    /**
+     * Gets the magnet state and per-magnet results of the last solver step, in snapshot order.
+     * Lets debug visualization reuse the solver's results instead of re-evaluating every pair.
+     * While pipelined, these are the results applied during the last tick, so reading them never waits for the
+     * solve in flight.
+     *
+     * @return The snapshot.
+     */
+    const MagnetSnapshot& get_snapshot() const;
+
+    /**
+     * Gets the squared distance up to which a magnet of the last solver step can reach other magnets: its sphere of
+     * influence, shrunk by the pair cutoff against the strongest magnet in Pairwise mode.
+     *
+     * @param i The magnet's index in get_snapshot().
+     * @return The squared reach.
+     */
+    double get_reach_sqr(size_t i) const;
+
+    /**
+     * Gets whether the last solver step used the baked static field, leaving the baked static magnets out of
+     * get_snapshot().
+     *
+     * @return True if the static field was used, false if not.
+     */
+    bool is_static_field_active() const;
+
+#ifdef MAGNET_PROFILING
+    /**
+     * Gets the profile of the last solver step, so other magnetism nodes can report their own timings into it.
+     *
+     * @return The profile.
+     */
+    MagnetProfile& get_profile();
+#endif
+
+
+    // --- Core solver methods ---
+
+    /**
+     * Evaluates all magnet pairs in the registry once and applies the resulting forces and torques.
+     *
+     * @param delta The physics timestep.
+     */
+    void step(double delta);
+
+    /**
+     * Runs the solver for the current physics frame.
+     */
+    virtual void _physics_process(double delta) override;
+
+    /**
+     * Registers the profiling monitors in debug builds.
+     */
+    virtual void _enter_tree() override;
+
+    /**
+     * Removes the profiling monitors in debug builds.
+     */
+    virtual void _exit_tree() override;
+
+protected:
+    /**
+     * Binds methods and registers properties for the editor.
+     */
+    static void _bind_methods();
+
+private:
+
+    // --- Private fields ---
+
+    /**
+     * The active magnetism solver.
+     */
+    static MagneticWorld* singleton;
+
+    /**
+     * Number of threads the solver may use; 0 means all available worker threads.
+     */
+    int threadCount = 0;
+
+    /**
+     * Engine-independent solver; owns the snapshot, broadphase and octree.
+     */
+    MagnetSolver solver;
+
+    /**
+     * The magnets captured in the snapshot, in snapshot order.
+     */
+    std::vector<MagneticBody3D*> bodies;
+
+    /**
+     * Registry handle of each captured magnet, so pipelined results can skip magnets freed since they were gathered.
+     */
+    std::vector<MagnetHandle> bodyHandles;
+
+    /**
+     * Physics server body of each captured magnet, cached whenever the captured magnets change.
+     */
+    std::vector<RID> bodyRids;
+
+    /**
+     * Baked field of the static magnets; may be null.
+     */
+    Ref<MagneticFieldGrid> staticField;
+
+    /**
+     * Whether the last gathered snapshot left out the baked static magnets in favour of the static field.
+     */
+    bool staticFieldActive = false;
+
+    /**
+     * Scratch list of the registered magnets that are not represented by the static field.
+     */
+    std::vector<MagneticBody3D*> dynamicBodies;
+
+    /**
+     * Scratch buffers of sample_field.
+     */
+    std::vector<MagnetVector> samplePoints;
+    std::vector<MagnetVector> sampleResults;
+
+    /**
+     * Recording in progress, if any, and the scratch list of the recorded magnets' instance IDs.
+     */
+    MagnetRecordWriter recorder;
+    std::vector<uint64_t> recordIds;
+
+    /**
+     * Number of sleeping magnets whose forces were not reapplied during the last step.
+     */
+    uint32_t sleepingSkipped = 0;
+
+    /**
+     * Whether the solve is pipelined (see set_pipelined).
+     */
+    bool pipelined = false;
+
+    /**
+     * WorkerThreadPool task of the pipelined solve in flight, or -1. Waiting for it from const accessors clears it.
+     */
+    mutable int64_t pipelineTask = -1;
+
+    /**
+     * Whether the snapshot holds pipelined results that were not applied yet.
+     */
+    bool pipelineResultsPending = false;
+
+    /**
+     * Solver of the synchronous magnets while the solve is pipelined; never incremental.
+     */
+    MagnetSolver synchronousSolver;
+
+    /**
+     * Snapshot indices of the synchronous magnets gathered this tick.
+     */
+    std::vector<uint32_t> synchronousMagnets;
+
+    /**
+     * Copy of the pipelined results applied during the last tick, and each magnet's reach, for get_snapshot and
+     * get_reach_sqr while the next solve is in flight.
+     */
+    MagnetSnapshot appliedSnapshot;
+    std::vector<double> appliedReachSqr;
+
+#ifdef MAGNET_PROFILING
+    /**
+     * Duration of the last pipelined solve, written by the background task.
+     */
+    double pipelineSolveMsec = 0.0;
+
+    /**
+     * Profile of the last solver step.
+     */
+    MagnetProfile profile;
+
+    /**
+     * Whether this world registered the Performance custom monitors.
+     */
+    bool monitorsAdded = false;
+#endif
+
+
+    // --- Solver phases ---
+
+    /**
+     * Copies the state of every registered magnet into the snapshot.
+     * Reads each magnet's global transform once, so the remaining phases never cross the GDExtension boundary.
+     */
+    void gather_snapshot();
+
+    /**
+     * Runs solver tasks on Godot's WorkerThreadPool, or serially on the physics thread for a thread count of 1.
+     *
+     * @param taskCount The number of tasks.
+     * @param task The task function.
+     */
+    void run_tasks(uint32_t taskCount, const MagnetTaskFunction& task);
+
+    /**
+     * WorkerThreadPool entry point for one solver task.
+     */
+    static void run_task(void* userdata, uint32_t taskIndex);
+
+    /**
+     * Gathers, solves and applies one tick with the solve pipelined: applies the results of the solve started during
+     * the previous tick, solves the synchronous magnets, and starts the next background solve.
+     *
+     * @param delta The physics timestep.
+     */
+    void step_pipelined(double delta);
+
+    /**
+     * Starts solving the snapshot on a WorkerThreadPool task.
+     */
+    void start_pipelined_solve();
+
+    /**
+     * WorkerThreadPool entry point of the pipelined solve.
+     */
+    static void run_pipelined_solve(void* userdata);
+
+    /**
+     * Waits for the pipelined solve in flight, if any, so the solver can be read or modified.
+     */
+    void wait_for_solve() const;
+
+    /**
+     * Copies the pipelined results just applied, and each magnet's reach, for readers during the next solve.
+     */
+    void copy_applied_results();
+
+    /**
+     * Solves the synchronous magnets gathered this tick against their current neighbours, and applies their results.
+     */
+    void solve_synchronous_magnets();
+
+    /**
+     * Commits magnetization and applies each magnet's net force and torque to its physics body, with at most one
+     * force and one torque call per body, straight to the physics server.
+     * Pipelined results skip the synchronous magnets and the magnets freed since the snapshot was gathered.
+     */
+    void apply_results();
+
+    /**
+     * Commits one magnet's magnetization and applies its net force and torque.
+     *
+     * @param body Index of the magnet in bodies.
+     * @param snapshot The snapshot holding the magnet's results.
+     * @param i Index of the magnet in snapshot.
+     * @param physics The physics server.
+     */
+    void apply_result(size_t body, const MagnetSnapshot& snapshot, size_t i, PhysicsServer3D* physics);
+
+    /**
+     * Appends the solved snapshot to the recording.
+     */
+    void record_frame();
+
+
+#ifdef MAGNET_PROFILING
+    // --- Profiling ---
+
+    /**
+     * Registers a Performance custom monitor for every profiling counter and timing.
+     */
+    void add_monitors();
+
+    /**
+     * Removes the Performance custom monitors registered by add_monitors.
+     */
+    void remove_monitors();
+
+    /**
+     * Performance monitor callback.
+     *
+     * @param index The monitor's index in the monitor table.
+     * @return The current value, read from the profile.
+     */
+    Variant get_monitor_value(int index) const;
+#endif
+};
+
+
+// Register SolverModes and KernelPrecisions enums with Godot.
+VARIANT_ENUM_CAST(MagneticWorld::SolverModes);
+VARIANT_ENUM_CAST(MagneticWorld::KernelPrecisions);
+
+
+#endif // MAGNETIC_WORLD_H
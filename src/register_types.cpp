@@ -1,7 +1,10 @@
 #include "register_types.h"
 
+#include "coilguncontroller.h"
 #include "magneticbody3d.h"
 #include "magneticdebugdraw.h"
+#include "magneticfieldgrid.h"
+#include "magneticworld.h"
 
 #include <gdextension_interface.h>
 #include <godot_cpp/core/defs.hpp>
@@ -16,6 +19,9 @@ void initialize_magnetism_module(ModuleInitializationLevel p_level) {
 	}
     GDREGISTER_CLASS(MagneticBody3D);
     GDREGISTER_CLASS(MagneticDebugDraw);
+    GDREGISTER_CLASS(MagneticFieldGrid);
+    GDREGISTER_CLASS(MagneticWorld);
+    GDREGISTER_CLASS(CoilgunController);
 }
 
 void uninitialize_magnetism_module(ModuleInitializationLevel p_level) {